@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "AttributeCache.h"
+
+
+bool
+AttributeCache::NodeKey::operator<(const NodeKey& other) const
+{
+	if (node != other.node)
+		return node < other.node;
+	return device < other.device;
+}
+
+
+//	#pragma mark - AttributeCache
+
+
+AttributeCache::AttributeCache(int32 maxNodes)
+	:
+	fMaxNodes(maxNodes),
+	fPass(1)
+{
+}
+
+
+AttributeCache::~AttributeCache()
+{
+}
+
+
+/*!	Returns the attribute \a name of the node with the given \a stat, or
+	\c NULL, if it has not been read yet, or if the node has changed since.
+*/
+const AttributeCache::Attribute*
+AttributeCache::Lookup(const struct stat& stat, const char* name)
+{
+	Node* node = _NodeFor(stat, false);
+	if (node == NULL)
+		return NULL;
+
+	AttributeMap::const_iterator found = node->attributes.find(name);
+	if (found == node->attributes.end())
+		return NULL;
+
+	return &found->second;
+}
+
+
+void
+AttributeCache::Store(const struct stat& stat, const char* name,
+	const Attribute& attribute)
+{
+	Node* node = _NodeFor(stat, true);
+	if (node != NULL)
+		node->attributes[name] = attribute;
+}
+
+
+/*!	Starts a new pass over the files: the nodes used so far may be dropped
+	again once the cache is full.
+*/
+void
+AttributeCache::StartPass()
+{
+	fPass++;
+}
+
+
+void
+AttributeCache::MakeEmpty()
+{
+	fMap.clear();
+	fNodes.clear();
+}
+
+
+/*!	Returns the entry of the node with the given \a stat, and makes it the
+	most recently used one. Its attributes are dropped if the node has
+	changed since they were stored. If there is no entry yet, one is only
+	created if \a create is \c true.
+*/
+AttributeCache::Node*
+AttributeCache::_NodeFor(const struct stat& stat, bool create)
+{
+	NodeKey key;
+	key.device = stat.st_dev;
+	key.node = stat.st_ino;
+
+	NodeMap::iterator found = fMap.find(key);
+	if (found != fMap.end()) {
+		Node& node = *found->second;
+		fNodes.splice(fNodes.end(), fNodes, found->second);
+		node.used = fPass;
+
+		if (node.changed.tv_sec != stat.st_ctim.tv_sec
+			|| node.changed.tv_nsec != stat.st_ctim.tv_nsec) {
+			node.attributes.clear();
+			node.changed = stat.st_ctim;
+		}
+		return &node;
+	}
+
+	if (!create || fMaxNodes <= 0)
+		return NULL;
+
+	// The nodes of the current pass are the most recently used ones
+	while ((int32)fNodes.size() >= fMaxNodes && fNodes.front().used != fPass) {
+		fMap.erase(fNodes.front().key);
+		fNodes.pop_front();
+	}
+
+	Node node;
+	node.key = key;
+	node.changed = stat.st_ctim;
+	node.used = fPass;
+	NodeList::iterator inserted = fNodes.insert(fNodes.end(), node);
+	fMap.insert(std::make_pair(key, inserted));
+	return &*inserted;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef ATTRIBUTE_CACHE_H
+#define ATTRIBUTE_CACHE_H
+
+
+#include <String.h>
+
+#include <sys/stat.h>
+
+#include <list>
+#include <map>
+#include <vector>
+
+
+/*!	Remembers the attributes read from files.
+
+	The attributes are kept per node, identified by its device and inode.
+	As writing an attribute updates the status change time of a node, all
+	attributes of a node are dropped as soon as its change time differs
+	from the one they were read with. Attributes that a file does not have
+	are remembered as well.
+
+	The least recently used nodes are dropped once the cache is full, but
+	only those that have not been used in the current pass: when a pass
+	covers more nodes than fit, the cache grows instead, so that reading
+	the same list of files again does not drop every node just before it
+	is needed.
+*/
+class AttributeCache {
+public:
+	struct Attribute {
+		bool					exists;
+		uint32					type;
+		std::vector<char>		data;
+
+		Attribute()
+			:
+			exists(false),
+			type(0)
+		{
+		}
+	};
+
+								AttributeCache(int32 maxNodes = 4096);
+								~AttributeCache();
+
+			const Attribute*	Lookup(const struct stat& stat,
+									const char* name);
+			void				Store(const struct stat& stat,
+									const char* name,
+									const Attribute& attribute);
+			void				StartPass();
+			void				MakeEmpty();
+			int32				CountNodes() const
+									{ return fNodes.size(); }
+
+private:
+			struct NodeKey {
+				dev_t			device;
+				ino_t			node;
+
+				bool			operator<(const NodeKey& other) const;
+			};
+
+			typedef std::map<BString, Attribute> AttributeMap;
+
+			struct Node {
+				NodeKey			key;
+				struct timespec	changed;
+				uint32			used;
+				AttributeMap	attributes;
+			};
+
+			typedef std::list<Node> NodeList;
+			typedef std::map<NodeKey, NodeList::iterator> NodeMap;
+
+			Node*				_NodeFor(const struct stat& stat, bool create);
+
+private:
+			NodeList			fNodes;
+			NodeMap				fMap;
+			int32				fMaxNodes;
+			uint32				fPass;
+};
+
+
+#endif	// ATTRIBUTE_CACHE_H
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "DirectoryCache.h"
+
+#include "FileSystem.h"
+
+#include <UnicodeChar.h>
+
+#include <string.h>
+
+
+static const size_t kMaxDirectories = 128;
+
+
+size_t
+DirectoryCache::NameHash::operator()(const BString& name) const
+{
+	// FNV-1a
+	const uint8* bytes = (const uint8*)name.String();
+	size_t hash = 2166136261U;
+	for (int32 index = 0; index < name.Length(); index++)
+		hash = (hash ^ bytes[index]) * 16777619;
+	return hash;
+}
+
+
+/*!	Returns the number of bytes of the valid UTF-8 character at the start
+	of \a string, or 0 if it does not start with one.
+*/
+static int32
+utf8_character_size(const char* string)
+{
+	uint8 byte = (uint8)string[0];
+	int32 size = byte >= 0xf8 ? 0 : byte >= 0xf0 ? 4 : byte >= 0xe0 ? 3
+		: byte >= 0xc0 ? 2 : 0;
+	for (int32 index = 1; index < size; index++) {
+		if (((uint8)string[index] & 0xc0) != 0x80)
+			return 0;
+	}
+	return size;
+}
+
+
+/*!	Returns \a name with all of its characters folded to lower case, so
+	that names that only differ in case are the same. Bytes that are not
+	part of a valid UTF-8 character are left alone.
+*/
+static BString
+fold_name(const char* name)
+{
+	int32 length = strlen(name);
+
+	// Folding a character makes it at most half as long again
+	BString folded;
+	char* buffer = folded.LockBuffer(length * 2);
+	if (buffer == NULL)
+		return name;
+
+	char* target = buffer;
+	while (*name != '\0') {
+		uint8 byte = (uint8)*name;
+		if (byte < 0x80) {
+			*target++ = byte >= 'A' && byte <= 'Z' ? byte - 'A' + 'a' : byte;
+			name++;
+			continue;
+		}
+
+		if (utf8_character_size(name) == 0) {
+			*target++ = *name++;
+			continue;
+		}
+
+		uint32 c = BUnicodeChar::FromUTF8(&name);
+		BUnicodeChar::ToUTF8(
+			BUnicodeChar::ToLower(BUnicodeChar::ToUpper(c)), &target);
+	}
+
+	folded.UnlockBuffer(target - buffer);
+	return folded;
+}
+
+
+//	#pragma mark - DirectoryCache
+
+
+DirectoryCache::DirectoryCache(FileSystem& fileSystem)
+	:
+	fFileSystem(fileSystem),
+	fPass(1)
+{
+}
+
+
+DirectoryCache::~DirectoryCache()
+{
+}
+
+
+/*!	Starts a new pass: every directory will be checked for changes again
+	the next time it is used.
+*/
+void
+DirectoryCache::StartPass()
+{
+	fPass++;
+}
+
+
+/*!	Returns whether \a name exists in \a directory. The \a name may contain
+	slashes, in which case it is looked up in the respective sub directory.
+
+	Names are compared exactly. Since the volume might not be case
+	sensitive, a name that only differs in case from an existing one is
+	checked on disk instead.
+*/
+bool
+DirectoryCache::Exists(const char* directory, const char* name)
+{
+	BString path(directory);
+	path << "/" << name;
+
+	int32 slash = path.FindLast('/');
+	const char* leaf = path.String() + slash + 1;
+	if (leaf[0] == '\0' || !strcmp(leaf, ".") || !strcmp(leaf, ".."))
+		return fFileSystem.Exists(path.String());
+
+	BString parent(path.String(), slash > 0 ? slash : 1);
+	Directory* cached = _DirectoryFor(parent);
+	if (cached == NULL) {
+		// Not a directory we can cache, just ask the file system
+		return fFileSystem.Exists(path.String());
+	}
+
+	if (cached->names.find(BString(leaf)) != cached->names.end())
+		return true;
+	if (cached->foldedNames.find(fold_name(leaf))
+			== cached->foldedNames.end())
+		return false;
+
+	return fFileSystem.Exists(path.String());
+}
+
+
+void
+DirectoryCache::MakeEmpty()
+{
+	fDirectories.clear();
+}
+
+
+/*!	Returns the cached contents of the directory at \a path, after reading
+	it, if it has not been read yet, or if it has changed since. Returns
+	\c NULL if the path does not refer to a readable directory.
+*/
+DirectoryCache::Directory*
+DirectoryCache::_DirectoryFor(const BString& path)
+{
+	DirectoryMap::iterator found = fDirectories.find(path);
+	if (found != fDirectories.end() && found->second.validated == fPass) {
+		found->second.used = fPass;
+		return &found->second;
+	}
+
+	struct stat stat;
+	if (fFileSystem.GetStat(path.String(), stat) != B_OK
+		|| !S_ISDIR(stat.st_mode)) {
+		if (found != fDirectories.end())
+			fDirectories.erase(found);
+		return NULL;
+	}
+
+	if (found != fDirectories.end()) {
+		Directory& directory = found->second;
+		if (directory.device == stat.st_dev && directory.node == stat.st_ino
+			&& directory.modified.tv_sec == stat.st_mtim.tv_sec
+			&& directory.modified.tv_nsec == stat.st_mtim.tv_nsec) {
+			directory.validated = fPass;
+			directory.used = fPass;
+			return &directory;
+		}
+	} else {
+		if (fDirectories.size() >= kMaxDirectories)
+			_RemoveLeastRecentlyUsed();
+
+		found = fDirectories.insert(std::make_pair(path, Directory())).first;
+	}
+
+	NameList names;
+	if (fFileSystem.ReadDirectory(path.String(), names) != B_OK) {
+		fDirectories.erase(found);
+		return NULL;
+	}
+
+	Directory& directory = found->second;
+	directory.names.clear();
+	directory.names.insert(names.begin(), names.end());
+	directory.foldedNames.clear();
+	for (NameList::const_iterator iterator = names.begin();
+			iterator != names.end(); iterator++) {
+		directory.foldedNames.insert(fold_name(iterator->String()));
+	}
+	directory.device = stat.st_dev;
+	directory.node = stat.st_ino;
+	directory.modified = stat.st_mtim;
+	directory.validated = fPass;
+	directory.used = fPass;
+	return &directory;
+}
+
+
+void
+DirectoryCache::_RemoveLeastRecentlyUsed()
+{
+	DirectoryMap::iterator oldest = fDirectories.begin();
+	DirectoryMap::iterator iterator = fDirectories.begin();
+	for (; iterator != fDirectories.end(); iterator++) {
+		if (iterator->second.used < oldest->second.used)
+			oldest = iterator;
+	}
+
+	if (oldest != fDirectories.end())
+		fDirectories.erase(oldest);
+}
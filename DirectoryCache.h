@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef DIRECTORY_CACHE_H
+#define DIRECTORY_CACHE_H
+
+
+#include <String.h>
+
+#include <sys/stat.h>
+
+#include <map>
+#include <unordered_set>
+
+
+class FileSystem;
+
+
+/*!	Answers whether entries exist by reading their directory once, and
+	looking the names up in memory afterwards.
+
+	A directory is checked for changes at most once per pass, by comparing
+	its modification time; it is only read again if it has changed. Only
+	the most recently used directories are kept.
+
+	On volumes that are not case sensitive, a name also exists if it only
+	differs in case from an entry; such names are checked on disk.
+*/
+class DirectoryCache {
+public:
+								DirectoryCache(FileSystem& fileSystem);
+								~DirectoryCache();
+
+			void				StartPass();
+			bool				Exists(const char* directory,
+									const char* name);
+			void				MakeEmpty();
+
+private:
+			struct NameHash {
+				size_t			operator()(const BString& name) const;
+			};
+
+			typedef std::unordered_set<BString, NameHash> NameSet;
+
+			struct Directory {
+				NameSet			names;
+				NameSet			foldedNames;
+				dev_t			device;
+				ino_t			node;
+				struct timespec	modified;
+				uint32			validated;
+				uint32			used;
+			};
+
+			typedef std::map<BString, Directory> DirectoryMap;
+
+			Directory*			_DirectoryFor(const BString& path);
+			void				_RemoveLeastRecentlyUsed();
+
+private:
+			FileSystem&			fFileSystem;
+			DirectoryMap		fDirectories;
+			uint32				fPass;
+};
+
+
+#endif	// DIRECTORY_CACHE_H
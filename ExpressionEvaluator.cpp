@@ -0,0 +1,685 @@
+/*
+ * Copyright (c) 2019-2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "ExpressionEvaluator.h"
+
+#include "FileSystem.h"
+
+#include <StorageDefs.h>
+#include <TypeConstants.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// Attributes are only read up to this size; longer ones are cut off
+static const size_t kMaxAttributeSize = 65536;
+
+
+template<typename Type>
+static bool
+get_value(const AttributeCache::Attribute& attribute, Type& value)
+{
+	if (attribute.data.size() < sizeof(Type))
+		return false;
+
+	memcpy(&value, &attribute.data[0], sizeof(Type));
+	return true;
+}
+
+
+template<typename Type>
+static bool
+read_integer(const AttributeCache::Attribute& attribute, int64& value)
+{
+	Type typedValue;
+	if (!get_value(attribute, typedValue))
+		return false;
+
+	value = (int64)typedValue;
+	return true;
+}
+
+
+static bool
+get_integer(const AttributeCache::Attribute& attribute, int64& value,
+	bool& isUnsigned)
+{
+	isUnsigned = true;
+
+	switch (attribute.type) {
+		case B_UINT8_TYPE:
+		case B_BOOL_TYPE:
+			return read_integer<uint8>(attribute, value);
+		case B_UINT16_TYPE:
+			return read_integer<uint16>(attribute, value);
+		case B_UINT32_TYPE:
+			return read_integer<uint32>(attribute, value);
+		case B_UINT64_TYPE:
+			return read_integer<uint64>(attribute, value);
+	}
+
+	isUnsigned = false;
+
+	switch (attribute.type) {
+		case B_INT8_TYPE:
+			return read_integer<int8>(attribute, value);
+		case B_INT16_TYPE:
+			return read_integer<int16>(attribute, value);
+		case B_INT32_TYPE:
+			return read_integer<int32>(attribute, value);
+		case B_INT64_TYPE:
+			return read_integer<int64>(attribute, value);
+	}
+
+	return false;
+}
+
+
+/*!	Skips the number at \a pointer, and returns whether it is no larger
+	than a file name could be.
+*/
+static bool
+skip_length(const char*& pointer)
+{
+	const char* start = pointer;
+	while (isdigit(*pointer))
+		pointer++;
+
+	return pointer - start <= 3 && atoi(start) <= B_FILE_NAME_LENGTH;
+}
+
+
+/*!	Returns the conversion character of \a format, if it consists of a
+	single printf() conversion, like "%04d", or "%.2f", or '\0' if not.
+	The width, and the precision cannot exceed B_FILE_NAME_LENGTH.
+*/
+static char
+format_conversion(const char* format)
+{
+	if (format[0] != '%')
+		return '\0';
+
+	const char* pointer = format + 1;
+	while (*pointer != '\0' && strchr("-+ 0#", *pointer) != NULL)
+		pointer++;
+	if (!skip_length(pointer))
+		return '\0';
+	if (*pointer == '.') {
+		pointer++;
+		if (!skip_length(pointer))
+			return '\0';
+	}
+
+	if (*pointer == '\0' || pointer[1] != '\0'
+		|| strchr("diouxXeEfFgGs", *pointer) == NULL)
+		return '\0';
+
+	return *pointer;
+}
+
+
+static bool
+format_integer(BString& result, const char* format, int64 value,
+	bool isUnsigned)
+{
+	char conversion = format_conversion(format);
+	if (conversion == '\0' || conversion == 's')
+		return false;
+
+	if (strchr("eEfFgG", conversion) != NULL) {
+		result.SetToFormat(format,
+			isUnsigned ? (double)(uint64)value : (double)value);
+		return true;
+	}
+
+	// The value needs the 64 bit length modifier
+	BString integerFormat(format, strlen(format) - 1);
+	integerFormat << "ll" << conversion;
+	result.SetToFormat(integerFormat.String(), (long long)value);
+	return true;
+}
+
+
+static bool
+format_double(BString& result, const char* format, double value)
+{
+	char conversion = format_conversion(format);
+	if (conversion == '\0' || conversion == 's')
+		return false;
+
+	if (strchr("eEfFgG", conversion) == NULL)
+		return format_integer(result, format, (int64)value, false);
+
+	result.SetToFormat(format, value);
+	return true;
+}
+
+
+/*!	Formats \a time with the strftime() \a format, or \a defaultFormat, if
+	it is empty.
+*/
+static void
+format_time(BString& result, const char* format, time_t time,
+	const char* defaultFormat)
+{
+	char buffer[256];
+	struct tm timeInfo;
+	localtime_r(&time, &timeInfo);
+	if (strftime(buffer, sizeof(buffer),
+			format[0] != '\0' ? format : defaultFormat, &timeInfo) > 0)
+		result = buffer;
+	else
+		result.Truncate(0);
+}
+
+
+/*!	Formats the string \a value; number conversions are only used if the
+	string contains a number.
+*/
+static bool
+format_string(BString& result, const char* format, const char* value)
+{
+	char conversion = format_conversion(format);
+	if (conversion == '\0')
+		return false;
+
+	if (conversion == 's') {
+		result.SetToFormat(format, value);
+		return true;
+	}
+
+	char* end;
+	errno = 0;
+	long long integer = strtoll(value, &end, 10);
+	if (end != value && *end == '\0' && errno == 0)
+		return format_integer(result, format, integer, false);
+
+	double number = strtod(value, &end);
+	if (end != value && *end == '\0')
+		return format_double(result, format, number);
+
+	return false;
+}
+
+
+ExpressionEvaluator::ExpressionEvaluator(FileSystem& fileSystem)
+	:
+	fFileSystem(fileSystem),
+	fNextShellJob(0),
+	fCounterIndex(0),
+	fDirectoryCounterIndex(0)
+{
+}
+
+
+ExpressionEvaluator::~ExpressionEvaluator()
+{
+}
+
+
+/*!	Evaluates all expressions in the \a target name for the file at \a path,
+	and stores the resulting name in \a result.
+
+	If \a replacements is given, every evaluated expression is added to it;
+	the positions are relative to the target with all previous replacements
+	applied.
+
+	\return the number of expressions found; \a emptyCount will be set to the
+		number of expressions that evaluated to an empty string.
+*/
+int32
+ExpressionEvaluator::Evaluate(const char* path, const BString& target,
+	BString& result, int32& emptyCount, ReplacementList* replacements)
+{
+	return Evaluate(path, ExpressionTemplate(target), result, emptyCount,
+		replacements);
+}
+
+
+/*!	Evaluates the already parsed \a target; see above. */
+int32
+ExpressionEvaluator::Evaluate(const char* path,
+	const ExpressionTemplate& target, BString& result, int32& emptyCount,
+	ReplacementList* replacements)
+{
+	emptyCount = 0;
+
+	if (target.CountExpressions() == 0) {
+		result = target.Target();
+		return 0;
+	}
+
+	result.Truncate(0);
+
+	FileSource source;
+	source.path = path;
+	source.node = NULL;
+	source.hasStat = false;
+	source.statValid = false;
+
+	for (int32 index = 0; index < target.CountParts(); index++) {
+		const ExpressionTemplate::Part& part = target.PartAt(index);
+		if (part.type == ExpressionTemplate::LITERAL) {
+			result.Append(part.text);
+			continue;
+		}
+
+		BString value;
+		if (part.type == ExpressionTemplate::SHELL)
+			value = _ExecuteShell(path, part.text.String());
+		else if (part.type == ExpressionTemplate::FILE_INFO)
+			value = _EvaluateFileInfo(source, part);
+		else if (part.type == ExpressionTemplate::COUNTER)
+			value = _EvaluateCounter(part);
+		else
+			value = _EvaluateAttribute(source, part);
+
+		if (part.maxLength >= 0)
+			value.TruncateChars(part.maxLength);
+
+		if (value.IsEmpty())
+			emptyCount++;
+
+		if (replacements != NULL) {
+			replacements->push_back(Replacement(result.Length(),
+				result.Length() + part.length, value));
+		}
+		result.Append(value);
+	}
+
+	delete source.node;
+	return target.CountExpressions();
+}
+
+
+/*!	Starts a new pass over a list of files. Everything that is cached for
+	the files of the current pass is kept until the next one, however many
+	files there are.
+*/
+void
+ExpressionEvaluator::StartPass()
+{
+	fAttributeCache.StartPass();
+	fShellCache.StartPass();
+}
+
+
+/*!	Sets the position of the file of the next Evaluate() among all files
+	that are renamed, and among those in the same directory, both starting
+	at zero.
+*/
+void
+ExpressionEvaluator::SetCounters(int32 index, int32 directoryIndex)
+{
+	fCounterIndex = index;
+	fDirectoryCounterIndex = directoryIndex;
+}
+
+
+/*!	Adds a job for every shell script in \a target to be run for the file
+	at \a path with the next RunShellJobs().
+*/
+void
+ExpressionEvaluator::AddShellJobs(const char* path, const BString& target)
+{
+	AddShellJobs(path, ExpressionTemplate(target));
+}
+
+
+void
+ExpressionEvaluator::AddShellJobs(const char* path,
+	const ExpressionTemplate& target)
+{
+	if (!target.HasShellScripts())
+		return;
+
+	struct stat stat;
+	status_t statStatus = fFileSystem.GetStat(path, stat);
+
+	for (int32 index = 0; index < target.CountParts(); index++) {
+		const ExpressionTemplate::Part& part = target.PartAt(index);
+		if (part.type != ExpressionTemplate::SHELL)
+			continue;
+
+		ShellWorkerPool::Job job(path, part.text.String());
+		bool cacheable = statStatus == B_OK
+			&& ShellResultCache::IsCacheable(job.script.String());
+
+		if (cacheable && fShellCache.Lookup(job.script.String(), path, stat,
+				job.output)) {
+			fShellJobs.push_back(job);
+			continue;
+		}
+
+		PendingJob pending;
+		pending.index = fShellJobs.size();
+		pending.cacheable = cacheable;
+		if (pending.cacheable)
+			pending.stat = stat;
+
+		fShellJobs.push_back(job);
+		fPendingShellJobs.push_back(pending);
+	}
+}
+
+
+/*!	Runs all jobs added since the last ClearShellJobs() that are not in the
+	cache concurrently, and adds the output of those that succeeded to the
+	cache.
+*/
+void
+ExpressionEvaluator::RunShellJobs()
+{
+	fNextShellJob = 0;
+	if (fPendingShellJobs.empty())
+		return;
+
+	std::vector<ShellWorkerPool::Job> jobs;
+	jobs.reserve(fPendingShellJobs.size());
+	for (size_t index = 0; index < fPendingShellJobs.size(); index++)
+		jobs.push_back(fShellJobs[fPendingShellJobs[index].index]);
+
+	fShellPool.Run(&jobs[0], jobs.size());
+
+	for (size_t index = 0; index < fPendingShellJobs.size(); index++) {
+		const PendingJob& pending = fPendingShellJobs[index];
+		const ShellWorkerPool::Job& job = jobs[index];
+
+		fShellJobs[pending.index].output = job.output;
+		if (pending.cacheable && job.succeeded) {
+			fShellCache.Store(job.script.String(), job.path.String(),
+				pending.stat, job.output);
+		}
+	}
+	fPendingShellJobs.clear();
+}
+
+
+void
+ExpressionEvaluator::ClearShellJobs()
+{
+	fShellJobs.clear();
+	fPendingShellJobs.clear();
+	fNextShellJob = 0;
+}
+
+
+//!	Returns whether the stat of the file of \a source could be retrieved.
+bool
+ExpressionEvaluator::_GetStat(FileSource& source)
+{
+	if (!source.hasStat) {
+		source.hasStat = true;
+		source.statValid
+			= fFileSystem.GetStat(source.path, source.stat) == B_OK;
+	}
+	return source.statValid;
+}
+
+
+/*!	Returns the information about the file of \a source that the expression
+	\a part refers to, formatted as it asks for.
+*/
+BString
+ExpressionEvaluator::_EvaluateFileInfo(FileSource& source,
+	const ExpressionTemplate::Part& part)
+{
+	const char* path = source.path;
+	const char* name = strrchr(path, '/');
+	name = name != NULL ? name + 1 : path;
+	const char* format = part.format.String();
+
+	BString result;
+	switch (part.info) {
+		case ExpressionTemplate::FILE_NAME:
+			result = name;
+			break;
+		case ExpressionTemplate::FILE_BASE_NAME:
+		case ExpressionTemplate::FILE_EXTENSION:
+		{
+			// Like RenameAction::SuffixIndex()
+			const char* dot = strrchr(name, '.');
+			if (part.info == ExpressionTemplate::FILE_EXTENSION) {
+				if (dot != NULL)
+					result = dot + 1;
+			} else
+				result.SetTo(name, dot != NULL ? dot - name : strlen(name));
+			break;
+		}
+		case ExpressionTemplate::FILE_PARENT:
+		case ExpressionTemplate::FILE_DIRECTORY:
+		{
+			BString directory(path, name > path + 1 ? name - path - 1 : 1);
+			if (part.info == ExpressionTemplate::FILE_DIRECTORY) {
+				result = directory;
+				break;
+			}
+			int32 slash = directory.FindLast('/');
+			result = directory.String() + slash + 1;
+			break;
+		}
+		case ExpressionTemplate::FILE_PATH:
+			result = path;
+			break;
+
+		case ExpressionTemplate::FILE_SIZE:
+		case ExpressionTemplate::FILE_INODE:
+		{
+			if (!_GetStat(source))
+				break;
+
+			int64 value = part.info == ExpressionTemplate::FILE_SIZE
+				? (int64)source.stat.st_size : (int64)source.stat.st_ino;
+			if (format[0] == '\0'
+				|| !format_integer(result, format, value, false))
+				result.SetToFormat("%" B_PRId64, value);
+			return result;
+		}
+		case ExpressionTemplate::FILE_MODIFIED:
+			if (_GetStat(source))
+				format_time(result, format, source.stat.st_mtime, "%Y-%m-%d");
+			return result;
+		case ExpressionTemplate::FILE_CHANGED:
+			if (_GetStat(source))
+				format_time(result, format, source.stat.st_ctime, "%Y-%m-%d");
+			return result;
+		case ExpressionTemplate::FILE_ACCESSED:
+			if (_GetStat(source))
+				format_time(result, format, source.stat.st_atime, "%Y-%m-%d");
+			return result;
+	}
+
+	if (format[0] != '\0') {
+		BString formatted;
+		if (format_string(formatted, format, result.String()))
+			result = formatted;
+	}
+	return result;
+}
+
+
+BString
+ExpressionEvaluator::_EvaluateCounter(const ExpressionTemplate::Part& part)
+{
+	int64 value = part.start + (int64)part.step
+		* (part.perDirectory ? fDirectoryCounterIndex : fCounterIndex);
+
+	BString result;
+	if (part.format.IsEmpty()
+		|| !format_integer(result, part.format.String(), value, false))
+		result.SetToFormat("%0*" B_PRId64, (int)part.width, value);
+	return result;
+}
+
+
+/*!	Returns the attribute of the file of \a source that the expression
+	\a part refers to, formatted as it asks for. The attribute is taken
+	from the cache, if the file has not changed since it was read;
+	otherwise, the file is opened, if that has not happened already.
+*/
+BString
+ExpressionEvaluator::_EvaluateAttribute(FileSource& source,
+	const ExpressionTemplate::Part& part)
+{
+	// Symlinks are traversed to read the attributes, so their own stat
+	// cannot tell whether the attributes have changed
+	bool cacheable = _GetStat(source) && !S_ISLNK(source.stat.st_mode);
+
+	const char* name = part.text.String();
+	const AttributeCache::Attribute* cached = NULL;
+	if (cacheable)
+		cached = fAttributeCache.Lookup(source.stat, name);
+
+	AttributeCache::Attribute attribute;
+	if (cached == NULL) {
+		if (!_ReadAttribute(source, name, attribute))
+			return "";
+
+		if (cacheable)
+			fAttributeCache.Store(source.stat, name, attribute);
+		cached = &attribute;
+	}
+
+	return _FormatAttribute(*cached, part.format.String());
+}
+
+
+/*!	Reads the attribute \a name from the file of \a source, which is opened
+	on first use. Returns \c false if the file could not be read; if it
+	merely does not have the attribute, \a attribute is marked as such.
+	Only the first kMaxAttributeSize bytes of an attribute are read.
+*/
+bool
+ExpressionEvaluator::_ReadAttribute(FileSource& source, const char* name,
+	AttributeCache::Attribute& attribute)
+{
+	if (source.node == NULL) {
+		source.node = fFileSystem.OpenNode(source.path);
+		if (source.node == NULL)
+			return false;
+	}
+
+	attr_info info;
+	if (source.node->GetAttributeInfo(name, info) != B_OK) {
+		attribute.exists = false;
+		return true;
+	}
+
+	size_t size = info.size > (off_t)kMaxAttributeSize
+		? kMaxAttributeSize : (size_t)info.size;
+	attribute.data.resize(size);
+
+	if (size > 0) {
+		ssize_t bytesRead = source.node->ReadAttribute(name, info.type, 0,
+			&attribute.data[0], size);
+		if (bytesRead < 0)
+			return false;
+
+		// The attribute might have been shortened in the mean time
+		attribute.data.resize(bytesRead);
+	}
+
+	attribute.exists = true;
+	attribute.type = info.type;
+	return true;
+}
+
+
+/*!	Converts \a attribute into a string. If a \a format is given, it is
+	used instead of the default one, as long as it fits the attribute: a
+	single printf() conversion for numbers, and strings that contain a
+	number, or a strftime() format for times.
+*/
+/*static*/ BString
+ExpressionEvaluator::_FormatAttribute(
+	const AttributeCache::Attribute& attribute, const char* format)
+{
+	BString result;
+	if (!attribute.exists)
+		return result;
+
+	// Taken over from Haiku's listattr.cpp
+	int64 integer;
+	bool isUnsigned;
+	if (get_integer(attribute, integer, isUnsigned)) {
+		if (format[0] == '\0'
+			|| !format_integer(result, format, integer, isUnsigned)) {
+			result.SetToFormat(isUnsigned ? "%" B_PRIu64 : "%" B_PRId64,
+				integer);
+		}
+		return result;
+	}
+
+	switch (attribute.type) {
+		case B_FLOAT_TYPE:
+		case B_DOUBLE_TYPE:
+		{
+			double value;
+			if (attribute.type == B_FLOAT_TYPE) {
+				float floatValue;
+				if (!get_value(attribute, floatValue))
+					break;
+				value = floatValue;
+			} else if (!get_value(attribute, value))
+				break;
+
+			if (format[0] == '\0' || !format_double(result, format, value))
+				result.SetToFormat("%f", value);
+			break;
+		}
+		case B_TIME_TYPE:
+		{
+			time_t time;
+			if (get_value(attribute, time))
+				format_time(result, format, time, "%c");
+			break;
+		}
+		case B_STRING_TYPE:
+		case B_MIME_STRING_TYPE:
+		case 'MSIG':
+		case 'MSDC':
+		case 'MPTH':
+			// Strings are not necessarily null terminated
+			if (!attribute.data.empty())
+				result.SetTo(&attribute.data[0], attribute.data.size());
+			if (format[0] != '\0') {
+				BString formatted;
+				if (format_string(formatted, format, result.String()))
+					result = formatted;
+			}
+			break;
+	}
+	return result;
+}
+
+
+BString
+ExpressionEvaluator::_ExecuteShell(const char* path, const char* script)
+{
+	if (fNextShellJob < fShellJobs.size()) {
+		const ShellWorkerPool::Job& job = fShellJobs[fNextShellJob];
+		if (job.path == path && job.script == script) {
+			fNextShellJob++;
+			return job.output;
+		}
+	}
+
+	struct stat stat;
+	if (!ShellResultCache::IsCacheable(script)
+		|| fFileSystem.GetStat(path, stat) != B_OK)
+		return fShellPool.Execute(path, script);
+
+	ShellWorkerPool::Job job(path, script);
+	if (!fShellCache.Lookup(script, path, stat, job.output)) {
+		fShellPool.Run(&job, 1);
+		if (job.succeeded)
+			fShellCache.Store(script, path, stat, job.output);
+	}
+	return job.output;
+}
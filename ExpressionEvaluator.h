@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef EXPRESSION_EVALUATOR_H
+#define EXPRESSION_EVALUATOR_H
+
+
+#include "AttributeCache.h"
+#include "ExpressionTemplate.h"
+#include "ShellResultCache.h"
+#include "ShellWorkerPool.h"
+
+#include <String.h>
+
+#include <sys/stat.h>
+
+#include <vector>
+
+
+class FileNode;
+class FileSystem;
+
+
+struct Replacement {
+	int32	from;
+	int32	to;
+	BString	replace;
+
+	Replacement(int32 from, int32 to, const BString& replace)
+		:
+		from(from),
+		to(to),
+		replace(replace)
+	{
+	}
+};
+
+typedef std::vector<Replacement> ReplacementList;
+
+
+/*!	Evaluates the "$(attribute)" and "$[shell script]" expressions in a
+	target name for a specific file.
+
+	A target is parsed into an ExpressionTemplate first; when many files are
+	evaluated at once, the caller can parse each target into a template of
+	its own, and pass that to both AddShellJobs(), and Evaluate().
+
+	Shell scripts are run in a ShellWorkerPool. To let them run at the same
+	time, the scripts of several files can be run in advance with
+	AddShellJobs(), and RunShellJobs(); Evaluate() then uses their output,
+	as long as it is called for the same files and targets, in the same
+	order.
+
+	The output of scripts that refer to the file, and succeeded, is kept in
+	a ShellResultCache, and reused as long as the file has not been
+	changed. Likewise, attributes are kept in an AttributeCache; a file is
+	only opened once per Evaluate() to read those of its attributes that
+	are not in the cache. The file is also only stat()ed once for all of
+	its "$(@...)" expressions.
+
+	The value of the "$(#)" counters depends on the position of the file
+	among all renamed files, and among those in its directory; it must be
+	set with SetCounters() before Evaluate().
+*/
+class ExpressionEvaluator {
+public:
+								ExpressionEvaluator(FileSystem& fileSystem);
+								~ExpressionEvaluator();
+
+			int32				Evaluate(const char* path,
+									const BString& target, BString& result,
+									int32& emptyCount,
+									ReplacementList* replacements = NULL);
+			int32				Evaluate(const char* path,
+									const ExpressionTemplate& target,
+									BString& result, int32& emptyCount,
+									ReplacementList* replacements = NULL);
+
+			void				StartPass();
+			void				SetCounters(int32 index,
+									int32 directoryIndex);
+
+			void				AddShellJobs(const char* path,
+									const BString& target);
+			void				AddShellJobs(const char* path,
+									const ExpressionTemplate& target);
+			void				RunShellJobs();
+			void				ClearShellJobs();
+
+			ShellWorkerPool&	ShellPool()
+									{ return fShellPool; }
+			ShellResultCache&	ShellCache()
+									{ return fShellCache; }
+			AttributeCache&		Attributes()
+									{ return fAttributeCache; }
+
+private:
+			struct PendingJob {
+				size_t			index;
+				bool			cacheable;
+				struct stat		stat;
+			};
+
+			struct FileSource {
+				const char*		path;
+				FileNode*		node;
+				bool			hasStat;
+				bool			statValid;
+				struct stat		stat;
+			};
+
+			bool				_GetStat(FileSource& source);
+			BString				_EvaluateFileInfo(FileSource& source,
+									const ExpressionTemplate::Part& part);
+			BString				_EvaluateCounter(
+									const ExpressionTemplate::Part& part);
+			BString				_EvaluateAttribute(FileSource& source,
+									const ExpressionTemplate::Part& part);
+			bool				_ReadAttribute(FileSource& source,
+									const char* name,
+									AttributeCache::Attribute& attribute);
+	static	BString				_FormatAttribute(
+									const AttributeCache::Attribute& attribute,
+									const char* format);
+			BString				_ExecuteShell(const char* path,
+									const char* script);
+
+private:
+			FileSystem&			fFileSystem;
+			ShellWorkerPool		fShellPool;
+			ShellResultCache	fShellCache;
+			AttributeCache		fAttributeCache;
+			std::vector<ShellWorkerPool::Job> fShellJobs;
+			std::vector<PendingJob> fPendingShellJobs;
+			size_t				fNextShellJob;
+			int32				fCounterIndex;
+			int32				fDirectoryCounterIndex;
+};
+
+
+#endif	// EXPRESSION_EVALUATOR_H
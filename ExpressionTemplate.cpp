@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "ExpressionTemplate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+static const struct {
+	const char*						name;
+	ExpressionTemplate::file_info	info;
+} kFileInfos[] = {
+	{"@name", ExpressionTemplate::FILE_NAME},
+	{"@base", ExpressionTemplate::FILE_BASE_NAME},
+	{"@ext", ExpressionTemplate::FILE_EXTENSION},
+	{"@parent", ExpressionTemplate::FILE_PARENT},
+	{"@dir", ExpressionTemplate::FILE_DIRECTORY},
+	{"@path", ExpressionTemplate::FILE_PATH},
+	{"@size", ExpressionTemplate::FILE_SIZE},
+	{"@inode", ExpressionTemplate::FILE_INODE},
+	{"@mtime", ExpressionTemplate::FILE_MODIFIED},
+	{"@ctime", ExpressionTemplate::FILE_CHANGED},
+	{"@atime", ExpressionTemplate::FILE_ACCESSED},
+};
+
+
+ExpressionTemplate::ExpressionTemplate()
+	:
+	fExpressionCount(0),
+	fHasShellScripts(false),
+	fHasCounters(false),
+	fHasLiteralDollar(false)
+{
+}
+
+
+ExpressionTemplate::ExpressionTemplate(const BString& target)
+{
+	SetTo(target);
+}
+
+
+void
+ExpressionTemplate::SetTo(const BString& target)
+{
+	_Unset(target);
+
+	int length = target.Length();
+	const char* buffer = target.String();
+	int copyIndex = 0;
+
+	// Most targets contain no expressions at all
+	if (memchr(buffer, '$', length) == NULL)
+		length = 0;
+
+	for (int index = 0; index < length - 3; index++) {
+		char open = buffer[index + 1];
+		if (buffer[index] != '$' || (open != '(' && open != '['))
+			continue;
+
+		int expressionLength = _Extract(buffer + index + 2,
+			length - index - 2, open);
+		if (expressionLength <= 0)
+			continue;
+
+		_AddPart(LITERAL, copyIndex, index - copyIndex, buffer + copyIndex,
+			index - copyIndex);
+		_AddPart(open == '[' ? SHELL : ATTRIBUTE, index, expressionLength + 3,
+			buffer + index + 2, expressionLength);
+
+		fExpressionCount++;
+		if (open == '[')
+			fHasShellScripts = true;
+
+		index += expressionLength + 2;
+		copyIndex = index + 1;
+	}
+
+	_AddPart(LITERAL, copyIndex, target.Length() - copyIndex,
+		buffer + copyIndex, target.Length() - copyIndex);
+}
+
+
+/*!	Sets the template to \a target, which contains the already parsed
+	\a replacement at each of the \a groups. The parts of the replacement
+	are just moved to the positions of the groups then, and only the text
+	between them is looked at.
+	If the groups do not contain the replacement, or if the text around
+	them could change how the target is parsed, the whole target is parsed
+	instead.
+*/
+void
+ExpressionTemplate::SetTo(const BString& target,
+	const ExpressionTemplate& replacement, const GroupList& groups)
+{
+	if (!_Compose(target, replacement, groups))
+		SetTo(target);
+}
+
+
+/*!	Returns whether \a target contains any expressions, without splitting
+	it into its parts.
+*/
+/*static*/ bool
+ExpressionTemplate::HasExpressions(const char* target)
+{
+	int length = strlen(target);
+	for (const char* dollar = strchr(target, '$'); dollar != NULL;
+			dollar = strchr(dollar + 1, '$')) {
+		int index = dollar - target;
+		if (index >= length - 3)
+			break;
+
+		char open = dollar[1];
+		if ((open == '(' || open == '[')
+			&& _Extract(dollar + 2, length - index - 2, open) > 0)
+			return true;
+	}
+	return false;
+}
+
+
+bool
+ExpressionTemplate::_Compose(const BString& target,
+	const ExpressionTemplate& replacement, const GroupList& groups)
+{
+	// A '$' outside of the expressions of the replacement could start an
+	// expression together with the text after it
+	if (replacement.fHasLiteralDollar)
+		return false;
+
+	_Unset(target);
+
+	const char* buffer = target.String();
+	int32 length = target.Length();
+	const BString& text = replacement.Target();
+	int32 position = 0;
+
+	for (int32 index = 0; index <= groups.CountItems(); index++) {
+		const Group* group = groups.ItemAt(index);
+		int32 start = group != NULL ? group->start : length;
+		if (start < position || start > length
+			|| memchr(buffer + position, '$', start - position) != NULL)
+			return false;
+
+		_AddPart(LITERAL, position, start - position, buffer + position,
+			start - position);
+		if (group == NULL)
+			break;
+
+		if (group->end - start != text.Length() || group->end > length
+			|| memcmp(buffer + start, text.String(), text.Length()) != 0)
+			return false;
+
+		for (int32 part = 0; part < replacement.CountParts(); part++) {
+			fParts.push_back(replacement.PartAt(part));
+			fParts.back().offset += start;
+		}
+		position = group->end;
+	}
+
+	int32 groupCount = groups.CountItems();
+	fExpressionCount = replacement.fExpressionCount * groupCount;
+	fHasShellScripts = replacement.fHasShellScripts && groupCount > 0;
+	fHasCounters = replacement.fHasCounters && groupCount > 0;
+	return true;
+}
+
+
+void
+ExpressionTemplate::_Unset(const BString& target)
+{
+	fTarget = target;
+	fParts.clear();
+	fExpressionCount = 0;
+	fHasShellScripts = false;
+	fHasCounters = false;
+	fHasLiteralDollar = false;
+}
+
+
+void
+ExpressionTemplate::_AddPart(part_type type, int32 offset, int32 length,
+	const char* text, int32 textLength)
+{
+	if (type == LITERAL && length == 0)
+		return;
+	if (type == LITERAL && memchr(text, '$', textLength) != NULL)
+		fHasLiteralDollar = true;
+
+	Part part;
+	part.type = type;
+	part.offset = offset;
+	part.length = length;
+	part.text.SetTo(text, textLength);
+	part.maxLength = -1;
+	part.info = FILE_NAME;
+	part.start = 1;
+	part.step = 1;
+	part.width = 0;
+	part.perDirectory = false;
+
+	if (type == ATTRIBUTE && part.text[0] == '#' && _ParseCounter(part)) {
+		part.type = COUNTER;
+		fHasCounters = true;
+	} else if (type == ATTRIBUTE) {
+		_ParseOptions(part);
+
+		// Unknown names are still read as attributes
+		if (part.text[0] == '@' && _FindFileInfo(part.text.String(), part.info))
+			part.type = FILE_INFO;
+	}
+
+	fParts.push_back(part);
+}
+
+
+/*!	Moves the format, and the maximum length from the end of the attribute
+	name to the \a part's fields. Since attribute names often contain
+	colons themselves, only options that look like one are taken.
+*/
+/*static*/ void
+ExpressionTemplate::_ParseOptions(Part& part)
+{
+	while (true) {
+		int32 colon = part.text.FindLast(':');
+		if (colon <= 0)
+			return;
+
+		const char* option = part.text.String() + colon + 1;
+		if (part.maxLength < 0 && part.format.IsEmpty() && option[0] != '\0'
+			&& strspn(option, "0123456789") == strlen(option)) {
+			part.maxLength = atoi(option);
+		} else if (part.format.IsEmpty() && option[0] == '%')
+			part.format = option;
+		else
+			return;
+
+		part.text.Truncate(colon);
+	}
+}
+
+
+/*!	Parses a counter, like "#0001,2:dir", into the \a part's fields. It
+	can be followed by the "dir" option, a format, and a maximum length.
+	Returns \c false if it is not a valid counter; it is then read as an
+	attribute, like any other name.
+*/
+/*static*/ bool
+ExpressionTemplate::_ParseCounter(Part& part)
+{
+	Part counter = part;
+	const char* spec = strchr(part.text.String(), '#') + 1;
+
+	// The start, and its number of digits
+	const char* end = spec + strspn(spec, "0123456789");
+	if (end > spec) {
+		counter.start = atoi(spec);
+		if (spec[0] == '0' && end - spec > 1)
+			counter.width = end - spec;
+	}
+
+	if (*end == ',') {
+		const char* step = end + 1;
+		const char* digits = step[0] == '-' ? step + 1 : step;
+		end = digits + strspn(digits, "0123456789");
+		if (end == digits)
+			return false;
+		counter.step = atoi(step);
+	}
+
+	// The options
+	while (*end == ':') {
+		const char* option = end + 1;
+		end = strchr(option, ':');
+		if (end == NULL)
+			end = option + strlen(option);
+
+		BString value(option, end - option);
+		if (value == "dir")
+			counter.perDirectory = true;
+		else if (value[0] == '%')
+			counter.format = value;
+		else if (!value.IsEmpty()
+			&& strspn(value.String(), "0123456789") == (size_t)value.Length())
+			counter.maxLength = atoi(value.String());
+		else
+			return false;
+	}
+	if (*end != '\0')
+		return false;
+
+	counter.text.Truncate(0);
+	part = counter;
+	return true;
+}
+
+
+/*static*/ bool
+ExpressionTemplate::_FindFileInfo(const char* name, file_info& info)
+{
+	for (size_t index = 0; index < sizeof(kFileInfos) / sizeof(kFileInfos[0]);
+			index++) {
+		if (!strcmp(name, kFileInfos[index].name)) {
+			info = kFileInfos[index].info;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*!	Returns the length of the expression in \a buffer, which follows the
+	\a open bracket, up to the matching closing bracket, or -1 if there is
+	none.
+*/
+/*static*/ int
+ExpressionTemplate::_Extract(const char* buffer, int length, char open)
+{
+	// Find end
+	char close = open == '(' ? ')' : ']';
+	int level = 0;
+	for (int index = 0; index < length; index++) {
+		if (buffer[index] == open)
+			level++;
+		else if (buffer[index] == close) {
+			level--;
+			if (level < 0)
+				return index;
+		}
+	}
+
+	return -1;
+}
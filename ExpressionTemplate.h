@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef EXPRESSION_TEMPLATE_H
+#define EXPRESSION_TEMPLATE_H
+
+
+#include "RenameAction.h"
+
+#include <String.h>
+
+#include <vector>
+
+
+/*!	A target name, split into its literal text, and the "$(attribute)" and
+	"$[shell script]" expressions in it.
+
+	The positions of the parts in the target are kept, so that the
+	positions of the expressions in an evaluated name can be computed from
+	them, without scanning the target again.
+
+	An attribute may be followed by a format, and a maximum length, like
+	in "$(Media:Year:%04d)", "$(Comment:40)", or "$(Comment:%s:40)". The
+	format starts with a '%', and cannot contain a colon; the length is a
+	number of characters.
+
+	Names starting with an '@', like "$(@mtime:%Y-%m-%d)", or "$(@size)",
+	refer to information about the file itself instead of an attribute.
+
+	"$(#)" is a counter that numbers the files. It can be given a start,
+	and a step, like in "$(#10,5)"; leading zeros of the start give the
+	number of digits, as in "$(#0001)". With the "dir" option, like in
+	"$(#1:dir)", every directory is counted separately.
+
+	If the replacement of a rename action is parsed into a template of its
+	own, the targets it produces can be set up from it and the target
+	groups the action reports, without parsing the replacement again for
+	every name.
+*/
+class ExpressionTemplate {
+public:
+	enum part_type {
+		LITERAL,
+		ATTRIBUTE,
+		FILE_INFO,
+		COUNTER,
+		SHELL
+	};
+
+	enum file_info {
+		FILE_NAME,
+		FILE_BASE_NAME,
+		FILE_EXTENSION,
+		FILE_PARENT,
+		FILE_DIRECTORY,
+		FILE_PATH,
+		FILE_SIZE,
+		FILE_INODE,
+		FILE_MODIFIED,
+		FILE_CHANGED,
+		FILE_ACCESSED
+	};
+
+	struct Part {
+		part_type				type;
+		int32					offset;
+		int32					length;
+		BString					text;
+		BString					format;
+		int32					maxLength;
+		file_info				info;
+		int32					start;
+		int32					step;
+		int32					width;
+		bool					perDirectory;
+	};
+
+								ExpressionTemplate();
+								ExpressionTemplate(const BString& target);
+
+			void				SetTo(const BString& target);
+			void				SetTo(const BString& target,
+									const ExpressionTemplate& replacement,
+									const GroupList& groups);
+
+			const BString&		Target() const
+									{ return fTarget; }
+			int32				CountParts() const
+									{ return fParts.size(); }
+			const Part&			PartAt(int32 index) const
+									{ return fParts[index]; }
+			int32				CountExpressions() const
+									{ return fExpressionCount; }
+			bool				HasShellScripts() const
+									{ return fHasShellScripts; }
+			bool				HasCounters() const
+									{ return fHasCounters; }
+
+	static	bool				HasExpressions(const char* target);
+
+private:
+			bool				_Compose(const BString& target,
+									const ExpressionTemplate& replacement,
+									const GroupList& groups);
+			void				_Unset(const BString& target);
+			void				_AddPart(part_type type, int32 offset,
+									int32 length, const char* text,
+									int32 textLength);
+	static	void				_ParseOptions(Part& part);
+	static	bool				_FindFileInfo(const char* name,
+									file_info& info);
+	static	bool				_ParseCounter(Part& part);
+	static	int					_Extract(const char* buffer, int length,
+									char open);
+
+private:
+			BString				fTarget;
+			std::vector<Part>	fParts;
+			int32				fExpressionCount;
+			bool				fHasShellScripts;
+			bool				fHasCounters;
+			bool				fHasLiteralDollar;
+};
+
+
+#endif	// EXPRESSION_TEMPLATE_H
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "FileSystem.h"
+
+#ifdef __HAIKU__
+#	include "HaikuFileSystem.h"
+#else
+#	include "PosixFileSystem.h"
+#endif
+
+
+FileNode::~FileNode()
+{
+}
+
+
+//	#pragma mark - FileSystem
+
+
+FileSystem::~FileSystem()
+{
+}
+
+
+bool
+FileSystem::Exists(const char* path)
+{
+	struct stat stat;
+	return GetStat(path, stat) == B_OK;
+}
+
+
+/*static*/ FileSystem&
+FileSystem::Default()
+{
+#ifdef __HAIKU__
+	static HaikuFileSystem sFileSystem;
+#else
+	static PosixFileSystem sFileSystem;
+#endif
+	return sFileSystem;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef FILE_SYSTEM_H
+#define FILE_SYSTEM_H
+
+
+#include <String.h>
+
+#include <fs_attr.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+
+typedef std::vector<BString> NameList;
+
+
+/*!	An opened file system node that gives access to its attributes. */
+class FileNode {
+public:
+	virtual						~FileNode();
+
+	virtual	status_t			GetAttributeInfo(const char* name,
+									attr_info& info) = 0;
+	virtual	ssize_t				ReadAttribute(const char* name, uint32 type,
+									off_t offset, void* buffer,
+									size_t size) = 0;
+};
+
+
+/*!	The file system operations the rename engine relies on. All paths are
+	absolute, and entries are never traversed when they are symlinks, with
+	the exception of OpenNode().
+*/
+class FileSystem {
+public:
+	virtual						~FileSystem();
+
+	virtual	status_t			GetStat(const char* path,
+									struct stat& stat) = 0;
+	virtual	status_t			ReadDirectory(const char* path,
+									NameList& names) = 0;
+	virtual	status_t			CreateDirectory(const char* path) = 0;
+	virtual	status_t			Rename(const char* from, const char* to) = 0;
+	virtual	FileNode*			OpenNode(const char* path) = 0;
+
+			bool				Exists(const char* path);
+
+	static	FileSystem&			Default();
+};
+
+
+#endif	// FILE_SYSTEM_H
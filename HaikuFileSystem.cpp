@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "HaikuFileSystem.h"
+
+#include <Directory.h>
+#include <Entry.h>
+#include <Node.h>
+
+#include <new>
+
+
+class HaikuFileNode : public FileNode {
+public:
+	HaikuFileNode(const char* path)
+		:
+		fNode(path)
+	{
+	}
+
+	status_t InitCheck() const
+	{
+		return fNode.InitCheck();
+	}
+
+	virtual status_t GetAttributeInfo(const char* name, attr_info& info)
+	{
+		return fNode.GetAttrInfo(name, &info);
+	}
+
+	virtual ssize_t ReadAttribute(const char* name, uint32 type, off_t offset,
+		void* buffer, size_t size)
+	{
+		return fNode.ReadAttr(name, type, offset, buffer, size);
+	}
+
+private:
+	BNode	fNode;
+};
+
+
+//	#pragma mark - HaikuFileSystem
+
+
+HaikuFileSystem::HaikuFileSystem()
+{
+}
+
+
+HaikuFileSystem::~HaikuFileSystem()
+{
+}
+
+
+status_t
+HaikuFileSystem::GetStat(const char* path, struct stat& stat)
+{
+	BEntry entry(path);
+	status_t status = entry.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	return entry.GetStat(&stat);
+}
+
+
+status_t
+HaikuFileSystem::ReadDirectory(const char* path, NameList& names)
+{
+	BDirectory directory(path);
+	status_t status = directory.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	entry_ref ref;
+	while (directory.GetNextRef(&ref) == B_OK)
+		names.push_back(ref.name);
+
+	return B_OK;
+}
+
+
+status_t
+HaikuFileSystem::CreateDirectory(const char* path)
+{
+	return create_directory(path, 0755);
+}
+
+
+status_t
+HaikuFileSystem::Rename(const char* from, const char* to)
+{
+	BEntry entry(from);
+	status_t status = entry.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	return entry.Rename(to, false);
+}
+
+
+FileNode*
+HaikuFileSystem::OpenNode(const char* path)
+{
+	HaikuFileNode* node = new(std::nothrow) HaikuFileNode(path);
+	if (node != NULL && node->InitCheck() != B_OK) {
+		delete node;
+		return NULL;
+	}
+	return node;
+}
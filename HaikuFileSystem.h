@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef HAIKU_FILE_SYSTEM_H
+#define HAIKU_FILE_SYSTEM_H
+
+
+#include "FileSystem.h"
+
+
+class HaikuFileSystem : public FileSystem {
+public:
+								HaikuFileSystem();
+	virtual						~HaikuFileSystem();
+
+	virtual	status_t			GetStat(const char* path,
+									struct stat& stat);
+	virtual	status_t			ReadDirectory(const char* path,
+									NameList& names);
+	virtual	status_t			CreateDirectory(const char* path);
+	virtual	status_t			Rename(const char* from, const char* to);
+	virtual	FileNode*			OpenNode(const char* path);
+};
+
+
+#endif	// HAIKU_FILE_SYSTEM_H
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "ParallelRenamer.h"
+
+#include <unistd.h>
+
+
+static const int32 kChunkSize = 512;
+static const int32 kMinCapacity = 256;
+
+// How long to wait before the last notification is tried again
+static const useconds_t kNotifyRetryDelay = 5000;
+
+
+ParallelRenamer::Listener::~Listener()
+{
+}
+
+
+//	#pragma mark - ParallelRenamer
+
+
+/*!	Creates a renamer with \a threadCount worker threads, or one per CPU
+	if \a threadCount is zero or less.
+*/
+ParallelRenamer::ParallelRenamer(int32 threadCount)
+	:
+	fResults(NULL),
+	fCount(0),
+	fCapacity(0),
+	fAction(NULL),
+	fListener(NULL),
+	fTracking(true),
+	fNotify(false),
+	fQuit(false),
+	fCancelled(false),
+	fChunkCount(0),
+	fNextChunk(0),
+	fFinishedCount(0),
+	fActiveCount(0)
+{
+	pthread_mutex_init(&fLock, NULL);
+	pthread_cond_init(&fWorkCondition, NULL);
+	pthread_cond_init(&fIdleCondition, NULL);
+
+	if (threadCount <= 0) {
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		threadCount = count > 0 ? count : 1;
+	}
+
+	for (int32 index = 0; index < threadCount; index++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, &ParallelRenamer::_Work, this) != 0)
+			break;
+
+		fThreads.push_back(thread);
+	}
+}
+
+
+ParallelRenamer::~ParallelRenamer()
+{
+	Cancel();
+
+	pthread_mutex_lock(&fLock);
+	fQuit = true;
+	pthread_cond_broadcast(&fWorkCondition);
+	pthread_mutex_unlock(&fLock);
+
+	for (size_t index = 0; index < fThreads.size(); index++)
+		pthread_join(fThreads[index], NULL);
+
+	pthread_cond_destroy(&fIdleCondition);
+	pthread_cond_destroy(&fWorkCondition);
+	pthread_mutex_destroy(&fLock);
+
+	delete[] fResults;
+}
+
+
+/*!	Without any worker threads, the renamer still works, but Start() then
+	renames all names before it returns.
+*/
+status_t
+ParallelRenamer::InitCheck() const
+{
+	return fThreads.empty() ? B_ERROR : B_OK;
+}
+
+
+void
+ParallelRenamer::MakeEmpty()
+{
+	Cancel();
+
+	pthread_mutex_lock(&fLock);
+	fCount = 0;
+	fChunkCount = 0;
+	fNextChunk = 0;
+	fFinishedCount = 0;
+	fFinishedChunks.clear();
+	pthread_mutex_unlock(&fLock);
+}
+
+
+void
+ParallelRenamer::AddName(const char* name)
+{
+	if (fCount == fCapacity) {
+		int32 capacity = fCapacity < kMinCapacity
+			? kMinCapacity : fCapacity * 2;
+		Result* results = new Result[capacity];
+		for (int32 index = 0; index < fCount; index++)
+			results[index].name = fResults[index].name;
+
+		delete[] fResults;
+		fResults = results;
+		fCapacity = capacity;
+	}
+
+	fResults[fCount++].name = name;
+}
+
+
+/*!	Starts renaming all names with \a action, and cancels the run that is
+	still in progress, if any. The \a action and the \a listener must stay
+	valid until the run is finished or cancelled.
+*/
+void
+ParallelRenamer::Start(const RenameAction& action, bool trackGroups,
+	Listener* listener)
+{
+	Cancel();
+
+	pthread_mutex_lock(&fLock);
+
+	fAction = &action;
+	fListener = listener;
+	fTracking = trackGroups;
+	fNotify = true;
+	fCancelled = false;
+	fChunkCount = (fCount + kChunkSize - 1) / kChunkSize;
+	fNextChunk = 0;
+	fFinishedCount = 0;
+	fFinishedChunks.clear();
+	fFinishedChunks.reserve(fChunkCount);
+
+	if (fThreads.empty()) {
+		// Do all the work ourselves
+		while (fNextChunk < fChunkCount) {
+			int32 chunk = fNextChunk++;
+			pthread_mutex_unlock(&fLock);
+
+			_RenameChunk(action, chunk);
+			_ChunkFinished(chunk);
+
+			pthread_mutex_lock(&fLock);
+		}
+	} else
+		pthread_cond_broadcast(&fWorkCondition);
+
+	pthread_mutex_unlock(&fLock);
+}
+
+
+/*!	Cancels the current run, and waits until no worker is using its
+	action or listener anymore. Chunks that have been finished before can
+	still be collected.
+*/
+void
+ParallelRenamer::Cancel()
+{
+	pthread_mutex_lock(&fLock);
+
+	fCancelled = true;
+	fNextChunk = fChunkCount;
+	while (fActiveCount > 0)
+		pthread_cond_wait(&fIdleCondition, &fLock);
+
+	fAction = NULL;
+	fListener = NULL;
+
+	pthread_mutex_unlock(&fLock);
+}
+
+
+//!	Waits until the current run is either finished or cancelled.
+void
+ParallelRenamer::Wait()
+{
+	pthread_mutex_lock(&fLock);
+
+	while (fActiveCount > 0 || fNextChunk < fChunkCount)
+		pthread_cond_wait(&fIdleCondition, &fLock);
+
+	pthread_mutex_unlock(&fLock);
+}
+
+
+/*!	Returns the range of names of a finished chunk that has not been
+	collected yet, if there is one. The results of these names are not
+	touched again until the next run is started.
+*/
+bool
+ParallelRenamer::NextFinishedChunk(int32& first, int32& end)
+{
+	pthread_mutex_lock(&fLock);
+
+	bool found = !fFinishedChunks.empty();
+	if (found) {
+		int32 chunk = fFinishedChunks.back();
+		fFinishedChunks.pop_back();
+
+		first = chunk * kChunkSize;
+		end = first + kChunkSize;
+		if (end > fCount)
+			end = fCount;
+	} else
+		fNotify = true;
+
+	pthread_mutex_unlock(&fLock);
+	return found;
+}
+
+
+//!	Returns whether the current run is finished, and all of its chunks
+//!	have been collected.
+bool
+ParallelRenamer::IsCollected()
+{
+	pthread_mutex_lock(&fLock);
+	bool collected = fFinishedCount == fChunkCount && fFinishedChunks.empty();
+	pthread_mutex_unlock(&fLock);
+
+	return collected;
+}
+
+
+/*static*/ void*
+ParallelRenamer::_Work(void* self)
+{
+	((ParallelRenamer*)self)->_Work();
+	return NULL;
+}
+
+
+void
+ParallelRenamer::_Work()
+{
+	pthread_mutex_lock(&fLock);
+
+	while (true) {
+		while (!fQuit && fNextChunk >= fChunkCount)
+			pthread_cond_wait(&fWorkCondition, &fLock);
+		if (fQuit)
+			break;
+
+		int32 chunk = fNextChunk++;
+		const RenameAction& action = *fAction;
+		fActiveCount++;
+		pthread_mutex_unlock(&fLock);
+
+		if (_RenameChunk(action, chunk))
+			_ChunkFinished(chunk);
+
+		pthread_mutex_lock(&fLock);
+		if (--fActiveCount == 0 && fNextChunk >= fChunkCount)
+			pthread_cond_broadcast(&fIdleCondition);
+	}
+
+	pthread_mutex_unlock(&fLock);
+}
+
+
+/*!	Renames all names of \a chunk. Returns false if the run has been
+	cancelled in the mean time.
+*/
+bool
+ParallelRenamer::_RenameChunk(const RenameAction& action, int32 chunk)
+{
+	int32 end = (chunk + 1) * kChunkSize;
+	if (end > fCount)
+		end = fCount;
+
+	for (int32 index = chunk * kChunkSize; index < end; index++) {
+		if (fCancelled)
+			return false;
+
+		Result& result = fResults[index];
+		result.sourceGroups.SetTracking(fTracking);
+		result.targetGroups.SetTracking(fTracking);
+		result.target = action.Rename(result.sourceGroups,
+			result.targetGroups, result.name.String());
+	}
+	return true;
+}
+
+
+/*!	Lets the listener know about the finished \a chunk, unless it has not
+	collected the previous ones yet. Intermediate notifications that cannot
+	be delivered are left to the next chunk, but the last one is tried
+	again until it is delivered, or the run is cancelled; otherwise, the
+	listener would never learn that the run is done.
+*/
+void
+ParallelRenamer::_ChunkFinished(int32 chunk)
+{
+	pthread_mutex_lock(&fLock);
+
+	if (fCancelled) {
+		pthread_mutex_unlock(&fLock);
+		return;
+	}
+
+	fFinishedChunks.push_back(chunk);
+	fFinishedCount++;
+
+	Listener* listener = fNotify ? fListener : NULL;
+	fNotify = false;
+
+	pthread_mutex_unlock(&fLock);
+
+	// The listener stays valid, as Cancel() waits for us
+	while (listener != NULL && !listener->ChunkFinished()) {
+		pthread_mutex_lock(&fLock);
+
+		// Without any threads, Start() is still running, and its caller
+		// collects the chunks right after it
+		bool retry = !fCancelled && !fThreads.empty()
+			&& fFinishedCount == fChunkCount;
+		if (!retry)
+			fNotify = !fCancelled;
+
+		pthread_mutex_unlock(&fLock);
+
+		if (!retry)
+			break;
+
+		usleep(kNotifyRetryDelay);
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef PARALLEL_RENAMER_H
+#define PARALLEL_RENAMER_H
+
+
+#include "RenameAction.h"
+
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+
+/*!	Renames a list of names with a pool of worker threads.
+
+	The names are split into chunks that the workers pick up one after the
+	other, so that a worker that is done early just takes the next chunk
+	instead of waiting for the others. Finished chunks can be collected
+	while the others are still running.
+
+	The threads are kept between runs; a new run cancels the one in
+	progress. Names may only be added while no run is in progress.
+*/
+class ParallelRenamer {
+public:
+	class Listener {
+	public:
+		virtual						~Listener();
+
+		/*!	Called from a worker thread when a chunk has been finished,
+			and there were no other finished chunks waiting to be
+			collected. Returns false if the notification could not be
+			delivered; it is then repeated with the next chunk, or, if
+			all chunks are finished, until it has been delivered.
+		*/
+		virtual	bool				ChunkFinished() = 0;
+	};
+
+	struct Result {
+		BString						name;
+		BString						target;
+		GroupList					sourceGroups;
+		GroupList					targetGroups;
+	};
+
+								ParallelRenamer(int32 threadCount = 0);
+								~ParallelRenamer();
+
+			status_t			InitCheck() const;
+			int32				CountThreads() const
+									{ return fThreads.size(); }
+
+			void				MakeEmpty();
+			void				AddName(const char* name);
+			int32				CountNames() const
+									{ return fCount; }
+			const Result&		ResultAt(int32 index) const
+									{ return fResults[index]; }
+
+			void				Start(const RenameAction& action,
+									bool trackGroups = true,
+									Listener* listener = NULL);
+			void				Cancel();
+			void				Wait();
+
+			bool				NextFinishedChunk(int32& first, int32& end);
+			bool				IsCollected();
+
+private:
+	static	void*				_Work(void* self);
+			void				_Work();
+			bool				_RenameChunk(const RenameAction& action,
+									int32 chunk);
+			void				_ChunkFinished(int32 chunk);
+
+private:
+			pthread_mutex_t		fLock;
+			pthread_cond_t		fWorkCondition;
+			pthread_cond_t		fIdleCondition;
+			std::vector<pthread_t> fThreads;
+
+			Result*				fResults;
+			int32				fCount;
+			int32				fCapacity;
+
+			const RenameAction*	fAction;
+			Listener*			fListener;
+			bool				fTracking;
+			bool				fNotify;
+			bool				fQuit;
+			std::atomic<bool>	fCancelled;
+			int32				fChunkCount;
+			int32				fNextChunk;
+			int32				fFinishedCount;
+			int32				fActiveCount;
+			std::vector<int32>	fFinishedChunks;
+};
+
+
+#endif	// PARALLEL_RENAMER_H
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "PosixFileSystem.h"
+
+#include <TypeConstants.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include <new>
+
+
+class PosixFileNode : public FileNode {
+public:
+	PosixFileNode(const char* path)
+		:
+		fPath(path)
+	{
+	}
+
+	virtual status_t GetAttributeInfo(const char* name, attr_info& info)
+	{
+		ssize_t size = getxattr(fPath.String(), _AttributeName(name).String(),
+			NULL, 0);
+		if (size < 0)
+			return B_FROM_POSIX_ERROR(errno);
+
+		info.type = B_STRING_TYPE;
+		info.size = size;
+		return B_OK;
+	}
+
+	virtual ssize_t ReadAttribute(const char* name, uint32 type, off_t offset,
+		void* buffer, size_t size)
+	{
+		if (offset == 0) {
+			ssize_t bytesRead = getxattr(fPath.String(),
+				_AttributeName(name).String(), buffer, size);
+			if (bytesRead >= 0 || errno != ERANGE)
+				return bytesRead < 0 ? B_FROM_POSIX_ERROR(errno) : bytesRead;
+		}
+
+		// Extended attributes can only be read as a whole
+		attr_info info;
+		status_t status = GetAttributeInfo(name, info);
+		if (status != B_OK)
+			return status;
+		if (offset >= info.size)
+			return 0;
+
+		char* data = (char*)malloc(info.size);
+		if (data == NULL)
+			return B_NO_MEMORY;
+
+		ssize_t bytesRead = getxattr(fPath.String(),
+			_AttributeName(name).String(), data, info.size);
+		if (bytesRead < 0) {
+			free(data);
+			return B_FROM_POSIX_ERROR(errno);
+		}
+
+		if (offset >= bytesRead)
+			bytesRead = 0;
+		else {
+			bytesRead -= offset;
+			if ((size_t)bytesRead > size)
+				bytesRead = size;
+			memcpy(buffer, data + offset, bytesRead);
+		}
+		free(data);
+		return bytesRead;
+	}
+
+private:
+	BString _AttributeName(const char* name) const
+	{
+		BString attribute("user.");
+		attribute += name;
+		return attribute;
+	}
+
+private:
+	BString	fPath;
+};
+
+
+//	#pragma mark - PosixFileSystem
+
+
+PosixFileSystem::PosixFileSystem()
+{
+}
+
+
+PosixFileSystem::~PosixFileSystem()
+{
+}
+
+
+status_t
+PosixFileSystem::GetStat(const char* path, struct stat& stat)
+{
+	if (lstat(path, &stat) != 0)
+		return B_FROM_POSIX_ERROR(errno);
+
+	return B_OK;
+}
+
+
+status_t
+PosixFileSystem::ReadDirectory(const char* path, NameList& names)
+{
+	DIR* dir = opendir(path);
+	if (dir == NULL)
+		return B_FROM_POSIX_ERROR(errno);
+
+	while (struct dirent* entry = readdir(dir)) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+
+		names.push_back(entry->d_name);
+	}
+	closedir(dir);
+	return B_OK;
+}
+
+
+status_t
+PosixFileSystem::CreateDirectory(const char* path)
+{
+	struct stat stat;
+	if (::stat(path, &stat) == 0)
+		return S_ISDIR(stat.st_mode) ? B_OK : B_NOT_A_DIRECTORY;
+
+	// Create parent directories first
+	const char* slash = strrchr(path, '/');
+	if (slash != NULL && slash != path) {
+		status_t status = CreateDirectory(BString(path, slash - path).String());
+		if (status != B_OK)
+			return status;
+	}
+
+	if (mkdir(path, 0755) != 0 && errno != EEXIST)
+		return B_FROM_POSIX_ERROR(errno);
+
+	return B_OK;
+}
+
+
+status_t
+PosixFileSystem::Rename(const char* from, const char* to)
+{
+#ifdef RENAME_NOREPLACE
+	// Like BEntry::Rename(), never replace an existing entry
+	if (renameat2(AT_FDCWD, from, AT_FDCWD, to, RENAME_NOREPLACE) == 0)
+		return B_OK;
+	if (errno != EINVAL && errno != ENOSYS)
+		return B_FROM_POSIX_ERROR(errno);
+#endif
+
+	struct stat stat;
+	if (lstat(to, &stat) == 0)
+		return B_FILE_EXISTS;
+
+	if (rename(from, to) != 0)
+		return B_FROM_POSIX_ERROR(errno);
+
+	return B_OK;
+}
+
+
+FileNode*
+PosixFileSystem::OpenNode(const char* path)
+{
+	if (access(path, F_OK) != 0)
+		return NULL;
+
+	return new(std::nothrow) PosixFileNode(path);
+}
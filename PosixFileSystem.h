@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef POSIX_FILE_SYSTEM_H
+#define POSIX_FILE_SYSTEM_H
+
+
+#include "FileSystem.h"
+
+
+/*!	File system implementation for POSIX systems other than Haiku.
+	Attributes are mapped to extended attributes in the "user." namespace,
+	and are always reported as strings.
+*/
+class PosixFileSystem : public FileSystem {
+public:
+								PosixFileSystem();
+	virtual						~PosixFileSystem();
+
+	virtual	status_t			GetStat(const char* path,
+									struct stat& stat);
+	virtual	status_t			ReadDirectory(const char* path,
+									NameList& names);
+	virtual	status_t			CreateDirectory(const char* path);
+	virtual	status_t			Rename(const char* from, const char* to);
+	virtual	FileNode*			OpenNode(const char* path);
+};
+
+
+#endif	// POSIX_FILE_SYSTEM_H
@@ -27,7 +27,6 @@ PreviewItem::PreviewItem(const entry_ref& ref)
 	:
 	BStringItem(ref.name),
 	fRef(ref),
-	fGroups(10, true),
 	fError(NO_ERROR)
 {
 }
@@ -69,16 +68,27 @@ PreviewItem::SetRenameAction(const RenameAction& action)
 {
 	fGroups.MakeEmpty();
 	fRenameGroups.MakeEmpty();
-	fError = NO_ERROR;
 
-	BString newName = action.Rename(fGroups, fRenameGroups, fRef.name);
-	if (newName != fRef.name)
-		fTarget = newName;
-	else
-		fTarget = "";
+	_SetNewName(action.Rename(fGroups, fRenameGroups, fRef.name));
+}
 
-	if (HasTarget() && !_IsValidName(fTarget))
-		fError = INVALID_NAME;
+
+/*!	Sets the result of a rename action that has been applied to the name
+	of this item elsewhere.
+*/
+void
+PreviewItem::SetRenamed(const BString& newName, const GroupList& groups,
+	const GroupList& renameGroups)
+{
+	fGroups.MakeEmpty();
+	for (int32 index = 0; index < groups.CountItems(); index++)
+		fGroups.AddItem(*groups.ItemAt(index));
+
+	fRenameGroups.MakeEmpty();
+	for (int32 index = 0; index < renameGroups.CountItems(); index++)
+		fRenameGroups.AddItem(*renameGroups.ItemAt(index));
+
+	_SetNewName(newName);
 }
 
 
@@ -227,7 +237,7 @@ PreviewItem::Compare(const void* _a, const void* _b)
 
 void
 PreviewItem::_DrawGroupedText(BView* owner, BRect frame, float x,
-	const BString& text, const BObjectList<Group>& groups, int32 first)
+	const BString& text, const GroupList& groups, int32 first)
 {
 	uint32 count = text.CountChars();
 	BPoint sizes[count];
@@ -288,6 +298,21 @@ PreviewItem::_DrawGroup(BView* owner, uint32 groupIndex, BRect frame,
 }
 
 
+void
+PreviewItem::_SetNewName(const BString& newName)
+{
+	fError = NO_ERROR;
+
+	if (newName != fRef.name)
+		fTarget = newName;
+	else
+		fTarget = "";
+
+	if (HasTarget() && !_IsValidName(fTarget))
+		fError = INVALID_NAME;
+}
+
+
 bool
 PreviewItem::_IsValidName(const char* name) const
 {
@@ -6,13 +6,10 @@
 
 
 #include <Entry.h>
-#include <ObjectList.h>
 #include <StringItem.h>
 #include <String.h>
 
-
-class Group;
-class RenameAction;
+#include "RenameAction.h"
 
 
 enum Error {
@@ -29,6 +26,9 @@ public:
 								PreviewItem(const entry_ref& ref);
 
 			void				SetRenameAction(const RenameAction& action);
+			void				SetRenamed(const BString& newName,
+									const GroupList& groups,
+									const GroupList& renameGroups);
 			status_t			Rename();
 
 			const entry_ref&	Ref() const
@@ -38,6 +38,8 @@ public:
 			void				SetTarget(const BString& target);
 			bool				HasTarget() const
 									{ return !fTarget.IsEmpty(); }
+			const GroupList&	RenameGroups() const
+									{ return fRenameGroups; }
 			void				UpdateProcessed(int32 from, int32 to,
 									const BString& replace);
 
@@ -57,17 +59,18 @@ public:
 private:
 			void				_DrawGroupedText(BView* owner, BRect frame,
 									float x, const BString& text,
-									const BObjectList<Group>& groups,
+									const GroupList& groups,
 									int32 first);
 			void				_DrawGroup(BView* owner, uint32 groupIndex,
 									BRect frame, float start, float end);
+			void				_SetNewName(const BString& newName);
 			bool				_IsValidName(const char* name) const;
 
 private:
 			entry_ref			fRef;
 			BString				fTarget;
-			BObjectList<Group>	fGroups;
-			BObjectList<Group>	fRenameGroups;
+			GroupList			fGroups;
+			GroupList			fRenameGroups;
 			::Error				fError;
 };
 
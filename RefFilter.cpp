@@ -3,20 +3,11 @@
  */
 
 
-#include "RefModel.h"
+#include "RefFilter.h"
 
-#include <Autolock.h>
-#include <Directory.h>
-
-#include <stdio.h>
 #include <string.h>
 
 
-#define REMOVED_CHANGED 	0x01
-#define FILTER_CHANGED		0x02
-#define RECURSIVE_CHANGED	0x04
-
-
 //	#pragma mark - RefFilter
 
 
@@ -39,7 +30,7 @@ FilesOnlyFilter::~FilesOnlyFilter()
 
 
 bool
-FilesOnlyFilter::Accept(const entry_ref& ref, bool directory) const
+FilesOnlyFilter::Accept(const char* name, bool directory) const
 {
 	return !directory;
 }
@@ -59,7 +50,7 @@ FoldersOnlyFilter::~FoldersOnlyFilter()
 
 
 bool
-FoldersOnlyFilter::Accept(const entry_ref& ref, bool directory) const
+FoldersOnlyFilter::Accept(const char* name, bool directory) const
 {
 	return directory;
 }
@@ -81,9 +72,9 @@ TextFilter::~TextFilter()
 
 
 bool
-TextFilter::Accept(const entry_ref& ref, bool directory) const
+TextFilter::Accept(const char* name, bool directory) const
 {
-	return strcasestr(ref.name, fSearchText.String()) != NULL;
+	return strcasestr(name, fSearchText.String()) != NULL;
 }
 
 
@@ -91,28 +82,23 @@ TextFilter::Accept(const entry_ref& ref, bool directory) const
 
 
 RegularExpressionFilter::RegularExpressionFilter(const char* pattern)
-	:
-	fValidPattern(false)
 {
-	if (regcomp(&fCompiledPattern, pattern, REG_EXTENDED) == 0)
-		fValidPattern = true;
+	fExpression.SetPattern(pattern);
 }
 
 
 RegularExpressionFilter::~RegularExpressionFilter()
 {
-	if (fValidPattern)
-		regfree(&fCompiledPattern);
 }
 
 
 bool
-RegularExpressionFilter::Accept(const entry_ref& ref, bool directory) const
+RegularExpressionFilter::Accept(const char* name, bool directory) const
 {
-	if (!fValidPattern)
+	if (!fExpression.IsValid())
 		return true;
 
-	return regexec(&fCompiledPattern, ref.name, 0, NULL, 0) == 0;
+	return fExpression.Match(name, strlen(name), NULL, 0);
 }
 
 
@@ -133,9 +119,9 @@ ReverseFilter::~ReverseFilter()
 
 
 bool
-ReverseFilter::Accept(const entry_ref& ref, bool directory) const
+ReverseFilter::Accept(const char* name, bool directory) const
 {
-	return !fFilter->Accept(ref, directory);
+	return !fFilter->Accept(name, directory);
 }
 
 
@@ -163,10 +149,10 @@ AndFilter::AddFilter(RefFilter* filter)
 
 
 bool
-AndFilter::Accept(const entry_ref& ref, bool directory) const
+AndFilter::Accept(const char* name, bool directory) const
 {
 	for (int32 index = 0; index < fFilters.CountItems(); index++) {
-		if (!fFilters.ItemAt(index)->Accept(ref, directory))
+		if (!fFilters.ItemAt(index)->Accept(name, directory))
 			return false;
 	}
 	return true;
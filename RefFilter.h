@@ -5,18 +5,17 @@
 #define REF_FILTER_H
 
 
-#include <Entry.h>
+#include "RegularExpression.h"
+
 #include <ObjectList.h>
 #include <String.h>
 
-#include <regex.h>
-
 
 class RefFilter {
 public:
 	virtual						~RefFilter();
 
-	virtual	bool				Accept(const entry_ref& ref,
+	virtual	bool				Accept(const char* name,
 									bool directory) const = 0;
 };
 
@@ -26,7 +25,7 @@ public:
 								FilesOnlyFilter();
 	virtual						~FilesOnlyFilter();
 
-	virtual	bool				Accept(const entry_ref& ref,
+	virtual	bool				Accept(const char* name,
 									bool directory) const;
 };
 
@@ -36,7 +35,7 @@ public:
 								FoldersOnlyFilter();
 	virtual						~FoldersOnlyFilter();
 
-	virtual	bool				Accept(const entry_ref& ref,
+	virtual	bool				Accept(const char* name,
 									bool directory) const;
 };
 
@@ -46,7 +45,7 @@ public:
 								TextFilter(const char* text);
 	virtual						~TextFilter();
 
-	virtual	bool				Accept(const entry_ref& ref,
+	virtual	bool				Accept(const char* name,
 									bool directory) const;
 
 private:
@@ -59,12 +58,11 @@ public:
 								RegularExpressionFilter(const char* pattern);
 	virtual						~RegularExpressionFilter();
 
-	virtual	bool				Accept(const entry_ref& ref,
+	virtual	bool				Accept(const char* name,
 									bool directory) const;
 
 private:
-			regex_t				fCompiledPattern;
-			bool				fValidPattern;
+			RegularExpression	fExpression;
 };
 
 
@@ -73,7 +71,7 @@ public:
 								ReverseFilter(RefFilter* filter);
 	virtual						~ReverseFilter();
 
-	virtual	bool				Accept(const entry_ref& ref,
+	virtual	bool				Accept(const char* name,
 									bool directory) const;
 
 private:
@@ -90,7 +88,7 @@ public:
 			bool				IsEmpty() const
 									{ return fFilters.IsEmpty(); }
 
-	virtual	bool				Accept(const entry_ref& ref,
+	virtual	bool				Accept(const char* name,
 									bool directory) const;
 
 private:
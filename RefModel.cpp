@@ -292,7 +292,7 @@ RefModel::_Filter(BMessage& update, const EntrySet& entries, RefFilter* filter,
 				continue;
 			}
 		}
-		if (fFilter != NULL && !filter->Accept(ref, directory)) {
+		if (fFilter != NULL && !filter->Accept(ref.name, directory)) {
 			_RemoveFromFilter(update, ref);
 			continue;
 		}
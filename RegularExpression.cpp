@@ -0,0 +1,1152 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "RegularExpression.h"
+
+#include <UnicodeChar.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const int32 kMaxInstructions = 4096;
+static const int32 kMaxRepetition = 255;
+static const int32 kMaxNesting = 128;
+static const int32 kStackBufferSize = 1024;
+
+// Invalid UTF-8 bytes are mapped above the Unicode range, so that they only
+// match themselves
+static const uint32 kInvalidCharacter = 0x110000;
+
+enum named_class {
+	NAMED_ALPHA		= 0x01,
+	NAMED_UPPER		= 0x02,
+	NAMED_LOWER		= 0x04
+};
+
+enum parse_error {
+	PARSE_OK,
+	PARSE_UNSUPPORTED,
+	PARSE_INVALID
+};
+
+
+static uint32
+decode_character(const char* string, int32 position, int32 length,
+	int32& bytes)
+{
+	uint8 c = string[position];
+	bytes = 1;
+	if (c < 0x80)
+		return c;
+
+	int32 count = 0;
+	if (c >= 0xf0 && c < 0xf8)
+		count = 4;
+	else if (c >= 0xe0 && c < 0xf0)
+		count = 3;
+	else if (c >= 0xc0 && c < 0xe0)
+		count = 2;
+	if (count == 0 || position + count > length)
+		return kInvalidCharacter + c;
+
+	for (int32 index = 1; index < count; index++) {
+		if ((string[position + index] & 0xc0) != 0x80)
+			return kInvalidCharacter + c;
+	}
+
+	bytes = count;
+	return BUnicodeChar::FromUTF8(string + position);
+}
+
+
+static inline uint32
+to_lower(uint32 c)
+{
+	if (c < 0x80)
+		return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+	if (c >= kInvalidCharacter)
+		return c;
+
+	return BUnicodeChar::ToLower(c);
+}
+
+
+static inline bool
+class_contains(const uint32* ascii, uint32 c)
+{
+	return (ascii[c / 32] & (1UL << (c % 32))) != 0;
+}
+
+
+//	#pragma mark - Parser
+
+
+class RegularExpression::Parser {
+public:
+	Parser(const char* pattern, NodeList& nodes, ClassList& classes,
+		NameList& names, bool caseInsensitive)
+		:
+		fPattern(pattern),
+		fPosition(0),
+		fLength(strlen(pattern)),
+		fNodes(nodes),
+		fClasses(classes),
+		fNames(names),
+		fCaseInsensitive(caseInsensitive),
+		fGroupCount(0),
+		fNesting(0),
+		fError(PARSE_OK)
+	{
+	}
+
+	/*!	Parses the whole pattern.
+		\return the index of the root node, or -1 if the pattern could not
+			be parsed; Error() then tells if it was invalid, or just
+			unsupported.
+	*/
+	int32 Parse()
+	{
+		int32 root = _ParseAlternation();
+		if (root >= 0 && fPosition < fLength) {
+			// An unmatched ')'
+			return _Fail(PARSE_UNSUPPORTED);
+		}
+		return root;
+	}
+
+	parse_error Error() const
+	{
+		return fError;
+	}
+
+	int32 CountGroups() const
+	{
+		return fGroupCount;
+	}
+
+private:
+	int32 _ParseAlternation()
+	{
+		if (++fNesting > kMaxNesting)
+			return _Fail(PARSE_UNSUPPORTED);
+
+		int32 node = _ParseConcatenation();
+		if (node >= 0 && _Peek() == '|') {
+			int32 alternation = _AddNode(ALTERNATION);
+			fNodes[alternation].children.push_back(node);
+
+			while (node >= 0 && _Peek() == '|') {
+				fPosition++;
+				node = _ParseConcatenation();
+				if (node >= 0)
+					fNodes[alternation].children.push_back(node);
+			}
+			if (node >= 0)
+				node = alternation;
+		}
+
+		fNesting--;
+		return node;
+	}
+
+	int32 _ParseConcatenation()
+	{
+		int32 concatenation = _AddNode(CONCATENATION);
+		while (fPosition < fLength && _Peek() != '|' && _Peek() != ')') {
+			int32 node = _ParseRepetition();
+			if (node < 0)
+				return -1;
+
+			fNodes[concatenation].children.push_back(node);
+		}
+		return concatenation;
+	}
+
+	int32 _ParseRepetition()
+	{
+		int32 node = _ParseAtom();
+		while (node >= 0) {
+			int32 minimum;
+			int32 maximum;
+			switch (_Peek()) {
+				case '*':
+					minimum = 0;
+					maximum = -1;
+					break;
+				case '+':
+					minimum = 1;
+					maximum = -1;
+					break;
+				case '?':
+					minimum = 0;
+					maximum = 1;
+					break;
+				case '{':
+					if (!_ParseBound(minimum, maximum))
+						return -1;
+					break;
+				default:
+					return node;
+			}
+			fPosition++;
+
+			int32 repetition = _AddNode(REPETITION);
+			fNodes[repetition].minimum = minimum;
+			fNodes[repetition].maximum = maximum;
+			fNodes[repetition].children.push_back(node);
+			node = repetition;
+		}
+		return node;
+	}
+
+	int32 _ParseAtom()
+	{
+		char c = _Peek();
+		switch (c) {
+			case '(':
+			{
+				fPosition++;
+				int32 group = -1;
+				if (_Peek() == '?') {
+					// A named, or a non-capturing group
+					if (!_ParseGroupName(group))
+						return -1;
+				} else
+					group = _AddGroup(NULL, 0);
+
+				int32 node = _Peek() == ')'
+					? _AddNode(EMPTY) : _ParseAlternation();
+				if (node < 0)
+					return -1;
+				if (_Peek() != ')')
+					return _Fail(PARSE_INVALID);
+
+				fPosition++;
+				if (group < 0)
+					return node;
+
+				fNodes[group].children.push_back(node);
+				return group;
+			}
+			case '.':
+				fPosition++;
+				return _AddNode(ANY_CHARACTER);
+			case '^':
+				fPosition++;
+				return _AddNode(LINE_START);
+			case '$':
+				fPosition++;
+				return _AddNode(LINE_END);
+			case '[':
+				fPosition++;
+				return _ParseClass();
+			case '*':
+			case '+':
+			case '?':
+			case '{':
+				// Implementations differ in how they treat these
+				return _Fail(PARSE_UNSUPPORTED);
+			case '\\':
+				fPosition++;
+				if (fPosition == fLength)
+					return _Fail(PARSE_INVALID);
+				if (isalnum(_Peek()) || strchr("<>`'", _Peek()) != NULL) {
+					// Back references, and GNU extensions like the word,
+					// and buffer anchors
+					return _Fail(PARSE_UNSUPPORTED);
+				}
+				break;
+		}
+
+		int32 bytes;
+		uint32 character = decode_character(fPattern, fPosition, fLength,
+			bytes);
+		fPosition += bytes;
+
+		if (fCaseInsensitive)
+			character = to_lower(character);
+		return _AddNode(CHARACTER, character);
+	}
+
+	int32 _ParseClass()
+	{
+		CharacterClass set;
+		set.negated = false;
+		memset(set.ascii, 0, sizeof(set.ascii));
+		set.named = 0;
+
+		if (_Peek() == '^') {
+			set.negated = true;
+			fPosition++;
+		}
+
+		bool first = true;
+		while (true) {
+			if (fPosition >= fLength)
+				return _Fail(PARSE_INVALID);
+
+			char c = _Peek();
+			if (c == ']' && !first) {
+				fPosition++;
+				break;
+			}
+			first = false;
+
+			if (c == '[' && fPosition + 1 < fLength) {
+				char type = fPattern[fPosition + 1];
+				if (type == ':') {
+					if (!_ParseNamedClass(set))
+						return -1;
+					continue;
+				}
+				if (type == '=' || type == '.') {
+					// Equivalence classes, and collating symbols
+					return _Fail(PARSE_UNSUPPORTED);
+				}
+			}
+
+			int32 bytes;
+			uint32 from = decode_character(fPattern, fPosition, fLength,
+				bytes);
+			fPosition += bytes;
+
+			uint32 to = from;
+			if (_Peek() == '-' && fPosition + 1 < fLength
+				&& fPattern[fPosition + 1] != ']') {
+				fPosition++;
+				to = decode_character(fPattern, fPosition, fLength, bytes);
+				fPosition += bytes;
+				if (to < from)
+					return _Fail(PARSE_INVALID);
+			}
+
+			for (; from <= to && from < 0x80; from++)
+				set.ascii[from / 32] |= 1UL << (from % 32);
+			if (from <= to) {
+				set.ranges.push_back(from);
+				set.ranges.push_back(to);
+			}
+		}
+
+		fClasses.push_back(set);
+		return _AddNode(CLASS, fClasses.size() - 1);
+	}
+
+	/*!	Parses "?<name>", "?P<name>", or "?:" after an opening parenthesis.
+		\a group is set to the new group node, or -1 for a non-capturing
+		group.
+	*/
+	bool _ParseGroupName(int32& group)
+	{
+		fPosition++;
+		if (_Peek() == ':') {
+			fPosition++;
+			group = -1;
+			return true;
+		}
+
+		if (_Peek() == 'P')
+			fPosition++;
+		if (_Peek() != '<') {
+			_Fail(PARSE_UNSUPPORTED);
+			return false;
+		}
+
+		const char* name = fPattern + ++fPosition;
+		int32 length = 0;
+		while (isalnum(name[length]) || name[length] == '_')
+			length++;
+		if (length == 0 || isdigit(name[0]) || name[length] != '>') {
+			_Fail(PARSE_INVALID);
+			return false;
+		}
+
+		for (size_t index = 0; index < fNames.size(); index++) {
+			if (fNames[index].Length() == length
+				&& memcmp(fNames[index].String(), name, length) == 0) {
+				// Names must be unique
+				_Fail(PARSE_INVALID);
+				return false;
+			}
+		}
+
+		fPosition += length + 1;
+		group = _AddGroup(name, length);
+		return true;
+	}
+
+	int32 _AddGroup(const char* name, int32 length)
+	{
+		fNames.push_back(BString(name, length));
+		return _AddNode(GROUP, ++fGroupCount);
+	}
+
+	bool _ParseNamedClass(CharacterClass& set)
+	{
+		const char* start = fPattern + fPosition + 2;
+		const char* end = strstr(start, ":]");
+		if (end == NULL) {
+			_Fail(PARSE_INVALID);
+			return false;
+		}
+
+		BString name(start, end - start);
+		int (*function)(int) = NULL;
+		if (name == "alpha") {
+			function = isalpha;
+			set.named |= NAMED_ALPHA;
+		} else if (name == "alnum") {
+			function = isalnum;
+			set.named |= NAMED_ALPHA;
+		} else if (name == "upper") {
+			function = isupper;
+			set.named |= NAMED_UPPER;
+		} else if (name == "lower") {
+			function = islower;
+			set.named |= NAMED_LOWER;
+		} else if (name == "digit")
+			function = isdigit;
+		else if (name == "xdigit")
+			function = isxdigit;
+		else if (name == "space")
+			function = isspace;
+		else if (name == "blank")
+			function = isblank;
+		else if (name == "punct")
+			function = ispunct;
+		else if (name == "print")
+			function = isprint;
+		else if (name == "graph")
+			function = isgraph;
+		else if (name == "cntrl")
+			function = iscntrl;
+		else {
+			_Fail(PARSE_INVALID);
+			return false;
+		}
+
+		for (uint32 c = 0; c < 0x80; c++) {
+			if (function(c))
+				set.ascii[c / 32] |= 1UL << (c % 32);
+		}
+
+		fPosition = end + 2 - fPattern;
+		return true;
+	}
+
+	bool _ParseBound(int32& minimum, int32& maximum)
+	{
+		const char* start = fPattern + fPosition + 1;
+		char* end;
+		if (!isdigit(start[0])) {
+			_Fail(PARSE_UNSUPPORTED);
+			return false;
+		}
+
+		minimum = strtol(start, &end, 10);
+		maximum = minimum;
+		if (end[0] == ',') {
+			if (isdigit(end[1]))
+				maximum = strtol(end + 1, &end, 10);
+			else {
+				maximum = -1;
+				end++;
+			}
+		}
+		if (end[0] != '}' || minimum > kMaxRepetition
+			|| maximum > kMaxRepetition
+			|| (maximum >= 0 && maximum < minimum)) {
+			_Fail(PARSE_UNSUPPORTED);
+			return false;
+		}
+
+		// Leave the position at the closing brace
+		fPosition = end - fPattern;
+		return true;
+	}
+
+	char _Peek() const
+	{
+		return fPosition < fLength ? fPattern[fPosition] : '\0';
+	}
+
+	int32 _AddNode(node_type type, uint32 value = 0)
+	{
+		Node node;
+		node.type = type;
+		node.value = value;
+		node.minimum = 0;
+		node.maximum = 0;
+		fNodes.push_back(node);
+		return fNodes.size() - 1;
+	}
+
+	int32 _Fail(parse_error error)
+	{
+		if (fError == PARSE_OK)
+			fError = error;
+		return -1;
+	}
+
+private:
+	const char*			fPattern;
+	int32				fPosition;
+	int32				fLength;
+	NodeList&			fNodes;
+	ClassList&			fClasses;
+	NameList&			fNames;
+	bool				fCaseInsensitive;
+	int32				fGroupCount;
+	int32				fNesting;
+	parse_error			fError;
+};
+
+
+//	#pragma mark - ThreadList
+
+
+struct RegularExpression::ThreadList {
+	int32*				pcs;
+	int32*				captures;
+	uint32*				marks;
+	uint32				generation;
+	int32				count;
+	int32				captureCount;
+
+	int32* CapturesAt(int32 index) const
+	{
+		return captures + index * captureCount;
+	}
+};
+
+
+//	#pragma mark - RegularExpression
+
+
+RegularExpression::RegularExpression()
+	:
+	fGroupCount(0),
+	fSlotCount(0),
+	fHasFirstBytes(false),
+	fCaseInsensitive(false),
+	fValid(false),
+	fUseFallback(false)
+{
+}
+
+
+RegularExpression::~RegularExpression()
+{
+	_Unset();
+}
+
+
+status_t
+RegularExpression::SetPattern(const char* pattern, bool caseInsensitive)
+{
+	_Unset();
+	fCaseInsensitive = caseInsensitive;
+
+	NodeList nodes;
+	Parser parser(pattern, nodes, fClasses, fGroupNames, caseInsensitive);
+	int32 root = parser.Parse();
+	if (root >= 0) {
+		fGroupCount = parser.CountGroups();
+		fSlotCount = 2 * (fGroupCount + 1);
+
+		_Emit(OP_SAVE, 0);
+		if (_Compile(nodes, root) && _Emit(OP_SAVE, 1) >= 0
+			&& _Emit(OP_MATCH) >= 0) {
+			_ComputeFirstBytes();
+			fValid = true;
+			return B_OK;
+		}
+	} else if (parser.Error() == PARSE_INVALID) {
+		_Unset();
+		return B_BAD_VALUE;
+	}
+
+	// The pattern is too complex, or uses unsupported constructs
+	fProgram.clear();
+	fClasses.clear();
+	fGroupNames.clear();
+
+	if (regcomp(&fFallback, pattern,
+			REG_EXTENDED | (caseInsensitive ? REG_ICASE : 0)) != 0) {
+		_Unset();
+		return B_BAD_VALUE;
+	}
+
+	fGroupCount = fFallback.re_nsub;
+	fUseFallback = true;
+	fValid = true;
+	return B_OK;
+}
+
+
+/*!	Finds the leftmost-longest match in the first \a length bytes of
+	\a string, and fills in up to \a groupCount \a groups; the first one is
+	the whole match. Groups that did not participate in the match are set
+	to -1.
+	The search starts at \a from, but all offsets are relative to the
+	start of the string; "^" only matches at its very start.
+*/
+bool
+RegularExpression::Match(const char* string, int32 length,
+	regmatch_t* groups, int32 groupCount, int32 from) const
+{
+	if (!fValid || from > length)
+		return false;
+	if (fUseFallback)
+		return _MatchFallback(string, length, groups, groupCount, from);
+
+	int32 size = fProgram.size();
+	int32 captureCount = fSlotCount;
+
+	// Get the memory for two thread lists, and the best match in one go
+	int32 stackBuffer[kStackBufferSize];
+	int32 needed = 2 * (size * (captureCount + 2)) + 2 * captureCount;
+	int32* buffer = stackBuffer;
+	if (needed > kStackBufferSize) {
+		buffer = (int32*)malloc(needed * sizeof(int32));
+		if (buffer == NULL)
+			return false;
+	}
+
+	ThreadList lists[2];
+	int32* next = buffer;
+	for (int32 index = 0; index < 2; index++) {
+		ThreadList& list = lists[index];
+		list.pcs = next;
+		list.marks = (uint32*)next + size;
+		list.captures = next + 2 * size;
+		list.generation = index;
+		list.count = 0;
+		list.captureCount = captureCount;
+		memset(list.marks, 0xff, size * sizeof(uint32));
+		next += size * (captureCount + 2);
+	}
+	int32* seed = next;
+	int32* best = next + captureCount;
+
+	ThreadList* current = &lists[0];
+	ThreadList* following = &lists[1];
+	uint32 generation = 2;
+	bool matched = false;
+	int32 position = from;
+
+	while (true) {
+		if (!matched && current->count == 0 && fHasFirstBytes) {
+			// Skip everything that cannot start a match
+			while (position < length
+				&& !class_contains(fFirstBytes, (uint8)string[position]))
+				position++;
+			if (position == length)
+				break;
+		}
+		if (!matched) {
+			// Start a new match at this position, with the lowest priority
+			for (int32 index = 0; index < captureCount; index++)
+				seed[index] = -1;
+			_AddThread(*current, 0, seed, position, length);
+		}
+		if (current->count == 0 && matched)
+			break;
+
+		int32 bytes = 0;
+		uint32 c = kInvalidCharacter;
+		if (position < length) {
+			c = decode_character(string, position, length, bytes);
+			if (fCaseInsensitive)
+				c = to_lower(c);
+		}
+
+		following->count = 0;
+		following->generation = generation++;
+
+		for (int32 index = 0; index < current->count; index++) {
+			int32* captures = current->CapturesAt(index);
+			if (matched && captures[0] > best[0])
+				continue;
+
+			int32 pc = current->pcs[index];
+			const Instruction& instruction = fProgram[pc];
+			bool advance = false;
+
+			switch (instruction.op) {
+				case OP_MATCH:
+					if (!matched || captures[0] < best[0]
+						|| (captures[0] == best[0] && captures[1] > best[1])) {
+						memcpy(best, captures, captureCount * sizeof(int32));
+						matched = true;
+					}
+					break;
+				case OP_CHARACTER:
+					advance = c == instruction.value;
+					break;
+				case OP_ANY_CHARACTER:
+					advance = position < length;
+					break;
+				case OP_CLASS:
+					advance = position < length
+						&& _MatchClass(fClasses[instruction.value], c);
+					break;
+				default:
+					break;
+			}
+
+			if (advance) {
+				_AddThread(*following, pc + 1, captures, position + bytes,
+					length);
+			}
+		}
+
+		if (matched && groupCount == 0)
+			break;
+		if (position >= length)
+			break;
+
+		ThreadList* swap = current;
+		current = following;
+		following = swap;
+		position += bytes;
+	}
+
+	if (matched) {
+		for (int32 index = 0; index < groupCount; index++) {
+			if (index <= fGroupCount && best[index * 2] >= 0
+				&& best[index * 2 + 1] >= 0) {
+				groups[index].rm_so = best[index * 2];
+				groups[index].rm_eo = best[index * 2 + 1];
+			} else {
+				groups[index].rm_so = -1;
+				groups[index].rm_eo = -1;
+			}
+		}
+	}
+
+	if (buffer != stackBuffer)
+		free(buffer);
+
+	return matched;
+}
+
+
+/*!	Returns the index of the group with the given \a name, or -1 if there
+	is no such group.
+*/
+int32
+RegularExpression::GroupIndex(const char* name, int32 length) const
+{
+	if (length < 0)
+		length = strlen(name);
+
+	for (size_t index = 0; index < fGroupNames.size(); index++) {
+		const BString& groupName = fGroupNames[index];
+		if (groupName.Length() == length
+			&& memcmp(groupName.String(), name, length) == 0)
+			return index + 1;
+	}
+	return -1;
+}
+
+
+void
+RegularExpression::_Unset()
+{
+	if (fUseFallback)
+		regfree(&fFallback);
+
+	fProgram.clear();
+	fClasses.clear();
+	fGroupNames.clear();
+	fGroupCount = 0;
+	fSlotCount = 0;
+	fHasFirstBytes = false;
+	fValid = false;
+	fUseFallback = false;
+}
+
+
+bool
+RegularExpression::_Compile(const NodeList& nodes, int32 index)
+{
+	const Node& node = nodes[index];
+
+	switch (node.type) {
+		case EMPTY:
+			return true;
+		case CHARACTER:
+			return _Emit(OP_CHARACTER, node.value) >= 0;
+		case ANY_CHARACTER:
+			return _Emit(OP_ANY_CHARACTER) >= 0;
+		case CLASS:
+			return _Emit(OP_CLASS, node.value) >= 0;
+		case LINE_START:
+			return _Emit(OP_LINE_START) >= 0;
+		case LINE_END:
+			return _Emit(OP_LINE_END) >= 0;
+
+		case CONCATENATION:
+			for (size_t child = 0; child < node.children.size(); child++) {
+				if (!_Compile(nodes, node.children[child]))
+					return false;
+			}
+			return true;
+
+		case ALTERNATION:
+		{
+			std::vector<int32> jumps;
+			int32 count = node.children.size();
+			for (int32 child = 0; child < count; child++) {
+				int32 split = -1;
+				if (child < count - 1) {
+					split = _Emit(OP_SPLIT);
+					if (split < 0)
+						return false;
+				}
+
+				if (!_Compile(nodes, node.children[child]))
+					return false;
+
+				if (split >= 0) {
+					int32 jump = _Emit(OP_JUMP);
+					if (jump < 0)
+						return false;
+
+					jumps.push_back(jump);
+					fProgram[split].alternative = fProgram.size();
+				}
+			}
+			for (size_t jump = 0; jump < jumps.size(); jump++)
+				fProgram[jumps[jump]].next = fProgram.size();
+			return true;
+		}
+
+		case GROUP:
+			return _Emit(OP_SAVE, node.value * 2) >= 0
+				&& _Compile(nodes, node.children[0])
+				&& _Emit(OP_SAVE, node.value * 2 + 1) >= 0;
+
+		case REPETITION:
+		{
+			int32 child = node.children[0];
+			for (int32 count = 0; count < node.minimum; count++) {
+				if (!_Compile(nodes, child))
+					return false;
+			}
+
+			// Like POSIX, only report an empty iteration if it is the
+			// first one
+			bool nullable = _IsNullable(nodes, child);
+
+			if (node.maximum < 0) {
+				int32 optional = -1;
+				if (node.minimum == 0 && nullable) {
+					optional = _Emit(OP_SPLIT);
+					if (optional < 0 || !_Compile(nodes, child))
+						return false;
+				}
+
+				// Greedy loop: split into the body, or leave
+				int32 split = _Emit(OP_SPLIT);
+				if (split < 0 || !_CompileIteration(nodes, child, !nullable))
+					return false;
+
+				int32 jump = _Emit(OP_JUMP);
+				if (jump < 0)
+					return false;
+
+				fProgram[jump].next = split;
+				fProgram[split].alternative = fProgram.size();
+				if (optional >= 0)
+					fProgram[optional].alternative = fProgram.size();
+				return true;
+			}
+
+			std::vector<int32> splits;
+			for (int32 count = node.minimum; count < node.maximum; count++) {
+				int32 split = _Emit(OP_SPLIT);
+				if (split < 0 || !_CompileIteration(nodes, child,
+						!nullable || count == 0))
+					return false;
+
+				splits.push_back(split);
+			}
+			for (size_t split = 0; split < splits.size(); split++)
+				fProgram[splits[split]].alternative = fProgram.size();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*!	Collects the bytes a match can start with, so that Match() can quickly
+	skip over everything else. This is only possible if the pattern cannot
+	match an empty string, and does not start with an anchor.
+*/
+void
+RegularExpression::_ComputeFirstBytes()
+{
+	memset(fFirstBytes, 0, sizeof(fFirstBytes));
+
+	std::vector<bool> visited(fProgram.size(), false);
+	fHasFirstBytes = _AddFirstBytes(0, visited);
+}
+
+
+bool
+RegularExpression::_AddFirstBytes(int32 pc, std::vector<bool>& visited)
+{
+	if (visited[pc])
+		return true;
+	visited[pc] = true;
+
+	const Instruction& instruction = fProgram[pc];
+	switch (instruction.op) {
+		case OP_JUMP:
+			return _AddFirstBytes(instruction.next, visited);
+		case OP_SPLIT:
+			return _AddFirstBytes(instruction.next, visited)
+				&& _AddFirstBytes(instruction.alternative, visited);
+		case OP_SAVE:
+		case OP_PROGRESS:
+			return _AddFirstBytes(pc + 1, visited);
+
+		case OP_CHARACTER:
+			_AddFirstByte(instruction.value);
+			if (fCaseInsensitive) {
+				_AddFirstByte(instruction.value < 0x80
+					? (uint32)toupper(instruction.value)
+					: BUnicodeChar::ToUpper(instruction.value));
+			}
+			return true;
+
+		case OP_CLASS:
+		{
+			const CharacterClass& set = fClasses[instruction.value];
+			if (set.negated)
+				return false;
+
+			for (uint32 c = 0; c < 0x80; c++) {
+				if (class_contains(set.ascii, c)) {
+					_AddFirstByte(c);
+					if (fCaseInsensitive) {
+						_AddFirstByte(tolower(c));
+						_AddFirstByte(toupper(c));
+					}
+				}
+			}
+			if (set.named != 0 || !set.ranges.empty() || fCaseInsensitive) {
+				// Any non-ASCII character might match
+				for (uint32 c = 0xc0; c < 0x100; c++)
+					fFirstBytes[c / 32] |= 1UL << (c % 32);
+			}
+			return true;
+		}
+
+		default:
+			return false;
+	}
+}
+
+
+void
+RegularExpression::_AddFirstByte(uint32 c)
+{
+	if (c >= kInvalidCharacter) {
+		c -= kInvalidCharacter;
+	} else if (c >= 0x80) {
+		char buffer[4];
+		char* target = buffer;
+		BUnicodeChar::ToUTF8(c, &target);
+		c = (uint8)buffer[0];
+	}
+
+	fFirstBytes[c / 32] |= 1UL << (c % 32);
+}
+
+
+/*!	Compiles an optional iteration of a repetition. Unless \a mayBeEmpty is
+	true, the iteration needs to consume some input to succeed.
+*/
+bool
+RegularExpression::_CompileIteration(const NodeList& nodes, int32 index,
+	bool mayBeEmpty)
+{
+	if (mayBeEmpty)
+		return _Compile(nodes, index);
+
+	int32 slot = fSlotCount++;
+	return _Emit(OP_SAVE, slot) >= 0 && _Compile(nodes, index)
+		&& _Emit(OP_PROGRESS, slot) >= 0;
+}
+
+
+/*static*/ bool
+RegularExpression::_IsNullable(const NodeList& nodes, int32 index)
+{
+	const Node& node = nodes[index];
+
+	switch (node.type) {
+		case CHARACTER:
+		case ANY_CHARACTER:
+		case CLASS:
+			return false;
+		case CONCATENATION:
+			for (size_t child = 0; child < node.children.size(); child++) {
+				if (!_IsNullable(nodes, node.children[child]))
+					return false;
+			}
+			return true;
+		case ALTERNATION:
+			for (size_t child = 0; child < node.children.size(); child++) {
+				if (_IsNullable(nodes, node.children[child]))
+					return true;
+			}
+			return false;
+		case REPETITION:
+			return node.minimum == 0 || _IsNullable(nodes, node.children[0]);
+		case GROUP:
+			return _IsNullable(nodes, node.children[0]);
+		default:
+			return true;
+	}
+}
+
+
+/*!	Appends an instruction to the program; "next" defaults to the following
+	instruction.
+	\return the index of the instruction, or -1 if the program got too large.
+*/
+int32
+RegularExpression::_Emit(opcode op, uint32 value)
+{
+	int32 index = fProgram.size();
+	if (index >= kMaxInstructions)
+		return -1;
+
+	Instruction instruction = {op, value, index + 1, index + 1};
+	fProgram.push_back(instruction);
+	return index;
+}
+
+
+/*!	Adds the thread at \a pc to \a list, following all instructions that
+	do not consume any input. Every instruction is only added once per list;
+	the first thread to reach it has the highest priority, and wins.
+*/
+void
+RegularExpression::_AddThread(ThreadList& list, int32 pc, int32* captures,
+	int32 position, int32 length) const
+{
+	if (list.marks[pc] == list.generation)
+		return;
+	list.marks[pc] = list.generation;
+
+	const Instruction& instruction = fProgram[pc];
+	switch (instruction.op) {
+		case OP_JUMP:
+			_AddThread(list, instruction.next, captures, position, length);
+			return;
+		case OP_SPLIT:
+			_AddThread(list, instruction.next, captures, position, length);
+			_AddThread(list, instruction.alternative, captures, position,
+				length);
+			return;
+		case OP_SAVE:
+		{
+			int32 previous = captures[instruction.value];
+			captures[instruction.value] = position;
+			_AddThread(list, pc + 1, captures, position, length);
+			captures[instruction.value] = previous;
+			return;
+		}
+		case OP_LINE_START:
+			if (position == 0)
+				_AddThread(list, pc + 1, captures, position, length);
+			return;
+		case OP_LINE_END:
+			if (position == length)
+				_AddThread(list, pc + 1, captures, position, length);
+			return;
+		case OP_PROGRESS:
+			if (position != captures[instruction.value])
+				_AddThread(list, pc + 1, captures, position, length);
+			return;
+		default:
+			break;
+	}
+
+	memcpy(list.CapturesAt(list.count), captures,
+		list.captureCount * sizeof(int32));
+	list.pcs[list.count++] = pc;
+}
+
+
+bool
+RegularExpression::_MatchClass(const CharacterClass& set, uint32 c) const
+{
+	uint32 candidates[2] = {c, c};
+	if (fCaseInsensitive && c < kInvalidCharacter) {
+		candidates[1] = c < 0x80
+			? (uint32)toupper(c) : BUnicodeChar::ToUpper(c);
+	}
+
+	bool found = false;
+	for (int32 index = 0; index < 2 && !found; index++) {
+		uint32 candidate = candidates[index];
+		if (candidate < 0x80) {
+			found = class_contains(set.ascii, candidate);
+			continue;
+		}
+		if (candidate >= kInvalidCharacter)
+			continue;
+
+		if (((set.named & NAMED_ALPHA) != 0
+				&& BUnicodeChar::IsAlpha(candidate))
+			|| ((set.named & NAMED_UPPER) != 0
+				&& BUnicodeChar::IsUpper(candidate))
+			|| ((set.named & NAMED_LOWER) != 0
+				&& BUnicodeChar::IsLower(candidate))) {
+			found = true;
+			continue;
+		}
+
+		for (size_t range = 0; range < set.ranges.size(); range += 2) {
+			if (candidate >= set.ranges[range]
+				&& candidate <= set.ranges[range + 1]) {
+				found = true;
+				break;
+			}
+		}
+	}
+
+	return found != set.negated;
+}
+
+
+bool
+RegularExpression::_MatchFallback(const char* string, int32 length,
+	regmatch_t* groups, int32 groupCount, int32 from) const
+{
+	// With REG_STARTEND, regexec() neither needs a null terminated string,
+	// nor loses the text before "from", so that "\b", "\<", or back
+	// references still see it
+	regmatch_t match;
+	if (groupCount < 1) {
+		groups = &match;
+		groupCount = 1;
+	}
+	groups[0].rm_so = from;
+	groups[0].rm_eo = length;
+
+	return regexec(&fFallback, string, groupCount, groups,
+		REG_STARTEND) == 0;
+}
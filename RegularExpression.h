@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef REGULAR_EXPRESSION_H
+#define REGULAR_EXPRESSION_H
+
+
+#include <String.h>
+
+#include <regex.h>
+
+#include <vector>
+
+
+/*!	A POSIX extended regular expression.
+
+	Patterns are compiled into a program for a Pike VM, which simulates
+	all possible matches at once, and therefore never needs more than
+	O(n * m) steps, no matter how much a pattern would backtrack otherwise.
+	Like POSIX, it reports the leftmost-longest match. Sub-matches follow
+	the priority of the alternatives and quantifiers (which are greedy),
+	though, like in glibc, and not the POSIX rule that every group takes
+	the longest possible match from left to right: "(a|ab)(c|bcd)(d*)"
+	on "abcd" gives "a", "bcd", and "", where POSIX asks for "ab", "c",
+	and "d".
+
+	Groups can be named with "(?<name>...)", or "(?P<name>...)"; "(?:...)"
+	groups are not captured.
+
+	Constructs that are not supported by the built-in engine, like back
+	references, are handed over to regcomp()/regexec() instead.
+*/
+class RegularExpression {
+public:
+								RegularExpression();
+								~RegularExpression();
+
+			status_t			SetPattern(const char* pattern,
+									bool caseInsensitive = false);
+			bool				IsValid() const
+									{ return fValid; }
+			bool				UsesFallback() const
+									{ return fUseFallback; }
+			int32				CountGroups() const
+									{ return fGroupCount; }
+			int32				GroupIndex(const char* name,
+									int32 length = -1) const;
+
+			bool				Match(const char* string, int32 length,
+									regmatch_t* groups, int32 groupCount,
+									int32 from = 0) const;
+
+private:
+			enum node_type {
+				EMPTY,
+				CHARACTER,
+				ANY_CHARACTER,
+				CLASS,
+				LINE_START,
+				LINE_END,
+				CONCATENATION,
+				ALTERNATION,
+				REPETITION,
+				GROUP
+			};
+
+			struct Node {
+				node_type		type;
+				uint32			value;
+				int32			minimum;
+				int32			maximum;
+				std::vector<int32> children;
+			};
+
+			enum opcode {
+				OP_CHARACTER,
+				OP_ANY_CHARACTER,
+				OP_CLASS,
+				OP_LINE_START,
+				OP_LINE_END,
+				OP_SPLIT,
+				OP_JUMP,
+				OP_SAVE,
+				OP_PROGRESS,
+				OP_MATCH
+			};
+
+			struct Instruction {
+				opcode			op;
+				uint32			value;
+				int32			next;
+				int32			alternative;
+			};
+
+			struct CharacterClass {
+				bool			negated;
+				uint32			ascii[4];
+				uint32			named;
+				std::vector<uint32> ranges;
+			};
+
+			struct ThreadList;
+			class Parser;
+
+			typedef std::vector<Node> NodeList;
+			typedef std::vector<Instruction> Program;
+			typedef std::vector<CharacterClass> ClassList;
+			typedef std::vector<BString> NameList;
+
+			void				_Unset();
+			bool				_Compile(const NodeList& nodes, int32 index);
+			void				_ComputeFirstBytes();
+			bool				_AddFirstBytes(int32 pc,
+									std::vector<bool>& visited);
+			void				_AddFirstByte(uint32 c);
+			bool				_CompileIteration(const NodeList& nodes,
+									int32 index, bool mayBeEmpty);
+	static	bool				_IsNullable(const NodeList& nodes,
+									int32 index);
+			int32				_Emit(opcode op, uint32 value = 0);
+			void				_AddThread(ThreadList& list, int32 pc,
+									int32* captures, int32 position,
+									int32 length) const;
+			bool				_MatchClass(const CharacterClass& set,
+									uint32 c) const;
+			bool				_MatchFallback(const char* string,
+									int32 length, regmatch_t* groups,
+									int32 groupCount, int32 from) const;
+
+private:
+			Program				fProgram;
+			ClassList			fClasses;
+			NameList			fGroupNames;
+			int32				fGroupCount;
+			int32				fSlotCount;
+			uint32				fFirstBytes[8];
+			bool				fHasFirstBytes;
+			bool				fCaseInsensitive;
+			bool				fValid;
+			bool				fUseFallback;
+			regex_t				fFallback;
+};
+
+
+#endif	// REGULAR_EXPRESSION_H
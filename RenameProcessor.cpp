@@ -5,24 +5,47 @@
 
 #include "RenameProcessor.h"
 
+#include "FileSystem.h"
+
 #include <Entry.h>
-#include <Node.h>
+#include <FindDirectory.h>
 #include <Path.h>
 #include <String.h>
 
-#include <fs_attr.h>
-
-#include <map>
-#include <new>
-#include <set>
 
-#include <stdio.h>
+// The number of refs whose shell scripts are run together
+static const int32 kBatchSize = 64;
 
 
-RenameProcessor::RenameProcessor()
+/*!	The output of shell scripts is only kept between sessions if
+	\a keepShellResults is \c true.
+*/
+RenameProcessor::RenameProcessor(bool keepShellResults)
 	:
-	BLooper("Rename processor")
+	BLooper("Rename processor"),
+	fFileSystem(FileSystem::Default()),
+	fEvaluator(fFileSystem),
+	fDirectoryCache(fFileSystem),
+	fGeneration(0),
+	fKeepShellResults(keepShellResults)
+{
+	BPath path;
+	if (keepShellResults && _GetShellCachePath(path) == B_OK)
+		fEvaluator.ShellCache().Load(path.Path());
+}
+
+
+RenameProcessor::~RenameProcessor()
 {
+	BPath path;
+	if (_GetShellCachePath(path) != B_OK)
+		return;
+
+	// Results that are not to be kept must not stay around either
+	if (atomic_get(&fKeepShellResults) != 0)
+		fEvaluator.ShellCache().Save(path.Path());
+	else
+		BEntry(path.Path()).Remove();
 }
 
 
@@ -32,17 +55,83 @@ RenameProcessor::MessageReceived(BMessage* message)
 	switch (message->what) {
 		case kMsgProcessAndCheckRename:
 		{
+			uint32 generation = message->GetInt32("generation", 0);
 			BMessage reply(kMsgProcessed);
-
-			entry_ref ref;
-			int32 index;
-			for (index = 0; message->FindRef("source", index, &ref) == B_OK;
-					index++) {
-				BString target;
-				if (message->FindString("target", index, &target) == B_OK)
-					_ProcessRef(reply, ref, target);
+			reply.AddInt32("generation", generation);
+
+			// Directories might have changed since the last request, and
+			// its files should all stay cached until the next one
+			fDirectoryCache.StartPass();
+			fEvaluator.StartPass();
+			fTargets.clear();
+
+			// The replacement of the action is parsed once per request;
+			// the templates of the targets are then put together from it,
+			// and their target groups
+			ExpressionTemplate replacement;
+			const char* replacementText;
+			bool hasReplacement = message->FindString("replacement",
+				&replacementText) == B_OK;
+			if (hasReplacement)
+				replacement.SetTo(replacementText);
+
+			entry_ref refs[kBatchSize];
+			BPath paths[kBatchSize];
+			ExpressionTemplate templates[kBatchSize];
+			int32 counters[kBatchSize];
+			int32 directoryCounters[kBatchSize];
+			GroupList groups;
+			BString target;
+			int32 index = 0;
+			int32 groupIndex = 0;
+			bool more = true;
+
+			while (more) {
+				// Run the shell scripts of a batch of refs all at once,
+				// before evaluating them one by one
+				fEvaluator.ClearShellJobs();
+
+				int32 count = 0;
+				for (; count < kBatchSize; index++) {
+					if (message->FindRef("source", index, &refs[count])
+							!= B_OK) {
+						more = false;
+						break;
+					}
+					if (hasReplacement)
+						_GetGroups(*message, index, groupIndex, groups);
+					if (message->FindString("target", index, &target) != B_OK
+						|| paths[count].SetTo(&refs[count]) != B_OK)
+						continue;
+
+					if (hasReplacement)
+						templates[count].SetTo(target, replacement, groups);
+					else
+						templates[count].SetTo(target);
+					counters[count] = message->GetInt32("counter", index, 0);
+					directoryCounters[count] = message->GetInt32(
+						"directory counter", index, 0);
+					fEvaluator.AddShellJobs(paths[count].Path(),
+						templates[count]);
+					count++;
+				}
+
+				// A newer request has been made; it replaces this one
+				if (_IsSuperseded(generation))
+					return;
+
+				fEvaluator.RunShellJobs();
+
+				for (int32 i = 0; i < count; i++) {
+					if (_IsSuperseded(generation))
+						return;
+
+					fEvaluator.SetCounters(counters[i], directoryCounters[i]);
+					_ProcessRef(reply, refs[i], paths[i], templates[i]);
+				}
 			}
 
+			fTargets.clear();
 			message->SendReply(&reply);
 			break;
 		}
@@ -54,236 +143,143 @@ RenameProcessor::MessageReceived(BMessage* message)
 }
 
 
-/*!	Evaluate expressions in the target name, and checks if the file
-	name already exists.
-
-	\return true if something has been added to the \a update message.
+/*!	Announces the generation of the latest request. This is called from
+	the window thread when it starts a new preview, so that requests of
+	earlier generations can be abandoned even before the new request
+	arrives.
 */
-bool
-RenameProcessor::_ProcessRef(BMessage& updates, const entry_ref& ref,
-	const BString& target)
+void
+RenameProcessor::SetGeneration(uint32 generation)
 {
-	int length = target.Length();
-	const char* buffer = target.String();
-	int diff = 0;
-	int expressionCount = 0;
-	int emptyCount = 0;
-
-	BMessage update;
-	update.AddRef("ref", &ref);
-
-	for (int index = 0; index < length - 3; index++) {
-		if (buffer[index] == '$') {
-			char open = buffer[index + 1];
-			BString expression;
-			int expressionLength = -1;
-			if (open == '(' || open == '[') {
-				expressionLength = _Extract(buffer + index + 2,
-					length - index - 2, open, expression);
-			}
-
-			BString result;
-			bool changed = false;
-
-			if (expressionLength > 0 && open == '[') {
-				// shell script
-				result = _ExecuteShell(ref, expression.String());
-				changed = true;
-			} else if (expressionLength > 0 && open == '(') {
-				// Attribute replacement
-				result = _ReadAttribute(ref, expression.String());
-				changed = true;
-			}
-
-			if (changed) {
-				expressionCount++;
-				if (result.IsEmpty())
-					emptyCount++;
+	atomic_set(&fGeneration, (int32)generation);
+}
 
-				update.AddInt32("from", index + diff);
-				update.AddInt32("to", index + expressionLength + 3 + diff);
-				update.AddString("replace", result);
 
-				diff += result.Length() - expressionLength - 3;
-				index += expressionLength + 2;
-			}
-		}
-	}
+/*!	Sets whether the output of shell scripts is saved when the processor
+	quits, so that it can be reused in the next session. This may be
+	called from any thread.
+*/
+void
+RenameProcessor::SetKeepShellResults(bool keep)
+{
+	atomic_set(&fKeepShellResults, keep ? 1 : 0);
+}
 
-	if (expressionCount > 0) {
-		update.AddBool("has empty", emptyCount > 0);
-		update.AddBool("all empty", expressionCount == emptyCount);
-	}
 
-	bool exists = _CheckRef(ref, target);
-	if (!exists)
-		update.AddBool("exists", true);
+/*static*/ status_t
+RenameProcessor::_GetShellCachePath(BPath& path)
+{
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	if (status != B_OK)
+		return status;
 
-	if (expressionCount > 0 || !exists) {
-		updates.AddMessage("update", &update);
-		return true;
-	}
-	return false;
+	return path.Append("pinc.rename shell cache");
 }
 
 
 bool
-RenameProcessor::_CheckRef(const entry_ref& ref, const BString& target)
+RenameProcessor::_IsSuperseded(uint32 generation) const
 {
-	entry_ref targetRef = ref;
-	int32 index = target.FindFirst('/');
-	if (index >= 0) {
-		BPath path(&ref);
-		if (path.InitCheck() != B_OK
-			|| path.GetParent(&path) != B_OK
-			|| path.Append(target) != B_OK
-			|| get_ref_for_path(path.Path(), &targetRef) != B_OK)
-			return true;
-	} else
-		targetRef.set_name(target.String());
-
-	BEntry entry(&targetRef);
-	return !entry.Exists();
+	return (uint32)atomic_get((int32*)&fGeneration) != generation;
 }
 
 
-BString
-RenameProcessor::_ReadAttribute(const entry_ref& ref, const char* name)
+/*!	Gets the target groups of the ref at \a index of the \a message.
+	They are stored one after the other for all refs; \a groupIndex is
+	the index of the first one, and is moved past them.
+*/
+/*static*/ void
+RenameProcessor::_GetGroups(const BMessage& message, int32 index,
+	int32& groupIndex, GroupList& groups)
 {
-	BNode node(&ref);
-	status_t status = node.InitCheck();
-	if (status != B_OK)
-		return "";
-
-	attr_info info;
-	status = node.GetAttrInfo(name, &info);
-	if (status != B_OK)
-		return "";
-
-	char buffer[1024];
-	off_t size = info.size;
-	if (size > sizeof(buffer))
-		size = sizeof(buffer);
-
-	ssize_t bytesRead = node.ReadAttr(name, info.type, 0, buffer, size);
-	if (bytesRead != size)
-		return "";
+	groups.MakeEmpty();
 
-	// Taken over from Haiku's listattr.cpp
-	BString result;
-	switch (info.type) {
-		case B_INT8_TYPE:
-			result.SetToFormat("%" B_PRId8, *((int8 *)buffer));
-			break;
-		case B_UINT8_TYPE:
-			result.SetToFormat("%" B_PRIu8, *((uint8 *)buffer));
-			break;
-		case B_INT16_TYPE:
-			result.SetToFormat("%" B_PRId16, *((int16 *)buffer));
-			break;
-		case B_UINT16_TYPE:
-			result.SetToFormat("%" B_PRIu16, *((uint16 *)buffer));
-			break;
-		case B_INT32_TYPE:
-			result.SetToFormat("%" B_PRId32, *((int32 *)buffer));
-			break;
-		case B_UINT32_TYPE:
-			result.SetToFormat("%" B_PRIu32, *((uint32 *)buffer));
-			break;
-		case B_INT64_TYPE:
-			result.SetToFormat("%" B_PRId64, *((int64 *)buffer));
-			break;
-		case B_UINT64_TYPE:
-			result.SetToFormat("%" B_PRIu64, *((uint64 *)buffer));
-			break;
-		case B_FLOAT_TYPE:
-			result.SetToFormat("%f", *((float *)buffer));
-			break;
-		case B_DOUBLE_TYPE:
-			result.SetToFormat("%f", *((double *)buffer));
-			break;
-		case B_BOOL_TYPE:
-			result.SetToFormat("%d", *((unsigned char *)buffer));
-			break;
-		case B_TIME_TYPE:
-		{
-			char stringBuffer[256];
-			struct tm timeInfo;
-			localtime_r((time_t *)buffer, &timeInfo);
-			strftime(stringBuffer, sizeof(stringBuffer), "%c", &timeInfo);
-			result.SetToFormat("%s", stringBuffer);
-			break;
-		}
-		case B_STRING_TYPE:
-		case B_MIME_STRING_TYPE:
-		case 'MSIG':
-		case 'MSDC':
-		case 'MPTH':
-			result.SetToFormat("%s", buffer);
-			break;
+	int32 count = message.GetInt32("group count", index, 0);
+	for (int32 i = 0; i < count; i++, groupIndex++) {
+		groups.AddItem(Group(i, message.GetInt32("group start", groupIndex, 0),
+			message.GetInt32("group end", groupIndex, 0)));
 	}
-	return result;
 }
 
 
-BString
-RenameProcessor::_ExecuteShell(const entry_ref& ref, const char* script)
+/*!	Evaluate expressions in the target name, and checks if the file
+	name already exists, or if another file of the request is renamed to
+	it as well.
+
+	\return true if something has been added to the \a update message.
+*/
+bool
+RenameProcessor::_ProcessRef(BMessage& updates, const entry_ref& ref,
+	const BPath& path, const ExpressionTemplate& target)
 {
-	BPath path(&ref);
-	if (path.InitCheck() != B_OK)
-		return "";
+	BString result;
+	ReplacementList replacements;
+	int32 emptyCount;
+	int32 expressionCount = fEvaluator.Evaluate(path.Path(), target, result,
+		emptyCount, &replacements);
 
-	BString output;
+	bool exists = _CheckRef(path, result);
+	bool duplicate = _IsDuplicate(updates, ref, result);
+	if (expressionCount == 0 && exists && !duplicate)
+		return false;
 
-	setenv("file", path.Path(), true);
+	BMessage update;
+	update.AddRef("ref", &ref);
 
-	BString scriptBuffer = script;
-	scriptBuffer.ReplaceAll("'", "\'");
+	for (size_t index = 0; index < replacements.size(); index++) {
+		const Replacement& replacement = replacements[index];
+		update.AddInt32("from", replacement.from);
+		update.AddInt32("to", replacement.to);
+		update.AddString("replace", replacement.replace);
+	}
 
-	BString commandBuffer = BString().SetToFormat("bash -c '%s'",
-		scriptBuffer.String());
+	if (expressionCount > 0) {
+		update.AddBool("has empty", emptyCount > 0);
+		update.AddBool("all empty", expressionCount == emptyCount);
+	}
 
-	FILE* pipe = popen(commandBuffer.String(), "r");
-	if (pipe == NULL)
-		return "";
+	if (!exists)
+		update.AddBool("exists", true);
+	if (duplicate)
+		update.AddBool("duplicate", true);
 
-	while (true) {
-		char buffer[4096];
-		const char* line = fgets(buffer, sizeof(buffer), pipe);
-		if (line == NULL)
-			break;
+	updates.AddMessage("update", &update);
+	return true;
+}
 
-		output += line;
 
-		// Cut off trailing newline
-		if (output.ByteAt(output.Length() - 1) == '\n')
-			output.Truncate(output.Length() - 1);
-	}
-	pclose(pipe);
+/*!	Returns true if \a target does not exist yet next to \a path. All
+	targets in the same directory are looked up in a single read of it.
+*/
+bool
+RenameProcessor::_CheckRef(const BPath& path, const BString& target)
+{
+	BPath parent;
+	if (path.GetParent(&parent) != B_OK)
+		return true;
 
-	return output;
+	return !fDirectoryCache.Exists(parent.Path(), target.String());
 }
 
 
-int
-RenameProcessor::_Extract(const char* buffer, int length, char open,
-	BString& expression)
+/*!	Returns true if another file of the current request is renamed to the
+	same \a target as the one of \a ref. The window can only compare the
+	targets before their expressions are evaluated, so this is checked
+	here. The other file is reported as a duplicate, too.
+*/
+bool
+RenameProcessor::_IsDuplicate(BMessage& updates, const entry_ref& ref,
+	const BString& target)
 {
-	// Find end
-	char close = open == '(' ? ')' : ']';
-	int level = 0;
-	for (int index = 0; index < length; index++) {
-		if (buffer[index] == open)
-			level++;
-		else if (buffer[index] == close) {
-			level--;
-			if (level < 0) {
-				// Extract expression
-				expression.SetTo(buffer, index);
-				return index;
-			}
-		}
-	}
+	entry_ref targetRef(ref.device, ref.directory, target.String());
+	std::pair<TargetMap::iterator, bool> inserted = fTargets.insert(
+		std::make_pair(targetRef, ref));
+	if (inserted.second || inserted.first->second == ref)
+		return false;
 
-	return -1;
+	BMessage update;
+	update.AddRef("ref", &inserted.first->second);
+	update.AddBool("duplicate", true);
+	updates.AddMessage("update", &update);
+	return true;
 }
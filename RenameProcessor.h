@@ -5,8 +5,18 @@
 #define RENAME_PROCESSOR_H
 
 
+#include "DirectoryCache.h"
+#include "ExpressionEvaluator.h"
+
+#include <Entry.h>
 #include <Looper.h>
 
+#include <map>
+
+
+class BPath;
+class FileSystem;
+
 
 static const uint32 kMsgProcessAndCheckRename = 'pchR';
 static const uint32 kMsgProcessed = 'prcd';
@@ -14,22 +24,38 @@ static const uint32 kMsgProcessed = 'prcd';
 
 class RenameProcessor : public BLooper {
 public:
-								RenameProcessor();
+								RenameProcessor(bool keepShellResults = false);
+	virtual						~RenameProcessor();
 
 	virtual	void				MessageReceived(BMessage* message);
 
+			void				SetGeneration(uint32 generation);
+			void				SetKeepShellResults(bool keep);
+
 private:
+	static	status_t			_GetShellCachePath(BPath& path);
+			bool				_IsSuperseded(uint32 generation) const;
+	static	void				_GetGroups(const BMessage& message,
+									int32 index, int32& groupIndex,
+									GroupList& groups);
 			bool				_ProcessRef(BMessage& update,
-									const entry_ref& ref,
+									const entry_ref& ref, const BPath& path,
+									const ExpressionTemplate& target);
+			bool				_CheckRef(const BPath& path,
 									const BString& target);
-			bool				_CheckRef(const entry_ref& ref,
+			bool				_IsDuplicate(BMessage& updates,
+									const entry_ref& ref,
 									const BString& target);
-			BString				_ReadAttribute(const entry_ref& ref,
-									const char* name);
-			BString				_ExecuteShell(const entry_ref& ref,
-									const char* script);
-			int					_Extract(const char* buffer, int length,
-									char open, BString& expression);
+
+			typedef std::map<entry_ref, entry_ref> TargetMap;
+
+private:
+			FileSystem&			fFileSystem;
+			ExpressionEvaluator	fEvaluator;
+			DirectoryCache		fDirectoryCache;
+			TargetMap			fTargets;
+			int32				fGeneration;
+			int32				fKeepShellResults;
 };
 
 
@@ -99,6 +99,20 @@ RenameSettings::SetRecursive(bool recursive)
 }
 
 
+bool
+RenameSettings::KeepShellResults() const
+{
+	return fSettings.GetBool("keep shell results", false);
+}
+
+
+void
+RenameSettings::SetKeepShellResults(bool keep)
+{
+	fSettings.SetBool("keep shell results", keep);
+}
+
+
 ::FileTypeMode
 RenameSettings::FileTypeMode() const
 {
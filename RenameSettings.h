@@ -38,6 +38,9 @@ public:
 			bool				Recursive() const;
 			void				SetRecursive(bool recursive);
 
+			bool				KeepShellResults() const;
+			void				SetKeepShellResults(bool keep);
+
 			::FileTypeMode		FileTypeMode() const;
 			void				SetFileTypeMode(::FileTypeMode mode);
 
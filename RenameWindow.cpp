@@ -6,15 +6,19 @@
 #include "RenameWindow.h"
 
 #include "batchrename.h"
-#include "CaseRenameAction.h"
+#include "CaseRenameView.h"
+#include "ExpressionTemplate.h"
+#include "ParallelRenamer.h"
+#include "PipelineRenameAction.h"
 #include "PreviewItem.h"
 #include "PreviewList.h"
 #include "RefModel.h"
-#include "RegularExpressionRenameAction.h"
+#include "RegularExpressionView.h"
+#include "RenameAction.h"
 #include "RenameProcessor.h"
 #include "RenameSettings.h"
-#include "SearchReplaceRenameAction.h"
-#include "WindowsRenameAction.h"
+#include "SearchReplaceView.h"
+#include "WindowsRenameView.h"
 
 #include <Button.h>
 #include <Catalog.h>
@@ -23,11 +27,13 @@
 #include <LayoutBuilder.h>
 #include <MenuItem.h>
 #include <MenuField.h>
+#include <Node.h>
 #include <PopUpMenu.h>
 #include <ScrollView.h>
 #include <SeparatorView.h>
 #include <TextControl.h>
 
+#include <map>
 #include <set>
 
 #include <stdio.h>
@@ -38,21 +44,73 @@ typedef std::set<BString> StringSet;
 
 
 static const uint32 kMsgSetAction = 'stAc';
+static const uint32 kMsgTogglePipelineStep = 'tgPs';
 static const uint32 kMsgRename = 'okRe';
 static const uint32 kMsgRemoveUnchanged = 'rmUn';
 static const uint32 kMsgRecursive = 'recu';
+static const uint32 kMsgKeepShellResults = 'kpSr';
 static const uint32 kMsgFilterChanged = 'fich';
 static const uint32 kMsgResetRemoved = 'rsrm';
+static const uint32 kMsgContinuePreview = 'cnPv';
+
+// How long the preview may block the window thread at a time
+static const bigtime_t kPreviewSliceTime = 10000;
+
+
+// The order in which additional rename methods are applied, as indices
+// into the action menu
+static const int32 kPipelineOrder[] = {0, 1, 3, 2};
 
 
 #define B_TRANSLATION_CONTEXT "Rename"
 
 
+/*!	Lets the window know when the ParallelRenamer has finished renaming
+	some of its names.
+*/
+class PreviewListener : public ParallelRenamer::Listener {
+public:
+	PreviewListener(const BMessenger& target)
+		:
+		fTarget(target),
+		fGeneration(0)
+	{
+	}
+
+	void SetGeneration(uint32 generation)
+	{
+		fGeneration = generation;
+	}
+
+	virtual bool ChunkFinished()
+	{
+		BMessage message(kMsgContinuePreview);
+		message.AddInt32("generation", fGeneration);
+
+		// Never block, as the window might be waiting for us
+		return fTarget.SendMessage(&message, (BHandler*)NULL, 0) == B_OK;
+	}
+
+private:
+	BMessenger			fTarget;
+	uint32				fGeneration;
+};
+
+
 RenameWindow::RenameWindow(RenameSettings& settings)
 	:
 	BWindow(BRect(0, 0, 99, 99), B_TRANSLATE("Rename files"), B_DOCUMENT_WINDOW,
 		B_AUTO_UPDATE_SIZE_LIMITS | B_ASYNCHRONOUS_CONTROLS),
-	fSettings(settings)
+	fSettings(settings),
+	fProcessor(NULL),
+	fRenamer(NULL),
+	fPreviewListener(NULL),
+	fPreviewAction(NULL),
+	fPreviewGeneration(0),
+	fFirstVisibleIndex(0),
+	fLastVisibleIndex(-1),
+	fPreviewErrorCount(0),
+	fPreviewValidCount(0)
 {
 	status_t status = fSettings.Load();
 	if (status != B_OK) {
@@ -78,6 +136,12 @@ RenameWindow::RenameWindow(RenameSettings& settings)
 	fRecursiveCheckBox->SetValue(
 		fSettings.Recursive() ? B_CONTROL_ON : B_CONTROL_OFF);
 
+	fKeepShellResultsCheckBox = new BCheckBox("keep shell results",
+		"Keep shell results between sessions",
+		new BMessage(kMsgKeepShellResults));
+	fKeepShellResultsCheckBox->SetValue(
+		fSettings.KeepShellResults() ? B_CONTROL_ON : B_CONTROL_OFF);
+
 	// File type menu field
 
 	fTypeMenu = new BPopUpMenu("Types");
@@ -140,6 +204,32 @@ RenameWindow::RenameWindow(RenameSettings& settings)
 	fCardView->AddChild(caseRenameView);
 	fCardView->CardLayout()->SetVisibleItem((int32)0);
 
+	// Rename methods to apply after the current one
+
+	fPipelineMenu = new BPopUpMenu("Methods");
+	fPipelineMenu->SetRadioMode(false);
+	fPipelineMenu->SetLabelFromMarked(false);
+
+	BMessage pipelineSettings;
+	fSettings.Get("pipeline", pipelineSettings);
+
+	for (size_t index = 0; index < B_COUNT_OF(kPipelineOrder); index++) {
+		int32 method = kPipelineOrder[index];
+		BMessage* message = new BMessage(kMsgTogglePipelineStep);
+		message->AddInt32("method", method);
+
+		item = new BMenuItem(fActionMenu->ItemAt(method)->Label(), message);
+		for (int32 markedIndex = 0; pipelineSettings.HasInt32("method",
+				markedIndex); markedIndex++) {
+			if (pipelineSettings.GetInt32("method", markedIndex, -1) == method)
+				item->SetMarked(true);
+		}
+		fPipelineMenu->AddItem(item);
+	}
+
+	fPipelineMenuField = new BMenuField("pipeline", "Then apply",
+		fPipelineMenu);
+
 	// Restore settings
 	for (int32 index = 0; index < fCardView->CountChildren(); index++) {
 		if (RenameView* view = dynamic_cast<RenameView*>(
@@ -169,12 +259,14 @@ RenameWindow::RenameWindow(RenameSettings& settings)
 				.SetExplicitMaxSize(BSize(B_SIZE_UNLIMITED, B_SIZE_UNSET))
 				.AddGrid(0.f)
 					.AddMenuField(fActionMenuField, 0, 0)
+					.AddMenuField(fPipelineMenuField, 0, 1)
 				.End()
 				.Add(fCardView)
 			.End()
 			.Add(new BSeparatorView(B_VERTICAL), 0.f)
 			.AddGroup(B_VERTICAL, B_USE_DEFAULT_SPACING, 0.f)
 				.Add(fRecursiveCheckBox)
+				.Add(fKeepShellResultsCheckBox)
 				.AddGrid(0.f)
 					.AddMenuField(fTypeMenuField, 0, 0)
 					.AddMenuField(fReplacementMenuField, 0, 1)
@@ -213,10 +305,13 @@ RenameWindow::RenameWindow(RenameSettings& settings)
 
 	fRefModel->SetRecursive(fSettings.Recursive());
 
-	RenameProcessor* processor = new RenameProcessor();
-	processor->Run();
+	fProcessor = new RenameProcessor(fSettings.KeepShellResults());
+	fProcessor->Run();
+
+	fRenameProcessor = fProcessor;
 
-	fRenameProcessor = processor;
+	fRenamer = new ParallelRenamer();
+	fPreviewListener = new PreviewListener(BMessenger(this));
 }
 
 
@@ -226,10 +321,22 @@ RenameWindow::~RenameWindow()
 
 	fSettings.SetWindowFrame(Frame());
 	fSettings.SetRecursive(fRecursiveCheckBox->Value() == B_CONTROL_ON);
+	fSettings.SetKeepShellResults(
+		fKeepShellResultsCheckBox->Value() == B_CONTROL_ON);
 	fSettings.SetFileTypeMode((FileTypeMode)fTypeMenu->FindMarkedIndex());
 	fSettings.SetReplacementMode(
 		(ReplacementMode)fReplacementMenu->FindMarkedIndex());
 
+	BMessage pipelineSettings;
+	for (int32 index = 0; index < fPipelineMenu->CountItems(); index++) {
+		BMenuItem* item = fPipelineMenu->ItemAt(index);
+		if (item->IsMarked()) {
+			pipelineSettings.AddInt32("method",
+				item->Message()->GetInt32("method", -1));
+		}
+	}
+	fSettings.Set("pipeline", pipelineSettings);
+
 	for (int32 index = 0; index < fCardView->CountChildren(); index++) {
 		if (RenameView* view = dynamic_cast<RenameView*>(
 				fCardView->ChildAt(index))) {
@@ -242,6 +349,11 @@ RenameWindow::~RenameWindow()
 	fSettings.Save();
 
 	delete fRefModel;
+
+	// Stops all workers before their action and listener go away
+	delete fRenamer;
+	delete fPreviewListener;
+	delete fPreviewAction;
 }
 
 
@@ -288,11 +400,33 @@ RenameWindow::MessageReceived(BMessage* message)
 			_UpdatePreviewItems();
 			break;
 
+		case kMsgContinuePreview:
+			if (fPreviewAction != NULL && (uint32)message->GetInt32(
+					"generation", 0) == fPreviewGeneration) {
+				_ContinuePreview();
+			}
+			break;
+
+		case kMsgTogglePipelineStep:
+		{
+			BMenuItem* item;
+			if (message->FindPointer("source", (void**)&item) == B_OK)
+				item->SetMarked(!item->IsMarked());
+
+			_UpdatePreviewItems();
+			break;
+		}
+
 		case kMsgRecursive:
 			fRefModel->SetRecursive(
 				fRecursiveCheckBox->Value() == B_CONTROL_ON);
 			break;
 
+		case kMsgKeepShellResults:
+			fProcessor->SetKeepShellResults(
+				fKeepShellResultsCheckBox->Value() == B_CONTROL_ON);
+			break;
+
 		case kMsgFilterChanged:
 			_UpdateFilter();
 			break;
@@ -310,6 +444,10 @@ RenameWindow::MessageReceived(BMessage* message)
 				fRefModel->RemoveRef(ref);
 			}
 			fResetRemovedButton->SetEnabled(true);
+
+			// The list changed under a running preview; start over
+			if (fPreviewAction != NULL)
+				_UpdatePreviewItems();
 			break;
 		}
 
@@ -338,9 +476,50 @@ RenameWindow::MessageReceived(BMessage* message)
 }
 
 
+/*!	Creates the action of the current rename method. If other methods are
+	marked in the pipeline menu, they are applied afterwards, in the order
+	of that menu.
+*/
+RenameAction*
+RenameWindow::_CreateAction() const
+{
+	int32 current = fActionMenu->FindMarkedIndex();
+	PipelineRenameAction* pipeline = NULL;
+
+	for (int32 index = 0; index < fPipelineMenu->CountItems(); index++) {
+		BMenuItem* item = fPipelineMenu->ItemAt(index);
+		int32 method = item->Message()->GetInt32("method", -1);
+		if (!item->IsMarked() || method == current)
+			continue;
+
+		RenameView* view = dynamic_cast<RenameView*>(
+			fCardView->ChildAt(method));
+		if (view == NULL)
+			continue;
+
+		if (pipeline == NULL) {
+			pipeline = new PipelineRenameAction();
+			pipeline->AddAction(fView->Action());
+		}
+		pipeline->AddAction(view->Action());
+	}
+
+	if (pipeline != NULL)
+		return pipeline;
+
+	return fView->Action();
+}
+
+
 void
 RenameWindow::_HandleProcessed(BMessage* message)
 {
+	if ((uint32)message->GetInt32("generation", 0) != fPreviewGeneration
+		|| fPreviewAction != NULL) {
+		// This reply belongs to an earlier preview
+		return;
+	}
+
 	ReplacementMode replacementMode
 		= (ReplacementMode)fReplacementMenu->FindMarkedIndex();
 	int32 processedCount = 0;
@@ -365,6 +544,9 @@ RenameWindow::_HandleProcessed(BMessage* message)
 		} else if (update.GetBool("exists")) {
 			item->SetError(EXISTS);
 			errorCount++;
+		} else if (update.GetBool("duplicate")) {
+			item->SetError(DUPLICATE);
+			errorCount++;
 		}
 
 		BString replace;
@@ -402,55 +584,235 @@ RenameWindow::_HandleProcessed(BMessage* message)
 }
 
 
+/*!	Starts computing the preview for the current rename action.
+
+	The rows that are currently visible are computed right away, the rest
+	of the list is renamed by the worker threads of the ParallelRenamer.
+	The window collects their results in slices of at most
+	kPreviewSliceTime, so that it stays responsive on large lists. Any
+	change that triggers a new preview abandons the one in progress.
+*/
 void
 RenameWindow::_UpdatePreviewItems()
 {
-	RenameAction* action = fView->Action();
+	// Stop the workers before their action goes away
+	fRenamer->MakeEmpty();
+
+	delete fPreviewAction;
+	fPreviewAction = _CreateAction();
+	fPreviewGeneration++;
+	fPreviewListener->SetGeneration(fPreviewGeneration);
+	fProcessor->SetGeneration(fPreviewGeneration);
+
+	fPreviewErrorCount = 0;
+	fPreviewValidCount = 0;
+	fPreviewTargets.clear();
+	fPreviewRefs.clear();
+	fPreviewIndices.clear();
+	fPreviewCheck.MakeEmpty();
+	fPreviewCheck.what = kMsgProcessAndCheckRename;
+	fPreviewCheck.AddInt32("generation", fPreviewGeneration);
 
-	BMessage check(kMsgProcessAndCheckRename);
-	int errorCount = 0;
-	int validCount = 0;
-	PreviewItemMap map;
-	for (int32 i = 0; i < fPreviewList->CountItems(); i++) {
-		PreviewItem* item = static_cast<PreviewItem*>(
-			fPreviewList->ItemAt(i));
-		item->SetRenameAction(*action);
-
-		if (item->IsValid()) {
-			if (item->HasTarget()) {
-				entry_ref targetRef = item->Ref();
-				targetRef.set_name(item->Target());
-				PreviewItemMap::iterator found = map.find(targetRef);
-				if (found != map.end()) {
-					found->second->SetError(DUPLICATE);
-					item->SetError(DUPLICATE);
-					errorCount++;
-				} else {
-					map.insert(std::make_pair(targetRef, item));
-					validCount++;
-				}
-			}
+	fOkButton->SetEnabled(false);
+	fRemoveUnchangedButton->SetEnabled(false);
+
+	BRect bounds = fPreviewList->Bounds();
+	fFirstVisibleIndex = max_c(0, fPreviewList->IndexOf(bounds.LeftTop()));
+	fLastVisibleIndex = fPreviewList->IndexOf(bounds.LeftBottom());
+	if (fLastVisibleIndex < 0)
+		fLastVisibleIndex = fPreviewList->CountItems() - 1;
+
+	for (int32 index = fFirstVisibleIndex; index <= fLastVisibleIndex;
+			index++) {
+		_PreviewItem(index);
+	}
+	fPreviewList->Invalidate();
+
+	int32 count = fPreviewList->CountItems();
+	for (int32 index = 0; index < count; index++) {
+		if (index >= fFirstVisibleIndex && index <= fLastVisibleIndex)
+			continue;
+
+		const entry_ref& ref = static_cast<PreviewItem*>(
+			fPreviewList->ItemAt(index))->Ref();
+		fRenamer->AddName(ref.name);
+		fPreviewRefs.push_back(ref);
+		fPreviewIndices.push_back(index);
+	}
+
+	fRenamer->Start(*fPreviewAction, true, fPreviewListener);
+	_ContinuePreview();
+}
+
+
+/*!	Collects the results of the chunks the workers have finished so far,
+	until the time slice is used up. Finishes the preview once all items
+	are done.
+*/
+void
+RenameWindow::_ContinuePreview()
+{
+	bigtime_t deadline = system_time() + kPreviewSliceTime;
+
+	int32 first;
+	int32 end;
+	while (fRenamer->NextFinishedChunk(first, end)) {
+		for (int32 index = first; index < end; index++)
+			_AddPreviewResult(index);
+
+		if (system_time() >= deadline) {
+			BMessage next(kMsgContinuePreview);
+			next.AddInt32("generation", fPreviewGeneration);
+			PostMessage(&next);
+			return;
+		}
+	}
+
+	// Otherwise, the listener will tell us when there is more
+	if (fRenamer->IsCollected())
+		_FinishPreview();
+}
+
+
+//!	Applies the current rename action to the item at \a index.
+void
+RenameWindow::_PreviewItem(int32 index)
+{
+	PreviewItem* item = static_cast<PreviewItem*>(
+		fPreviewList->ItemAt(index));
+	if (item == NULL)
+		return;
+
+	item->SetRenameAction(*fPreviewAction);
+	_CheckPreviewItem(item);
+}
+
+
+/*!	Sets the result \a index of the ParallelRenamer to its item. The item
+	is looked up by its ref, if it is no longer at the index it had when
+	the preview was started.
+*/
+void
+RenameWindow::_AddPreviewResult(int32 index)
+{
+	const entry_ref& ref = fPreviewRefs[index];
+	PreviewItem* item = static_cast<PreviewItem*>(
+		fPreviewList->ItemAt(fPreviewIndices[index]));
+	if (item == NULL || item->Ref() != ref) {
+		item = fPreviewList->ItemForRef(ref);
+		if (item == NULL)
+			return;
+	}
+
+	const ParallelRenamer::Result& result = fRenamer->ResultAt(index);
+	item->SetRenamed(result.target, result.sourceGroups, result.targetGroups);
+	_CheckPreviewItem(item);
+}
+
+
+//!	Checks the target of \a item against those of the items already done.
+void
+RenameWindow::_CheckPreviewItem(PreviewItem* item)
+{
+	if (item->IsValid()) {
+		if (item->HasTarget()
+			&& ExpressionTemplate::HasExpressions(item->Target())) {
+			// The name is only known once the expressions have been
+			// evaluated; the RenameProcessor checks it for duplicates then
+			fPreviewValidCount++;
 		} else if (item->HasTarget()) {
-			errorCount++;
+			entry_ref targetRef = item->Ref();
+			targetRef.set_name(item->Target());
+			TargetRefMap::iterator found = fPreviewTargets.find(targetRef);
+			if (found != fPreviewTargets.end()) {
+				if (found->second == item->Ref())
+					return;
+
+				// The other item is looked up by its ref, as it might have
+				// been removed from the list in the mean time
+				PreviewItem* other = fPreviewList->ItemForRef(found->second);
+				if (other != NULL)
+					other->SetError(DUPLICATE);
+				item->SetError(DUPLICATE);
+				fPreviewErrorCount++;
+			} else {
+				fPreviewTargets.insert(std::make_pair(targetRef, item->Ref()));
+				fPreviewValidCount++;
+			}
 		}
+	} else if (item->HasTarget()) {
+		fPreviewErrorCount++;
+	}
+}
+
+
+/*!	Adds all items with a target to the check request, in the order of the
+	list, and numbers them for the counters on the way, both among all of
+	them, and among those in the same directory.
+	If the action has a replacement, it is added as well, together with
+	the target groups of every item, so that the RenameProcessor only has
+	to parse the expressions in it once.
+*/
+void
+RenameWindow::_AddPreviewChecks()
+{
+	std::map<node_ref, int32> directoryCounters;
+	int32 counter = 0;
+
+	const char* replacement = fPreviewAction->Replacement();
+	if (replacement != NULL)
+		fPreviewCheck.AddString("replacement", replacement);
+
+	int32 count = fPreviewList->CountItems();
+	for (int32 index = 0; index < count; index++) {
+		PreviewItem* item = static_cast<PreviewItem*>(
+			fPreviewList->ItemAt(index));
+		if (!item->HasTarget())
+			continue;
 
-		if (errorCount == 0 && item->HasTarget()) {
-			check.AddRef("source", &item->Ref());
-			check.AddString("target", item->Target());
+		const entry_ref& ref = item->Ref();
+		node_ref directory(ref.device, ref.directory);
+
+		fPreviewCheck.AddRef("source", &ref);
+		fPreviewCheck.AddString("target", item->Target());
+		fPreviewCheck.AddInt32("counter", counter++);
+		fPreviewCheck.AddInt32("directory counter",
+			directoryCounters[directory]++);
+		if (replacement == NULL)
+			continue;
+
+		const GroupList& groups = item->RenameGroups();
+		fPreviewCheck.AddInt32("group count", groups.CountItems());
+		for (int32 i = 0; i < groups.CountItems(); i++) {
+			fPreviewCheck.AddInt32("group start", groups.ItemAt(i)->start);
+			fPreviewCheck.AddInt32("group end", groups.ItemAt(i)->end);
 		}
 	}
+}
 
-	fPreviewList->Invalidate();
 
-	fOkButton->SetEnabled(false);
+void
+RenameWindow::_FinishPreview()
+{
+	fPreviewList->Invalidate();
 
-	if (errorCount == 0 && validCount > 0) {
+	if (fPreviewErrorCount == 0 && fPreviewValidCount > 0) {
 		// Check paths on disk
-		fRenameProcessor.SendMessage(&check, this);
+		_AddPreviewChecks();
+		fRenameProcessor.SendMessage(&fPreviewCheck, this);
 	} else if (fPreviewList->CountItems() > 0)
 		fRemoveUnchangedButton->SetEnabled(true);
 
-	delete action;
+	// Make sure no worker is still using the action
+	fRenamer->Cancel();
+
+	delete fPreviewAction;
+	fPreviewAction = NULL;
+
+	fPreviewTargets.clear();
+	fPreviewRefs.clear();
+	fPreviewIndices.clear();
+	fPreviewCheck.MakeEmpty();
 }
 
 
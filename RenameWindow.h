@@ -5,12 +5,21 @@
 #define RENAME_WINDOW_H
 
 
+#include <Entry.h>
 #include <Messenger.h>
 #include <Window.h>
 
+#include <map>
+#include <vector>
 
+
+class ParallelRenamer;
+class PreviewItem;
 class PreviewList;
+class PreviewListener;
 class RefModel;
+class RenameAction;
+class RenameProcessor;
 class RenameSettings;
 class RenameView;
 
@@ -20,6 +29,8 @@ class BMenuField;
 class BPopUpMenu;
 class BTextControl;
 
+typedef std::map<entry_ref, entry_ref> TargetRefMap;
+
 
 static const uint32 kMsgRefsRemoved = 'rfrm';
 
@@ -35,8 +46,15 @@ public:
 	virtual	void				MessageReceived(BMessage* message);
 
 private:
+			RenameAction*		_CreateAction() const;
 			void				_HandleProcessed(BMessage* message);
 			void				_UpdatePreviewItems();
+			void				_ContinuePreview();
+			void				_PreviewItem(int32 index);
+			void				_AddPreviewResult(int32 index);
+			void				_CheckPreviewItem(PreviewItem* item);
+			void				_AddPreviewChecks();
+			void				_FinishPreview();
 			void				_UpdateFilter();
 			void				_RenameFiles();
 
@@ -45,6 +63,8 @@ private:
 			BMenuField*			fActionMenuField;
 			BPopUpMenu*			fActionMenu;
 			BCardView*			fCardView;
+			BMenuField*			fPipelineMenuField;
+			BPopUpMenu*			fPipelineMenu;
 			RenameView*			fView;
 			BButton*			fOkButton;
 			BButton*			fResetRemovedButton;
@@ -53,13 +73,28 @@ private:
 			BCheckBox*			fRegExpFilterCheckBox;
 			BCheckBox*			fReverseFilterCheckBox;
 			BCheckBox*			fRecursiveCheckBox;
+			BCheckBox*			fKeepShellResultsCheckBox;
 			BMenuField*			fTypeMenuField;
 			BPopUpMenu*			fTypeMenu;
 			BMenuField*			fReplacementMenuField;
 			BPopUpMenu*			fReplacementMenu;
 			PreviewList*		fPreviewList;
 			RefModel*			fRefModel;
+			RenameProcessor*	fProcessor;
 			BMessenger			fRenameProcessor;
+
+			ParallelRenamer*	fRenamer;
+			PreviewListener*	fPreviewListener;
+			RenameAction*		fPreviewAction;
+			uint32				fPreviewGeneration;
+			int32				fFirstVisibleIndex;
+			int32				fLastVisibleIndex;
+			int32				fPreviewErrorCount;
+			int32				fPreviewValidCount;
+			TargetRefMap		fPreviewTargets;
+			std::vector<entry_ref> fPreviewRefs;
+			std::vector<int32>	fPreviewIndices;
+			BMessage			fPreviewCheck;
 };
 
 
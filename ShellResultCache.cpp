@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "ShellResultCache.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const uint32 kCacheMagic = 'RnSc';
+static const uint32 kCacheVersion = 1;
+static const uint32 kMaxStringLength = 65536;
+
+
+static bool
+write_value(FILE* file, const void* value, size_t size)
+{
+	return fwrite(value, size, 1, file) == 1;
+}
+
+
+static bool
+write_string(FILE* file, const BString& string)
+{
+	uint32 length = string.Length();
+	return write_value(file, &length, sizeof(length))
+		&& (length == 0 || fwrite(string.String(), length, 1, file) == 1);
+}
+
+
+static bool
+read_value(FILE* file, void* value, size_t size)
+{
+	return fread(value, size, 1, file) == 1;
+}
+
+
+static bool
+read_string(FILE* file, BString& string)
+{
+	uint32 length;
+	if (!read_value(file, &length, sizeof(length))
+		|| length > kMaxStringLength)
+		return false;
+
+	char* buffer = string.LockBuffer(length);
+	bool success = length == 0 || fread(buffer, length, 1, file) == 1;
+	string.UnlockBuffer(success ? length : 0);
+	return success;
+}
+
+
+//	#pragma mark - ShellResultCache::Key
+
+
+bool
+ShellResultCache::Key::operator<(const Key& other) const
+{
+	if (node != other.node)
+		return node < other.node;
+	if (device != other.device)
+		return device < other.device;
+	if (modified != other.modified)
+		return modified < other.modified;
+	if (path != other.path)
+		return path < other.path;
+	return script < other.script;
+}
+
+
+//	#pragma mark - ShellResultCache
+
+
+ShellResultCache::ShellResultCache(int32 maxEntries)
+	:
+	fMaxEntries(maxEntries),
+	fPass(1)
+{
+}
+
+
+ShellResultCache::~ShellResultCache()
+{
+}
+
+
+/*!	Looks up the output of \a script for the file at \a path, whose current
+	\a stat is given. Returns false if there is none.
+*/
+bool
+ShellResultCache::Lookup(const char* script, const char* path,
+	const struct stat& stat, BString& output)
+{
+	Key key;
+	_InitKey(key, script, path, stat);
+
+	EntryMap::iterator found = fMap.find(key);
+	if (found == fMap.end())
+		return false;
+
+	// Make it the most recently used entry
+	fEntries.splice(fEntries.end(), fEntries, found->second);
+	found->second->used = fPass;
+
+	output = found->second->output;
+	return true;
+}
+
+
+void
+ShellResultCache::Store(const char* script, const char* path,
+	const struct stat& stat, const BString& output)
+{
+	Key key;
+	_InitKey(key, script, path, stat);
+	_Add(key, output, fPass);
+}
+
+
+//!	Starts a new pass; see AttributeCache::StartPass().
+void
+ShellResultCache::StartPass()
+{
+	fPass++;
+}
+
+
+void
+ShellResultCache::MakeEmpty()
+{
+	fMap.clear();
+	fEntries.clear();
+}
+
+
+/*!	Adds the entries saved in the file at \a path to the cache. Entries of
+	files that have changed in the mean time are never found, and are
+	dropped over time; they do not belong to any pass.
+*/
+status_t
+ShellResultCache::Load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return B_FROM_POSIX_ERROR(errno);
+
+	uint32 header[3];
+	if (!read_value(file, header, sizeof(header)) || header[0] != kCacheMagic
+		|| header[1] != kCacheVersion) {
+		fclose(file);
+		return B_BAD_VALUE;
+	}
+
+	status_t status = B_OK;
+	for (uint32 index = 0; index < header[2]; index++) {
+		Entry entry;
+		int64 values[3];
+		if (!read_value(file, values, sizeof(values))
+			|| !read_string(file, entry.key.script)
+			|| !read_string(file, entry.key.path)
+			|| !read_string(file, entry.output)) {
+			status = B_BAD_VALUE;
+			break;
+		}
+
+		entry.key.device = values[0];
+		entry.key.node = values[1];
+		entry.key.modified = values[2];
+		_Add(entry.key, entry.output, 0);
+	}
+
+	fclose(file);
+	return status;
+}
+
+
+/*!	Saves the cache to the file at \a path, the least recently used entries
+	first. The file is replaced at once, when it has been written.
+*/
+status_t
+ShellResultCache::Save(const char* path) const
+{
+	BString temporaryPath(path);
+	temporaryPath << ".tmp";
+
+	FILE* file = fopen(temporaryPath.String(), "wb");
+	if (file == NULL)
+		return B_FROM_POSIX_ERROR(errno);
+
+	uint32 header[3] = {kCacheMagic, kCacheVersion, (uint32)fEntries.size()};
+	bool success = write_value(file, header, sizeof(header));
+
+	EntryList::const_iterator iterator = fEntries.begin();
+	for (; success && iterator != fEntries.end(); iterator++) {
+		const Entry& entry = *iterator;
+		int64 values[3] = {(int64)entry.key.device, (int64)entry.key.node,
+			entry.key.modified};
+
+		success = write_value(file, values, sizeof(values))
+			&& write_string(file, entry.key.script)
+			&& write_string(file, entry.key.path)
+			&& write_string(file, entry.output);
+	}
+
+	if (fclose(file) != 0)
+		success = false;
+
+	if (!success || rename(temporaryPath.String(), path) != 0) {
+		status_t status = B_FROM_POSIX_ERROR(errno);
+		remove(temporaryPath.String());
+		return success ? status : B_IO_ERROR;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Returns whether the output of \a script depends on the file it is run
+	for, because it refers to it as "$file", "$1", "$@", or "$*", with or
+	without braces. The output of other scripts cannot be told apart per
+	file, and should not be cached.
+*/
+/*static*/ bool
+ShellResultCache::IsCacheable(const char* script)
+{
+	for (const char* dollar = strchr(script, '$'); dollar != NULL;
+			dollar = strchr(dollar + 1, '$')) {
+		const char* name = dollar + 1;
+		bool braced = name[0] == '{';
+		if (braced)
+			name++;
+
+		if (!strncmp(name, "file", 4) && name[4] != '_'
+			&& !isalnum((uint8)name[4]))
+			return true;
+		if (name[0] == '@' || name[0] == '*'
+			|| (name[0] == '1' && (!braced || !isdigit((uint8)name[1]))))
+			return true;
+	}
+	return false;
+}
+
+
+/*static*/ void
+ShellResultCache::_InitKey(Key& key, const char* script, const char* path,
+	const struct stat& stat)
+{
+	key.script = script;
+	key.path = path;
+	key.device = stat.st_dev;
+	key.node = stat.st_ino;
+	key.modified = (int64)stat.st_mtim.tv_sec * 1000000000LL
+		+ stat.st_mtim.tv_nsec;
+}
+
+
+void
+ShellResultCache::_Add(const Key& key, const BString& output,
+	uint32 used)
+{
+	EntryMap::iterator found = fMap.find(key);
+	if (found != fMap.end()) {
+		found->second->output = output;
+		found->second->used = used;
+		fEntries.splice(fEntries.end(), fEntries, found->second);
+		return;
+	}
+
+	if (fMaxEntries <= 0)
+		return;
+
+	while ((int32)fEntries.size() >= fMaxEntries
+		&& fEntries.front().used != fPass) {
+		fMap.erase(fEntries.front().key);
+		fEntries.pop_front();
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.output = output;
+	entry.used = used;
+	fMap.insert(std::make_pair(key, fEntries.insert(fEntries.end(), entry)));
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef SHELL_RESULT_CACHE_H
+#define SHELL_RESULT_CACHE_H
+
+
+#include <String.h>
+
+#include <sys/stat.h>
+
+#include <list>
+#include <map>
+
+
+/*!	Remembers the output of shell scripts per file.
+
+	An output is only reused for the same script, and the same file at the
+	same path, that has not been modified since: the file is identified by
+	its device, inode, and modification time. The least recently used
+	outputs are dropped once the cache is full, but, like in the
+	AttributeCache, never those used in the current pass.
+
+	Since nothing but the file is watched, only scripts that refer to it
+	should be cached, see IsCacheable(). Even their output is reused when
+	anything else they depend on, like another file, or the time, changes.
+
+	The cache can be saved to, and loaded from a file, so that it can be
+	kept between sessions.
+*/
+class ShellResultCache {
+public:
+								ShellResultCache(int32 maxEntries = 16384);
+								~ShellResultCache();
+
+			bool				Lookup(const char* script, const char* path,
+									const struct stat& stat,
+									BString& output);
+			void				Store(const char* script, const char* path,
+									const struct stat& stat,
+									const BString& output);
+			void				StartPass();
+			void				MakeEmpty();
+			int32				CountEntries() const
+									{ return fEntries.size(); }
+
+			status_t			Load(const char* path);
+			status_t			Save(const char* path) const;
+
+	static	bool				IsCacheable(const char* script);
+
+private:
+			struct Key {
+				BString			script;
+				BString			path;
+				dev_t			device;
+				ino_t			node;
+				int64			modified;
+
+				bool			operator<(const Key& other) const;
+			};
+
+			struct Entry {
+				Key				key;
+				BString			output;
+				uint32			used;
+			};
+
+			typedef std::list<Entry> EntryList;
+			typedef std::map<Key, EntryList::iterator> EntryMap;
+
+	static	void				_InitKey(Key& key, const char* script,
+									const char* path, const struct stat& stat);
+			void				_Add(const Key& key, const BString& output,
+									uint32 used);
+
+private:
+			EntryList			fEntries;
+			EntryMap			fMap;
+			int32				fMaxEntries;
+			uint32				fPass;
+};
+
+
+#endif	// SHELL_RESULT_CACHE_H
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "ShellWorkerPool.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+
+static const bigtime_t kDefaultTimeout = 10000000;
+static const int32 kDefaultOutputLimit = 4096;
+
+/*!	The main loop of a worker: it reads the file and the script of a job,
+	both terminated by a null byte, and answers with the output of the
+	script, and its exit status, terminated the same way. The sub shell
+	keeps the script from changing the worker, and from reading its jobs.
+*/
+static const char* kWorkerScript =
+	"while IFS= read -r -d '' file && IFS= read -r -d '' script; do\n"
+	"	output=$(export file; set -- \"$file\"; eval \"$script\" "
+		"</dev/null 2>/dev/null)\n"
+	"	status=$?\n"
+	"	printf '%s\\0%d\\0' \"$output\" \"$status\"\n"
+	"done\n";
+
+
+static bigtime_t
+current_time()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (bigtime_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+
+/*!	Writes all of \a data to \a fd. SIGPIPE is blocked for the calling
+	thread meanwhile, so that writing to a worker that died just fails with
+	EPIPE, without changing how the rest of the application handles the
+	signal. A SIGPIPE caused by the write is consumed before the signal
+	mask is restored.
+*/
+static bool
+write_fully(int fd, const char* data, size_t length)
+{
+	sigset_t pipeSet;
+	sigemptyset(&pipeSet);
+	sigaddset(&pipeSet, SIGPIPE);
+
+	sigset_t oldSet;
+	pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+	// A SIGPIPE that was pending before is not ours to consume
+	sigset_t pendingSet;
+	sigpending(&pendingSet);
+	bool wasPending = sigismember(&pendingSet, SIGPIPE);
+
+	bool success = true;
+	while (length > 0) {
+		ssize_t bytesWritten = write(fd, data, length);
+		if (bytesWritten < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EPIPE && !wasPending) {
+				struct timespec timeout = {0, 0};
+				while (sigtimedwait(&pipeSet, NULL, &timeout) < 0
+					&& errno == EINTR) {
+				}
+			}
+			success = false;
+			break;
+		}
+		data += bytesWritten;
+		length -= bytesWritten;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &oldSet, NULL);
+	return success;
+}
+
+
+//	#pragma mark - ShellWorkerPool
+
+
+/*!	Creates a pool with up to \a maxWorkers workers, or one per CPU, if
+	\a maxWorkers is zero or less. The workers are only started when they
+	are needed.
+*/
+ShellWorkerPool::ShellWorkerPool(int32 maxWorkers)
+	:
+	fMaxWorkers(0),
+	fTimeout(kDefaultTimeout),
+	fOutputLimit(kDefaultOutputLimit)
+{
+	SetMaxWorkers(maxWorkers);
+}
+
+
+ShellWorkerPool::~ShellWorkerPool()
+{
+	for (size_t index = 0; index < fWorkers.size(); index++) {
+		Worker& worker = fWorkers[index];
+		if (worker.pid < 0)
+			continue;
+
+		// Idle workers quit when their input is closed
+		close(worker.input);
+		close(worker.output);
+		waitpid(worker.pid, NULL, 0);
+	}
+}
+
+
+void
+ShellWorkerPool::SetMaxWorkers(int32 maxWorkers)
+{
+	if (maxWorkers <= 0) {
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		maxWorkers = count > 0 ? count : 1;
+	}
+
+	for (size_t index = maxWorkers; index < fWorkers.size(); index++)
+		_Kill(fWorkers[index]);
+
+	Worker idle;
+	idle.pid = -1;
+	idle.input = -1;
+	idle.output = -1;
+	idle.job = NULL;
+	fWorkers.resize(maxWorkers, idle);
+	fMaxWorkers = maxWorkers;
+}
+
+
+//!	Sets the time a single job may take, in microseconds.
+void
+ShellWorkerPool::SetTimeout(bigtime_t timeout)
+{
+	fTimeout = timeout;
+}
+
+
+//!	Sets the maximum number of bytes kept of the output of a job.
+void
+ShellWorkerPool::SetOutputLimit(int32 limit)
+{
+	fOutputLimit = limit;
+}
+
+
+/*!	Runs all \a jobs, and waits until all of them are done. Their output
+	is stored in the jobs.
+*/
+void
+ShellWorkerPool::Run(Job* jobs, int32 count)
+{
+	std::vector<struct pollfd> fds;
+	std::vector<Worker*> busy;
+	int32 next = 0;
+	int32 done = 0;
+
+	while (done < count) {
+		// Hand out jobs to idle workers
+		bool hasWorker = false;
+		for (size_t index = 0; index < fWorkers.size() && next < count;
+				index++) {
+			Worker& worker = fWorkers[index];
+			if (worker.pid < 0 && !_Spawn(worker))
+				continue;
+
+			hasWorker = true;
+			if (worker.job != NULL)
+				continue;
+
+			Job& job = jobs[next++];
+			if (!_Send(worker, job)) {
+				_Kill(worker);
+				done++;
+			}
+		}
+
+		fds.clear();
+		busy.clear();
+		bigtime_t deadline = -1;
+		for (size_t index = 0; index < fWorkers.size(); index++) {
+			Worker& worker = fWorkers[index];
+			if (worker.job == NULL)
+				continue;
+
+			struct pollfd fd = {worker.output, POLLIN, 0};
+			fds.push_back(fd);
+			busy.push_back(&worker);
+
+			if (deadline < 0 || worker.deadline < deadline)
+				deadline = worker.deadline;
+		}
+
+		if (busy.empty()) {
+			if (!hasWorker && next < count) {
+				// No shell could be started; all remaining jobs fail
+				while (next < count) {
+					jobs[next].output.Truncate(0);
+					jobs[next++].succeeded = false;
+					done++;
+				}
+			}
+			continue;
+		}
+
+		bigtime_t timeout = deadline - current_time();
+		if (timeout < 0)
+			timeout = 0;
+
+		int result = poll(&fds[0], fds.size(), (timeout + 999) / 1000);
+		if (result < 0 && errno != EINTR)
+			break;
+
+		bigtime_t now = current_time();
+		for (size_t index = 0; index < busy.size(); index++) {
+			Worker& worker = *busy[index];
+			if ((fds[index].revents & (POLLIN | POLLHUP | POLLERR)) != 0) {
+				if (_Receive(worker))
+					done++;
+			} else if (worker.deadline <= now) {
+				worker.job->output.Truncate(0);
+				_Kill(worker);
+				done++;
+			}
+		}
+	}
+}
+
+
+BString
+ShellWorkerPool::Execute(const char* path, const char* script)
+{
+	Job job(path, script);
+	Run(&job, 1);
+	return job.output;
+}
+
+
+bool
+ShellWorkerPool::_Spawn(Worker& worker)
+{
+	int input[2];
+	int output[2];
+	if (pipe(input) != 0)
+		return false;
+	if (pipe(output) != 0) {
+		close(input[0]);
+		close(input[1]);
+		return false;
+	}
+
+	// Other workers must not inherit our ends of the pipes
+	fcntl(input[1], F_SETFD, FD_CLOEXEC);
+	fcntl(output[0], F_SETFD, FD_CLOEXEC);
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		// Put the worker and everything it starts into its own process
+		// group, so that all of it can be killed at once
+		setpgid(0, 0);
+
+		dup2(input[0], STDIN_FILENO);
+		dup2(output[1], STDOUT_FILENO);
+		int null = open("/dev/null", O_WRONLY);
+		if (null >= 0)
+			dup2(null, STDERR_FILENO);
+
+		close(input[0]);
+		close(output[1]);
+
+		execlp("bash", "bash", "-c", kWorkerScript, (char*)NULL);
+		_exit(127);
+	}
+
+	close(input[0]);
+	close(output[1]);
+
+	if (pid < 0) {
+		close(input[1]);
+		close(output[0]);
+		return false;
+	}
+
+	worker.pid = pid;
+	worker.input = input[1];
+	worker.output = output[0];
+	worker.job = NULL;
+	return true;
+}
+
+
+void
+ShellWorkerPool::_Kill(Worker& worker)
+{
+	if (worker.pid < 0)
+		return;
+
+	kill(-worker.pid, SIGKILL);
+	kill(worker.pid, SIGKILL);
+	close(worker.input);
+	close(worker.output);
+	waitpid(worker.pid, NULL, 0);
+
+	worker.pid = -1;
+	worker.input = -1;
+	worker.output = -1;
+	worker.job = NULL;
+}
+
+
+bool
+ShellWorkerPool::_Send(Worker& worker, Job& job)
+{
+	job.output.Truncate(0);
+	job.succeeded = false;
+
+	if (!write_fully(worker.input, job.path.String(), job.path.Length() + 1)
+		|| !write_fully(worker.input, job.script.String(),
+			job.script.Length() + 1))
+		return false;
+
+	worker.job = &job;
+	worker.outputLength = 0;
+	worker.readingStatus = false;
+	worker.status = 0;
+	worker.deadline = current_time() + fTimeout;
+	return true;
+}
+
+
+/*!	Reads the output of the worker's job, followed by its exit status.
+	Returns true if the job is done; in case of an error, the worker is
+	killed, and the output is dropped.
+*/
+bool
+ShellWorkerPool::_Receive(Worker& worker)
+{
+	char buffer[4096];
+	ssize_t bytesRead = read(worker.output, buffer, sizeof(buffer));
+	if (bytesRead < 0 && errno == EINTR)
+		return false;
+	if (bytesRead <= 0) {
+		worker.job->output.Truncate(0);
+		_Kill(worker);
+		return true;
+	}
+
+	const char* position = buffer;
+	const char* bufferEnd = buffer + bytesRead;
+	while (position < bufferEnd) {
+		const char* end = (const char*)memchr(position, '\0',
+			bufferEnd - position);
+		if (end == NULL)
+			end = bufferEnd;
+
+		if (worker.readingStatus) {
+			for (; position < end; position++) {
+				if (*position >= '0' && *position <= '9')
+					worker.status = worker.status * 10 + *position - '0';
+			}
+		} else {
+			// Append everything but the newlines, up to the limit
+			while (position < end && worker.outputLength < fOutputLimit) {
+				const char* newline = (const char*)memchr(position, '\n',
+					end - position);
+				int32 length = (newline != NULL ? newline : end) - position;
+				if (length > fOutputLimit - worker.outputLength)
+					length = fOutputLimit - worker.outputLength;
+
+				worker.job->output.Append(position, length);
+				worker.outputLength += length;
+				position = newline != NULL ? newline + 1 : end;
+			}
+		}
+
+		if (end == bufferEnd)
+			return false;
+
+		position = end + 1;
+		if (!worker.readingStatus) {
+			worker.readingStatus = true;
+			continue;
+		}
+
+		worker.job->succeeded = worker.status == 0;
+		worker.job = NULL;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef SHELL_WORKER_POOL_H
+#define SHELL_WORKER_POOL_H
+
+
+#include <String.h>
+
+#include <vector>
+
+
+/*!	Runs shell scripts for files in a pool of long-lived shells.
+
+	Each worker is a bash process that reads its jobs from a pipe, so there
+	is no fork and exec of a new shell per job; the script itself runs in
+	a sub shell of the worker. The file is passed with every job, and is
+	available to the script as "$file", and "$1". As before, all newlines
+	are removed from the output.
+
+	Up to MaxWorkers() jobs run at the same time. A job that does not
+	finish in time has its worker killed, and results in an empty output,
+	as does a job that fails; output beyond the limit is dropped. Only a
+	job whose script finished in time, with an exit status of zero, is
+	marked as succeeded.
+
+	The pool must only be used from one thread at a time.
+*/
+class ShellWorkerPool {
+public:
+	struct Job {
+		BString					path;
+		BString					script;
+		BString					output;
+		bool					succeeded;
+
+		Job()
+			:
+			succeeded(false)
+		{
+		}
+
+		Job(const char* path, const char* script)
+			:
+			path(path),
+			script(script),
+			succeeded(false)
+		{
+		}
+	};
+
+								ShellWorkerPool(int32 maxWorkers = 0);
+								~ShellWorkerPool();
+
+			int32				MaxWorkers() const
+									{ return fMaxWorkers; }
+			void				SetMaxWorkers(int32 maxWorkers);
+			bigtime_t			Timeout() const
+									{ return fTimeout; }
+			void				SetTimeout(bigtime_t timeout);
+			int32				OutputLimit() const
+									{ return fOutputLimit; }
+			void				SetOutputLimit(int32 limit);
+
+			void				Run(Job* jobs, int32 count);
+			BString				Execute(const char* path,
+									const char* script);
+
+private:
+			struct Worker {
+				pid_t			pid;
+				int				input;
+				int				output;
+				Job*			job;
+				int32			outputLength;
+				bool			readingStatus;
+				int32			status;
+				bigtime_t		deadline;
+			};
+
+			bool				_Spawn(Worker& worker);
+			void				_Kill(Worker& worker);
+			bool				_Send(Worker& worker, Job& job);
+			bool				_Receive(Worker& worker);
+
+private:
+			std::vector<Worker>	fWorkers;
+			int32				fMaxWorkers;
+			bigtime_t			fTimeout;
+			int32				fOutputLimit;
+};
+
+
+#endif	// SHELL_WORKER_POOL_H
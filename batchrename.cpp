@@ -6,86 +6,278 @@
 
 #include "batchrename.h"
 
-#include "RenameSettings.h"
-#include "RenameWindow.h"
-
-#include <Application.h>
-#include <Entry.h>
-#include <File.h>
-#include <Directory.h>
-#include <Path.h>
-
+#include "CaseRenameAction.h"
+#include "ExpressionEvaluator.h"
+#include "FileSystem.h"
+#include "PipelineRenameAction.h"
+#include "RefFilter.h"
+#include "RegularExpressionRenameAction.h"
+#include "SearchReplaceRenameAction.h"
+#include "WindowsRenameAction.h"
+
+#ifdef __HAIKU__
+#	include "RenameSettings.h"
+#	include "RenameWindow.h"
+
+#	include <Application.h>
+#	include <Entry.h>
+#endif
+
+#include <StorageDefs.h>
+#include <String.h>
+
+#include <errno.h>
 #include <getopt.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <map>
 
 
 extern const char* __progname;
 const char* kProgramName = __progname;
 
 
+enum {
+	kOptionRemoveMatching = 256,
+	kOptionNoRecursive,
+	kOptionReplacements,
+	kOptionCaseExtension,
+	kOptionForce,
+	kOptionShellCache
+};
+
 static struct option const kOptions[] = {
 	{"ui", no_argument, 0, 'u'},
 	{"verbose", no_argument, 0, 'v'},
 	{"help", no_argument, 0, 'h'},
+	{"dry-run", no_argument, 0, 'n'},
+	{"search", required_argument, 0, 's'},
+	{"regex", required_argument, 0, 'e'},
+	{"replace", required_argument, 0, 'r'},
+	{"ignore-case", no_argument, 0, 'i'},
+	{"ignore-extension", no_argument, 0, 'x'},
+	{"global", no_argument, 0, 'g'},
+	{"case", required_argument, 0, 'c'},
+	{"case-extension", required_argument, 0, kOptionCaseExtension},
+	{"force", no_argument, 0, kOptionForce},
+	{"windows", optional_argument, 0, 'w'},
+	{"filter", required_argument, 0, 'f'},
+	{"filter-regex", required_argument, 0, 'F'},
+	{"remove-matching", no_argument, 0, kOptionRemoveMatching},
+	{"type", required_argument, 0, 't'},
+	{"no-recursive", no_argument, 0, kOptionNoRecursive},
+	{"replacements", required_argument, 0, kOptionReplacements},
+	{"shell-cache", required_argument, 0, kOptionShellCache},
 	{0, 0, 0, 0}
 };
 
 
+enum replacement_mode {
+	MAY_ALL_BE_MISSING,
+	NEED_ANY,
+	NEED_ALL
+};
+
+
 bool gRecursive = true;
 bool gVerbose = false;
+bool gDryRun = false;
+replacement_mode gReplacementMode = MAY_ALL_BE_MISSING;
+RenameAction* gAction = NULL;
+RefFilter* gFilter = NULL;
+FileSystem& gFileSystem = FileSystem::Default();
+ExpressionEvaluator gEvaluator(gFileSystem);
+int32 gErrorCount = 0;
+int32 gCounter = 0;
+std::map<BString, int32> gDirectoryCounters;
+
+
+//!	Sorts names like the preview of the user interface does.
+static bool
+compareNames(const BString& a, const BString& b)
+{
+	return strcasecmp(a.String(), b.String()) < 0;
+}
 
 
+/*!	Runs a single entry through the rename pipeline: filter, rename action,
+	expression evaluation, existence check, and finally the actual rename.
+*/
 status_t
-handleFile(BEntry& entry)
+handleFile(const char* directory, const char* name, bool isDirectory)
 {
-	char name[B_FILE_NAME_LENGTH];
-	entry.GetName(name);
+	if (gFilter != NULL && !gFilter->Accept(name, isDirectory))
+		return B_OK;
+
+	// There is no preview to show the groups in
+	GroupList sourceGroups(false);
+	GroupList targetGroups(false);
+	BString target = gAction->Rename(sourceGroups, targetGroups, name);
+	if (target == name)
+		return B_OK;
+
+	BString path(directory);
+	path << "/" << name;
+
+	// Every file is only evaluated once, so it is a pass of its own, and
+	// the caches do not grow beyond their size
+	gEvaluator.StartPass();
+
+	// Only the entries that are renamed are counted
+	gEvaluator.SetCounters(gCounter++, gDirectoryCounters[directory]++);
+
+	BString result;
+	int32 emptyCount;
+	int32 expressionCount = gEvaluator.Evaluate(path.String(), target, result,
+		emptyCount);
+	if (expressionCount > 0
+		&& ((gReplacementMode == NEED_ANY && emptyCount == expressionCount)
+			|| (gReplacementMode == NEED_ALL && emptyCount > 0))) {
+		fprintf(stderr, "%s: missing replacement for \"%s\".\n", kProgramName,
+			path.String());
+		return B_BAD_VALUE;
+	}
+	if (result.IsEmpty() || result == name)
+		return B_OK;
 
-	// Open File (on error, return showing error)
+	BString targetPath(directory);
+	targetPath << "/" << result;
 
-	BFile file(&entry, B_READ_ONLY);
-	if (file.InitCheck() < B_OK) {
-		fprintf(stderr, "could not open '%s'.\n", name);
-		return B_IO_ERROR;
+	if (gFileSystem.Exists(targetPath.String())) {
+		fprintf(stderr, "%s: cannot rename \"%s\": \"%s\" already exists.\n",
+			kProgramName, path.String(), result.String());
+		return B_FILE_EXISTS;
 	}
-	return B_OK;
+
+	if (gDryRun || gVerbose)
+		printf("%s -> %s\n", path.String(), result.String());
+	if (gDryRun)
+		return B_OK;
+
+	status_t status = B_OK;
+	int32 slash = targetPath.FindLast('/');
+	if (result.FindFirst('/') >= 0) {
+		status = gFileSystem.CreateDirectory(
+			BString(targetPath.String(), slash).String());
+	}
+	if (status == B_OK)
+		status = gFileSystem.Rename(path.String(), targetPath.String());
+
+	if (status != B_OK) {
+		fprintf(stderr, "%s: renaming \"%s\" failed: %s\n", kProgramName,
+			path.String(), strerror(B_TO_POSIX_ERROR(status)));
+	}
+	return status;
 }
 
 
 bool
-handleDirectory(BEntry &entry, int32 level)
+handleDirectory(const char* path, int32 level)
 {
-	BPath path(&entry);
-
-	if (!entry.IsDirectory()) {
-		fprintf(stderr, "\"%s\" is not a directory\n", path.Path());
+	// Renaming changes the directory while we iterate over it, so we only
+	// collect the names of this directory before working on them.
+	NameList names;
+	status_t status = gFileSystem.ReadDirectory(path, names);
+	if (status != B_OK) {
+		fprintf(stderr, "%s: could not open \"%s\": %s\n", kProgramName, path,
+			strerror(B_TO_POSIX_ERROR(status)));
+		gErrorCount++;
 		return false;
 	}
 
-	BDirectory directory(&entry);
-	BEntry entryIterator;
+	// Give the counters a defined order
+	std::sort(names.begin(), names.end(), compareNames);
 
-	directory.Rewind();
-	while (directory.GetNextEntry(&entryIterator, false) == B_OK) {
-		if (entryIterator.IsDirectory()) {
-			if (gRecursive)
-				handleDirectory(entryIterator, level + 1);
+	for (size_t index = 0; index < names.size(); index++) {
+		const char* name = names[index].String();
 
-			continue;
-		}
+		BString childPath(path);
+		childPath << "/" << name;
 
-		if (handleFile(entryIterator) < B_OK)
+		struct stat stat;
+		if (gFileSystem.GetStat(childPath.String(), stat) != B_OK)
 			continue;
+
+		bool isDirectory = S_ISDIR(stat.st_mode);
+		if (isDirectory && gRecursive)
+			handleDirectory(childPath.String(), level + 1);
+
+		if (handleFile(path, name, isDirectory) != B_OK)
+			gErrorCount++;
 	}
 
 	return true;
 }
 
 
+void
+handleArgument(const char* argument)
+{
+	// Only the directory is resolved, so that a symbolic link is renamed
+	// itself, and not the file it points to. With a trailing slash, or a
+	// "." or ".." at its end, the argument names a directory, though.
+	const char* leaf = strrchr(argument, '/');
+	leaf = leaf != NULL ? leaf + 1 : argument;
+	bool resolveAll = leaf[0] == '\0' || !strcmp(leaf, ".")
+		|| !strcmp(leaf, "..");
+
+	BString parent(argument, leaf - argument);
+	if (parent.IsEmpty())
+		parent = ".";
+
+	char resolved[PATH_MAX];
+	const char* toResolve = resolveAll ? argument : parent.String();
+	if (realpath(toResolve, resolved) == NULL) {
+		fprintf(stderr, "%s: could not access \"%s\": %s\n", kProgramName,
+			argument, strerror(errno));
+		gErrorCount++;
+		return;
+	}
+
+	BString path(resolved);
+	if (!resolveAll) {
+		if (path != "/")
+			path << "/";
+		path << leaf;
+	}
+
+	struct stat stat;
+	status_t status = gFileSystem.GetStat(path.String(), stat);
+	if (status != B_OK) {
+		fprintf(stderr, "%s: could not access \"%s\": %s\n", kProgramName,
+			argument, strerror(B_TO_POSIX_ERROR(status)));
+		gErrorCount++;
+		return;
+	}
+
+	bool isDirectory = S_ISDIR(stat.st_mode);
+	if (isDirectory && gRecursive)
+		handleDirectory(path.String(), 0);
+
+	int32 slash = path.FindLast('/');
+	if (slash < 0 || slash == path.Length() - 1) {
+		// The root directory cannot be renamed
+		return;
+	}
+
+	BString directory(path.String(), slash);
+	if (directory.IsEmpty())
+		directory = "/";
+	if (handleFile(directory.String(), path.String() + slash + 1,
+			isDirectory) != B_OK)
+		gErrorCount++;
+}
+
+
 //	#pragma mark -
 
 
+#ifdef __HAIKU__
 extern "C" void
 process_refs(entry_ref directoryRef, BMessage* msg, void*)
 {
@@ -100,39 +292,129 @@ process_refs(entry_ref directoryRef, BMessage* msg, void*)
 
 	wait_for_thread(window->Thread(), NULL);
 }
+#endif
 
 
 void
 printUsage()
 {
 	printf("Copyright (c) 2019-2024 pinc software.\n"
-		"Usage: %s [-vrmfictds] <list of directories>\n"
-		"  -v\tverbose mode\n"
-		"  -u\tshow UI\n",
+		"Usage: %s [options] <list of directories/files>\n"
+		"  -s, --search=<pattern>\tsearch for a pattern, supports * and ?\n"
+		"  -e, --regex=<pattern>\t\tsearch for a regular expression\n"
+		"  -r, --replace=<text>\t\treplacement for the search or regular\n"
+		"\t\t\t\texpression, may contain $(attribute) and $[script]\n"
+		"  -i, --ignore-case\t\tcase insensitive search\n"
+		"  -x, --ignore-extension\tleave the file extension alone\n"
+		"  -g, --global\t\t\treplace all matches of the regular "
+			"expression\n"
+		"  -c, --case=<mode>\t\tchange case: title, upper, or lower\n"
+		"      --case-extension=<mode>\textension case: lower, upper, keep,\n"
+		"\t\t\t\tor same (as --case)\n"
+		"      --force\t\t\tforce title case on all characters\n"
+		"  -w, --windows[=<text>]\treplace characters that are invalid on\n"
+		"\t\t\t\tWindows, default is \"_\"\n"
+		"  -f, --filter=<text>\t\tonly rename entries containing the text\n"
+		"  -F, --filter-regex=<pattern>\tonly rename entries matching the "
+			"pattern\n"
+		"      --remove-matching\t\treverse the filter\n"
+		"  -t, --type=<type>\t\tonly rename files, or folders\n"
+		"      --no-recursive\t\tdo not enter directories recursively\n"
+		"      --replacements=<mode>\t\"any\" or \"all\" replacements must "
+			"be set\n"
+		"      --shell-cache=<file>\tkeep the output of $[script] in the "
+			"file,\n"
+		"\t\t\t\tand reuse it for unchanged files\n"
+		"  -n, --dry-run\t\t\tonly show what would be renamed\n"
+		"  -v, --verbose\t\t\tverbose mode\n"
+		"  -u, --ui\t\t\tshow UI\n"
+		"Several rename methods can be combined; they are applied in the "
+			"given order.\n",
 		kProgramName);
 }
 
 
+/*!	Adds a rename method; if more than one is given, they are run one
+	after the other, in the order they were specified.
+*/
+static void
+addAction(RenameAction* action)
+{
+	if (gAction == NULL) {
+		gAction = action;
+		return;
+	}
+
+	// Several rename methods are run one after the other
+	PipelineRenameAction* pipeline
+		= dynamic_cast<PipelineRenameAction*>(gAction);
+	if (pipeline == NULL) {
+		pipeline = new PipelineRenameAction();
+		pipeline->AddAction(gAction);
+		gAction = pipeline;
+	}
+	pipeline->AddAction(action);
+}
+
+
 int
 main(int argc, char** argv)
 {
-	BApplication app("application/x-vnd.pinc.rename");
-
+#ifdef __HAIKU__
 	// $TERM is not defined when launched from Tracker
 	bool useUI = getenv("TERM") == NULL;
+#else
+	bool useUI = false;
+#endif
 
 	if (argc == 1 && !useUI) {
 		printUsage();
 		return 1;
 	}
 
+	const char* search = NULL;
+	const char* regex = NULL;
+	const char* replace = "";
+	const char* filterText = NULL;
+	bool filterRegex = false;
+	bool removeMatching = false;
+	bool caseInsensitive = false;
+	bool ignoreExtension = false;
+	bool global = false;
+	bool forceUI = false;
+	int32 type = 0;
+	int32 caseMode = -1;
+	extension_mode extensionMode = LOWER_CASE_EXTENSION;
+	bool forceCase = false;
+	const char* windowsReplace = NULL;
+	const char* shellCache = NULL;
+	int methods[4];
+	int32 methodCount = 0;
+
 	int c;
-	while ((c = getopt_long(argc, argv, "uhv", kOptions, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "uhvns:e:r:ixgc:w::f:F:t:", kOptions,
+			NULL)) != -1) {
+		switch (c) {
+			case 's':
+			case 'e':
+			case 'c':
+			case 'w':
+			{
+				// Remember the order of the rename methods
+				int32 index = 0;
+				while (index < methodCount && methods[index] != c)
+					index++;
+				if (index == methodCount)
+					methods[methodCount++] = c;
+				break;
+			}
+		}
+
 		switch (c) {
 			case 0:
 				break;
 			case 'u':
-				useUI = true;
+				forceUI = true;
 				break;
 			case 'h':
 				printUsage();
@@ -140,32 +422,244 @@ main(int argc, char** argv)
 			case 'v':
 				gVerbose = true;
 				break;
+			case 'n':
+				gDryRun = true;
+				break;
+			case 's':
+				search = optarg;
+				break;
+			case 'e':
+				regex = optarg;
+				break;
+			case 'r':
+				replace = optarg;
+				break;
+			case 'i':
+				caseInsensitive = true;
+				break;
+			case 'x':
+				ignoreExtension = true;
+				break;
+			case 'g':
+				global = true;
+				break;
+			case 'c':
+				if (!strcmp(optarg, "title"))
+					caseMode = TITLE_CASE;
+				else if (!strcmp(optarg, "upper"))
+					caseMode = UPPER_CASE;
+				else if (!strcmp(optarg, "lower"))
+					caseMode = LOWER_CASE;
+				else {
+					fprintf(stderr, "%s: unknown case mode \"%s\".\n",
+						kProgramName, optarg);
+					return 1;
+				}
+				break;
+			case kOptionCaseExtension:
+				if (!strcmp(optarg, "lower"))
+					extensionMode = LOWER_CASE_EXTENSION;
+				else if (!strcmp(optarg, "upper"))
+					extensionMode = UPPER_CASE_EXTENSION;
+				else if (!strcmp(optarg, "keep"))
+					extensionMode = LEAVE_EXTENSION_UNCHANGED;
+				else if (!strcmp(optarg, "same"))
+					extensionMode = USE_CASE_MODE;
+				else {
+					fprintf(stderr, "%s: unknown extension mode \"%s\".\n",
+						kProgramName, optarg);
+					return 1;
+				}
+				break;
+			case kOptionForce:
+				forceCase = true;
+				break;
+			case 'w':
+				windowsReplace = optarg;
+				break;
+			case 'f':
+				filterText = optarg;
+				break;
+			case 'F':
+				filterText = optarg;
+				filterRegex = true;
+				break;
+			case kOptionRemoveMatching:
+				removeMatching = true;
+				break;
+			case 't':
+				if (!strcmp(optarg, "files"))
+					type = 1;
+				else if (!strcmp(optarg, "folders"))
+					type = 2;
+				else {
+					fprintf(stderr, "%s: unknown type \"%s\".\n",
+						kProgramName, optarg);
+					return 1;
+				}
+				break;
+			case kOptionNoRecursive:
+				gRecursive = false;
+				break;
+			case kOptionReplacements:
+				if (!strcmp(optarg, "any"))
+					gReplacementMode = NEED_ANY;
+				else if (!strcmp(optarg, "all"))
+					gReplacementMode = NEED_ALL;
+				else {
+					fprintf(stderr, "%s: unknown replacement mode \"%s\".\n",
+						kProgramName, optarg);
+					return 1;
+				}
+				break;
+			case kOptionShellCache:
+				shellCache = optarg;
+				break;
 			default:
 				printUsage();
 				return 1;
 		}
 	}
 
-	RenameWindow* window = NULL;
-	RenameSettings settings;
-	if (useUI) {
-		window = new RenameWindow(settings);
+	for (int32 index = 0; index < methodCount; index++) {
+		switch (methods[index]) {
+			case 's':
+			{
+				SearchReplaceRenameAction* action
+					= new SearchReplaceRenameAction();
+				action->SetPattern(search);
+				action->SetReplace(replace);
+				action->SetCaseInsensitive(caseInsensitive);
+				action->SetIgnoreExtension(ignoreExtension);
+				addAction(action);
+				break;
+			}
+			case 'e':
+			{
+				RegularExpressionRenameAction* action
+					= new RegularExpressionRenameAction();
+				if (!action->SetPattern(regex, caseInsensitive)) {
+					fprintf(stderr, "%s: invalid regular expression "
+						"\"%s\".\n", kProgramName, regex);
+					delete action;
+					delete gAction;
+					return 1;
+				}
+				action->SetReplace(replace);
+				action->SetIgnoreExtension(ignoreExtension);
+				action->SetGlobal(global);
+				addAction(action);
+				break;
+			}
+			case 'c':
+			{
+				CaseRenameAction* action = new CaseRenameAction();
+				action->SetMode((case_mode)caseMode);
+				action->SetExtensionMode(extensionMode);
+				action->SetForce(forceCase);
+				addAction(action);
+				break;
+			}
+			case 'w':
+			{
+				WindowsRenameAction* action = new WindowsRenameAction();
+				if (windowsReplace != NULL)
+					action->SetReplaceString(windowsReplace);
+				addAction(action);
+				break;
+			}
+		}
 	}
 
-	for (int index = optind; index < argc; index++) {
-		if (useUI) {
+	// Only show the UI when no rename method was specified
+	if (gAction != NULL)
+		useUI = false;
+	if (forceUI)
+		useUI = true;
+
+#ifdef __HAIKU__
+	if (useUI) {
+		BApplication app("application/x-vnd.pinc.rename");
+
+		RenameSettings settings;
+		RenameWindow* window = new RenameWindow(settings);
+
+		for (int index = optind; index < argc; index++) {
 			entry_ref ref;
 			status_t status = get_ref_for_path(argv[index], &ref);
 			if (status == B_OK)
 				window->AddRef(ref);
 		}
-	}
 
-	if (useUI) {
 		window->Show();
 
 		wait_for_thread(window->Thread(), NULL);
+		return 0;
+	}
+#else
+	if (useUI) {
+		fprintf(stderr, "%s: the UI is only available on Haiku.\n",
+			kProgramName);
+		return 1;
+	}
+#endif
+
+	if (gAction == NULL) {
+		fprintf(stderr, "%s: no rename method specified.\n", kProgramName);
+		printUsage();
+		return 1;
+	}
+	if (optind == argc) {
+		fprintf(stderr, "%s: no files or directories specified.\n",
+			kProgramName);
+		return 1;
+	}
+
+	// Build filter, the same way the UI does
+	RefFilter* textFilter = NULL;
+	if (filterText != NULL && filterText[0] != '\0') {
+		if (filterRegex)
+			textFilter = new RegularExpressionFilter(filterText);
+		else
+			textFilter = new TextFilter(filterText);
+
+		if (removeMatching)
+			textFilter = new ReverseFilter(textFilter);
+	}
+
+	RefFilter* typeFilter = NULL;
+	if (type == 1)
+		typeFilter = new FilesOnlyFilter();
+	else if (type == 2)
+		typeFilter = new FoldersOnlyFilter();
+
+	AndFilter* filter = new AndFilter();
+	filter->AddFilter(typeFilter);
+	filter->AddFilter(textFilter);
+	if (!filter->IsEmpty())
+		gFilter = filter;
+
+	if (shellCache != NULL) {
+		status_t status = gEvaluator.ShellCache().Load(shellCache);
+		if (status != B_OK && status != B_ENTRY_NOT_FOUND) {
+			fprintf(stderr, "%s: could not load shell cache \"%s\": %s\n",
+				kProgramName, shellCache, strerror(B_TO_POSIX_ERROR(status)));
+		}
+	}
+
+	for (int index = optind; index < argc; index++)
+		handleArgument(argv[index]);
+
+	if (shellCache != NULL) {
+		status_t status = gEvaluator.ShellCache().Save(shellCache);
+		if (status != B_OK) {
+			fprintf(stderr, "%s: could not save shell cache \"%s\": %s\n",
+				kProgramName, shellCache, strerror(B_TO_POSIX_ERROR(status)));
+		}
 	}
 
-	return 0;
+	delete filter;
+	delete gAction;
+
+	return gErrorCount == 0 ? 0 : 1;
 }
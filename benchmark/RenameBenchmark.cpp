@@ -0,0 +1,581 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+/*!	Micro benchmark for the RenameAction::Rename() implementations.
+
+	Every action configuration is run over a number of generated name
+	corpora, and one tab separated line is printed per pair, containing the
+	time, the number of bytes and allocations, and the number of Group
+	objects per name. The checksum covers the resulting names and groups,
+	so that optimizations can be verified not to change the output.
+
+	With "--threads", the names are renamed by a ParallelRenamer instead;
+	the checksum is then computed after the run, and not timed.
+*/
+
+
+#include "CaseRenameAction.h"
+#include "ParallelRenamer.h"
+#include "PipelineRenameAction.h"
+#include "RegularExpressionRenameAction.h"
+#include "SearchReplaceRenameAction.h"
+#include "WindowsRenameAction.h"
+
+#include <StorageDefs.h>
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+
+#ifdef __GLIBC__
+// Count all allocations, including those of BString, and ICU
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* buffer, size_t size);
+extern "C" void __libc_free(void* buffer);
+#	define HAS_ALLOCATION_COUNT
+#endif
+
+
+extern const char* __progname;
+static const char* kProgramName = __progname;
+
+static const int32 kDefaultNameCount = 100000;
+static const int32 kDefaultRuns = 3;
+
+
+struct Corpus {
+	const char*			name;
+	std::vector<BString> names;
+};
+
+struct Configuration {
+	const char*			action;
+	const char*			name;
+	RenameAction*		renameAction;
+};
+
+typedef std::vector<Corpus> CorpusList;
+typedef std::vector<Configuration> ConfigurationList;
+
+
+static uint64 sAllocatedBytes;
+static uint64 sAllocationCount;
+
+
+#ifdef HAS_ALLOCATION_COUNT
+
+
+extern "C" void*
+malloc(size_t size) noexcept
+{
+	sAllocatedBytes += size;
+	sAllocationCount++;
+	return __libc_malloc(size);
+}
+
+
+extern "C" void*
+calloc(size_t count, size_t size) noexcept
+{
+	sAllocatedBytes += count * size;
+	sAllocationCount++;
+	return __libc_calloc(count, size);
+}
+
+
+extern "C" void*
+realloc(void* buffer, size_t size) noexcept
+{
+	sAllocatedBytes += size;
+	sAllocationCount++;
+	return __libc_realloc(buffer, size);
+}
+
+
+extern "C" void
+free(void* buffer) noexcept
+{
+	__libc_free(buffer);
+}
+
+
+#endif	// HAS_ALLOCATION_COUNT
+
+
+//	#pragma mark - Corpus generation
+
+
+static uint32 sRandomState = 0x5eed;
+
+
+static uint32
+random_value(uint32 max)
+{
+	// Deterministic, so that every run uses the same corpora
+	sRandomState = sRandomState * 1103515245 + 12345;
+	return (sRandomState >> 8) % max;
+}
+
+
+static const char*
+random_item(const char* const* items, uint32 count)
+{
+	return items[random_value(count)];
+}
+
+
+static void
+append_words(BString& name, const char* const* words, uint32 count,
+	int32 maxLength)
+{
+	while (true) {
+		const char* word = random_item(words, count);
+		if (name.Length() + (int32)strlen(word) > maxLength)
+			break;
+		name << word;
+	}
+}
+
+
+static const char* const kASCIIWords[] = {
+	"foo", "bar", "IMG_", "photo", "Holiday", "2024", "_", "-", " ", "final",
+	"draft", "Copy of ", "x", "report", "0", "42", "A", "b", "FooBar", "data"
+};
+static const uint32 kASCIIWordCount = B_COUNT_OF(kASCIIWords);
+
+static const char* const kUTF8Words[] = {
+	"été", "Ärger", "öl", "Straße", "über", "日本語", "写真", "фото",
+	"Ελλάδα", "😀", "🎵", "foo", " ", "_", "ﬁle", "İstanbul", "ǅ", "ß"
+};
+static const uint32 kUTF8WordCount = B_COUNT_OF(kUTF8Words);
+
+static const char* const kExtensions[] = {
+	".txt", ".jpg", ".JPG", ".tar.gz", ".mp3", ".cpp", ".h", ""
+};
+static const uint32 kExtensionCount = B_COUNT_OF(kExtensions);
+
+
+static void
+create_corpora(CorpusList& corpora, int32 count)
+{
+	Corpus shortASCII = {"short-ascii"};
+	Corpus longASCII = {"long-255"};
+	Corpus utf8 = {"utf8"};
+	Corpus dots = {"many-dots"};
+	Corpus wildcard = {"wildcard-worst"};
+
+	for (int32 index = 0; index < count; index++) {
+		BString name;
+		append_words(name, kASCIIWords, kASCIIWordCount,
+			4 + random_value(12));
+		name << random_item(kExtensions, kExtensionCount);
+		shortASCII.names.push_back(name);
+
+		name.Truncate(0);
+		append_words(name, kASCIIWords, kASCIIWordCount,
+			B_FILE_NAME_LENGTH - 5);
+		while (name.Length() < B_FILE_NAME_LENGTH - 5)
+			name << 'z';
+		name << ".txt";
+		longASCII.names.push_back(name);
+
+		name.Truncate(0);
+		append_words(name, kUTF8Words, kUTF8WordCount, 16 + random_value(80));
+		name << random_item(kExtensions, kExtensionCount);
+		utf8.names.push_back(name);
+
+		name.Truncate(0);
+		int32 dotCount = 8 + random_value(40);
+		for (int32 dot = 0; dot < dotCount; dot++)
+			name << random_item(kASCIIWords, kASCIIWordCount) << '.';
+		name << "foo";
+		dots.names.push_back(name);
+
+		// Long runs of almost matching characters are what makes
+		// backtracking wildcard matchers slow
+		name.Truncate(0);
+		name.Append('a', 100 + random_value(150));
+		if (random_value(2) == 0)
+			name << 'b';
+		wildcard.names.push_back(name);
+	}
+
+	corpora.push_back(shortASCII);
+	corpora.push_back(longASCII);
+	corpora.push_back(utf8);
+	corpora.push_back(dots);
+	corpora.push_back(wildcard);
+}
+
+
+//	#pragma mark - Configurations
+
+
+static void
+add_configuration(ConfigurationList& configurations, const char* action,
+	const char* name, RenameAction* renameAction)
+{
+	Configuration configuration = {action, name, renameAction};
+	configurations.push_back(configuration);
+}
+
+
+static SearchReplaceRenameAction*
+search_replace(const char* pattern, const char* replace,
+	bool caseInsensitive = false, bool ignoreExtension = false)
+{
+	SearchReplaceRenameAction* action = new SearchReplaceRenameAction();
+	action->SetPattern(pattern);
+	action->SetReplace(replace);
+	action->SetCaseInsensitive(caseInsensitive);
+	action->SetIgnoreExtension(ignoreExtension);
+	return action;
+}
+
+
+static RegularExpressionRenameAction*
+regular_expression(const char* pattern, const char* replace,
+	bool caseInsensitive = false, bool ignoreExtension = false,
+	bool global = false)
+{
+	RegularExpressionRenameAction* action
+		= new RegularExpressionRenameAction();
+	action->SetPattern(pattern, caseInsensitive);
+	action->SetReplace(replace);
+	action->SetIgnoreExtension(ignoreExtension);
+	action->SetGlobal(global);
+	return action;
+}
+
+
+static CaseRenameAction*
+case_rename(case_mode mode, extension_mode extensionMode, bool force)
+{
+	CaseRenameAction* action = new CaseRenameAction();
+	action->SetMode(mode);
+	action->SetExtensionMode(extensionMode);
+	action->SetForce(force);
+	return action;
+}
+
+
+static void
+create_configurations(ConfigurationList& configurations)
+{
+	add_configuration(configurations, "search", "literal",
+		search_replace("foo", "bar"));
+	add_configuration(configurations, "search", "literal-icase",
+		search_replace("FOO", "bar", true));
+	add_configuration(configurations, "search", "literal-no-extension",
+		search_replace("o", "0", false, true));
+	add_configuration(configurations, "search", "question",
+		search_replace("f?o", "x"));
+	add_configuration(configurations, "search", "star-extension",
+		search_replace("*.*", "name"));
+	add_configuration(configurations, "search", "star-worst",
+		search_replace("a*a*a*b", "x"));
+	add_configuration(configurations, "search", "question-worst",
+		search_replace("*a?a?a?a?c", "x"));
+	add_configuration(configurations, "search", "remove",
+		search_replace("_", ""));
+
+	add_configuration(configurations, "regex", "swap-groups",
+		regular_expression("([a-z]+)_([0-9]+)", "\\2-\\1"));
+	add_configuration(configurations, "regex", "single-match",
+		regular_expression("[0-9]+", "#"));
+	add_configuration(configurations, "regex", "icase-no-extension",
+		regular_expression("(foo|bar)", "[\\1]", true, true));
+	add_configuration(configurations, "regex", "backtrack-worst",
+		regular_expression("(a*)*b", "x"));
+	add_configuration(configurations, "regex", "many-references",
+		regular_expression("(.)(.)(.)(.)(.)(.)",
+			"\\6\\5-\\4\\3-\\2\\1 \\1\\2\\3"));
+	add_configuration(configurations, "regex", "global",
+		regular_expression("([a-z])([0-9])", "\\2\\1", false, false, true));
+
+	add_configuration(configurations, "case", "title",
+		case_rename(TITLE_CASE, LOWER_CASE_EXTENSION, false));
+	add_configuration(configurations, "case", "title-force",
+		case_rename(TITLE_CASE, LEAVE_EXTENSION_UNCHANGED, true));
+	add_configuration(configurations, "case", "upper",
+		case_rename(UPPER_CASE, USE_CASE_MODE, false));
+	add_configuration(configurations, "case", "lower",
+		case_rename(LOWER_CASE, UPPER_CASE_EXTENSION, false));
+
+	add_configuration(configurations, "windows", "default",
+		new WindowsRenameAction());
+
+	PipelineRenameAction* pipeline = new PipelineRenameAction();
+	pipeline->AddAction(regular_expression("_", " ", false, false, true));
+	pipeline->AddAction(case_rename(LOWER_CASE, LOWER_CASE_EXTENSION, false));
+	pipeline->AddAction(new WindowsRenameAction());
+	add_configuration(configurations, "pipeline", "regex-case-windows",
+		pipeline);
+}
+
+
+//	#pragma mark - Benchmark
+
+
+static uint64
+current_time()
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+
+static uint32
+hash(uint32 hash, const void* data, size_t length)
+{
+	// FNV-1a
+	const uint8* bytes = (const uint8*)data;
+	for (size_t index = 0; index < length; index++)
+		hash = (hash ^ bytes[index]) * 16777619;
+	return hash;
+}
+
+
+static uint32
+hash_groups(uint32 value, const GroupList& groups)
+{
+	for (int32 index = 0; index < groups.CountItems(); index++) {
+		const Group* group = groups.ItemAt(index);
+		int32 data[3] = {group->index, group->start, group->end};
+		value = hash(value, data, sizeof(data));
+	}
+	return value;
+}
+
+
+static void
+print_result(const Configuration& configuration, const Corpus& corpus,
+	uint64 bestTime, uint64 bytes, uint64 allocations, uint64 groupCount,
+	uint32 checksum, bool countAllocations)
+{
+	double count = corpus.names.size();
+	printf("%s\t%s\t%s\t%zu\t%.1f\t", configuration.action,
+		configuration.name, corpus.name, corpus.names.size(),
+		bestTime / count);
+#ifdef HAS_ALLOCATION_COUNT
+	if (countAllocations)
+		printf("%.1f\t%.2f\t", bytes / count, allocations / count);
+	else
+		printf("-\t-\t");
+#else
+	printf("-\t-\t");
+#endif
+	printf("%.2f\t%08" B_PRIx32 "\n", groupCount / count, checksum);
+	fflush(stdout);
+}
+
+
+static void
+run(const Configuration& configuration, const Corpus& corpus, int32 runs)
+{
+	const std::vector<BString>& names = corpus.names;
+	uint64 bestTime = ~0ULL;
+	uint64 bytes = 0;
+	uint64 allocations = 0;
+	uint64 groupCount = 0;
+	uint32 checksum = 0;
+
+	// Like PreviewItem, keep the group lists over all names
+	GroupList sourceGroups;
+	GroupList targetGroups;
+
+	for (int32 run = 0; run < runs; run++) {
+		checksum = 2166136261U;
+		groupCount = 0;
+		uint64 startBytes = sAllocatedBytes;
+		uint64 startAllocations = sAllocationCount;
+		uint64 startTime = current_time();
+
+		for (size_t index = 0; index < names.size(); index++) {
+			sourceGroups.MakeEmpty();
+			targetGroups.MakeEmpty();
+
+			BString result = configuration.renameAction->Rename(sourceGroups,
+				targetGroups, names[index].String());
+
+			groupCount += sourceGroups.CountItems()
+				+ targetGroups.CountItems();
+			checksum = hash(checksum, result.String(), result.Length() + 1);
+			checksum = hash_groups(checksum, sourceGroups);
+			checksum = hash_groups(checksum, targetGroups);
+		}
+
+		uint64 time = current_time() - startTime;
+		if (time < bestTime)
+			bestTime = time;
+		bytes = sAllocatedBytes - startBytes;
+		allocations = sAllocationCount - startAllocations;
+	}
+
+	print_result(configuration, corpus, bestTime, bytes, allocations,
+		groupCount, checksum, true);
+}
+
+
+/*!	Like run(), but lets \a renamer do the work. The allocation counters
+	are not thread safe, and therefore not reported.
+*/
+static void
+run_parallel(ParallelRenamer& renamer, const Configuration& configuration,
+	const Corpus& corpus, int32 runs)
+{
+	const std::vector<BString>& names = corpus.names;
+	uint64 bestTime = ~0ULL;
+
+	renamer.MakeEmpty();
+	for (size_t index = 0; index < names.size(); index++)
+		renamer.AddName(names[index].String());
+
+	for (int32 run = 0; run < runs; run++) {
+		uint64 startTime = current_time();
+
+		renamer.Start(*configuration.renameAction);
+		renamer.Wait();
+
+		uint64 time = current_time() - startTime;
+		if (time < bestTime)
+			bestTime = time;
+	}
+
+	uint64 groupCount = 0;
+	uint32 checksum = 2166136261U;
+	for (int32 index = 0; index < renamer.CountNames(); index++) {
+		const ParallelRenamer::Result& result = renamer.ResultAt(index);
+
+		groupCount += result.sourceGroups.CountItems()
+			+ result.targetGroups.CountItems();
+		checksum = hash(checksum, result.target.String(),
+			result.target.Length() + 1);
+		checksum = hash_groups(checksum, result.sourceGroups);
+		checksum = hash_groups(checksum, result.targetGroups);
+	}
+
+	print_result(configuration, corpus, bestTime, 0, 0, groupCount, checksum,
+		false);
+}
+
+
+static void
+usage(int exitCode)
+{
+	fprintf(exitCode == 0 ? stdout : stderr,
+		"Usage: %s [-n <count>] [-r <runs>] [-j <threads>] [filter ...]\n"
+		"Benchmarks all rename actions over generated name corpora.\n\n"
+		"  -n, --names <count>  Number of names per corpus (default %"
+			B_PRId32 ").\n"
+		"  -r, --runs <runs>    Runs per benchmark; the fastest one is "
+			"reported\n"
+		"                       (default %" B_PRId32 ").\n"
+		"  -j, --threads <count>\n"
+		"                       Rename with a pool of worker threads; 0 "
+			"uses one\n"
+		"                       per CPU.\n"
+		"  -h, --help           Show this help.\n\n"
+		"Only benchmarks whose \"action/configuration/corpus\" contain one of "
+			"the\n"
+		"filters are run. The output is tab separated, with one header "
+			"line.\n", kProgramName, kDefaultNameCount, kDefaultRuns);
+	exit(exitCode);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	static struct option const kLongOptions[] = {
+		{"names", required_argument, 0, 'n'},
+		{"runs", required_argument, 0, 'r'},
+		{"threads", required_argument, 0, 'j'},
+		{"help", no_argument, 0, 'h'},
+		{NULL}
+	};
+
+	int32 nameCount = kDefaultNameCount;
+	int32 runs = kDefaultRuns;
+	int32 threadCount = -1;
+
+	int c;
+	while ((c = getopt_long(argc, argv, "n:r:j:h", kLongOptions, NULL)) != -1) {
+		switch (c) {
+			case 'n':
+				nameCount = strtol(optarg, NULL, 0);
+				break;
+			case 'r':
+				runs = strtol(optarg, NULL, 0);
+				break;
+			case 'j':
+				threadCount = strtol(optarg, NULL, 0);
+				break;
+			case 'h':
+				usage(0);
+				break;
+			default:
+				usage(1);
+				break;
+		}
+	}
+	if (nameCount <= 0 || runs <= 0)
+		usage(1);
+
+	ParallelRenamer* renamer = NULL;
+	if (threadCount >= 0)
+		renamer = new ParallelRenamer(threadCount);
+
+	CorpusList corpora;
+	create_corpora(corpora, nameCount);
+
+	ConfigurationList configurations;
+	create_configurations(configurations);
+
+	printf("action\tconfiguration\tcorpus\tnames\tns/name\tbytes/name"
+		"\tallocations/name\tgroups/name\tchecksum\n");
+
+	for (size_t i = 0; i < configurations.size(); i++) {
+		const Configuration& configuration = configurations[i];
+		for (size_t j = 0; j < corpora.size(); j++) {
+			const Corpus& corpus = corpora[j];
+
+			if (optind < argc) {
+				BString name;
+				name << configuration.action << "/" << configuration.name
+					<< "/" << corpus.name;
+
+				bool found = false;
+				for (int index = optind; index < argc; index++) {
+					if (name.FindFirst(argv[index]) >= 0) {
+						found = true;
+						break;
+					}
+				}
+				if (!found)
+					continue;
+			}
+
+			if (renamer != NULL)
+				run_parallel(*renamer, configuration, corpus, runs);
+			else
+				run(configuration, corpus, runs);
+		}
+	}
+
+	delete renamer;
+
+	for (size_t index = 0; index < configurations.size(); index++)
+		delete configurations[index].renameAction;
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef COMPAT_OBJECT_LIST_H
+#define COMPAT_OBJECT_LIST_H
+
+
+/*!	Subset of Haiku's BObjectList as used by the rename engine. */
+
+
+#include <SupportDefs.h>
+
+#include <vector>
+
+
+template<class T>
+class BObjectList {
+public:
+	BObjectList(int32 itemsPerBlock = 20, bool owning = false)
+		:
+		fOwning(owning)
+	{
+		fItems.reserve(itemsPerBlock);
+	}
+
+	~BObjectList()
+	{
+		MakeEmpty();
+	}
+
+	bool AddItem(T* item)
+	{
+		fItems.push_back(item);
+		return true;
+	}
+
+	T* ItemAt(int32 index) const
+	{
+		if (index < 0 || index >= CountItems())
+			return NULL;
+		return fItems[index];
+	}
+
+	T* LastItem() const
+	{
+		return ItemAt(CountItems() - 1);
+	}
+
+	T* RemoveItemAt(int32 index)
+	{
+		T* item = ItemAt(index);
+		if (item != NULL)
+			fItems.erase(fItems.begin() + index);
+		return item;
+	}
+
+	int32 CountItems() const
+	{
+		return (int32)fItems.size();
+	}
+
+	bool IsEmpty() const
+	{
+		return fItems.empty();
+	}
+
+	void MakeEmpty(bool deleteIfOwning = true)
+	{
+		if (fOwning && deleteIfOwning) {
+			for (size_t index = 0; index < fItems.size(); index++)
+				delete fItems[index];
+		}
+		fItems.clear();
+	}
+
+private:
+	BObjectList(const BObjectList&);
+	BObjectList& operator=(const BObjectList&);
+
+private:
+	std::vector<T*>	fItems;
+	bool			fOwning;
+};
+
+
+#endif	// COMPAT_OBJECT_LIST_H
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef COMPAT_STORAGE_DEFS_H
+#define COMPAT_STORAGE_DEFS_H
+
+
+/*!	Subset of Haiku's <StorageDefs.h> as used by the rename engine. */
+
+
+#define B_FILE_NAME_LENGTH		256
+#define B_PATH_NAME_LENGTH		1024
+#define B_ATTR_NAME_LENGTH		256
+
+
+#endif	// COMPAT_STORAGE_DEFS_H
@@ -0,0 +1,607 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include <String.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static inline int32
+strlen_clamp(const char* string, int32 max)
+{
+	return max <= 0 ? 0 : strnlen(string, max);
+}
+
+
+static inline bool
+is_utf8_start(char c)
+{
+	return (c & 0xc0) != 0x80;
+}
+
+
+BString::BString()
+	:
+	fPrivateData(NULL),
+	fLength(0),
+	fCapacity(0)
+{
+}
+
+
+BString::BString(const char* string)
+	:
+	fPrivateData(NULL),
+	fLength(0),
+	fCapacity(0)
+{
+	SetTo(string);
+}
+
+
+BString::BString(const char* string, int32 maxLength)
+	:
+	fPrivateData(NULL),
+	fLength(0),
+	fCapacity(0)
+{
+	SetTo(string, maxLength);
+}
+
+
+BString::BString(const BString& string)
+	:
+	fPrivateData(NULL),
+	fLength(0),
+	fCapacity(0)
+{
+	SetTo(string);
+}
+
+
+BString::~BString()
+{
+	free(fPrivateData);
+}
+
+
+int32
+BString::CountChars() const
+{
+	int32 count = 0;
+	for (int32 index = 0; index < fLength; index++) {
+		if (is_utf8_start(fPrivateData[index]))
+			count++;
+	}
+	return count;
+}
+
+
+int32
+BString::CountBytes(int32 fromCharOffset, int32 charCount) const
+{
+	int32 start = _CharOffset(fromCharOffset);
+	int32 end = _CharOffset(fromCharOffset + charCount);
+	return end - start;
+}
+
+
+BString&
+BString::operator=(const BString& string)
+{
+	return SetTo(string);
+}
+
+
+BString&
+BString::operator=(const char* string)
+{
+	return SetTo(string);
+}
+
+
+BString&
+BString::SetTo(const char* string)
+{
+	return SetTo(string, INT32_MAX);
+}
+
+
+BString&
+BString::SetTo(const char* string, int32 maxLength)
+{
+	if (string == fPrivateData && string != NULL) {
+		Truncate(strlen_clamp(string, maxLength));
+		return *this;
+	}
+
+	fLength = 0;
+	if (string != NULL)
+		_DoInsert(string, strlen_clamp(string, maxLength), 0);
+	else if (fPrivateData != NULL)
+		fPrivateData[0] = '\0';
+
+	return *this;
+}
+
+
+BString&
+BString::SetTo(const BString& string)
+{
+	if (&string == this)
+		return *this;
+
+	fLength = 0;
+	return _DoInsert(string.String(), string.Length(), 0);
+}
+
+
+BString&
+BString::SetToFormat(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	char buffer[256];
+	int length = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	if (length < 0) {
+		Truncate(0);
+		return *this;
+	}
+	if (length < (int)sizeof(buffer))
+		return SetTo(buffer, length);
+
+	if (!_Reserve(length))
+		return *this;
+
+	va_start(args, format);
+	vsnprintf(fPrivateData, length + 1, format, args);
+	va_end(args);
+
+	fLength = length;
+	return *this;
+}
+
+
+BString&
+BString::operator+=(const BString& string)
+{
+	return _DoInsert(string.String(), string.Length(), fLength);
+}
+
+
+BString&
+BString::operator+=(const char* string)
+{
+	if (string == NULL)
+		return *this;
+
+	return _DoInsert(string, strlen(string), fLength);
+}
+
+
+BString&
+BString::operator+=(char c)
+{
+	return _DoInsert(&c, 1, fLength);
+}
+
+
+BString&
+BString::operator<<(const char* string)
+{
+	return *this += string;
+}
+
+
+BString&
+BString::operator<<(const BString& string)
+{
+	return *this += string;
+}
+
+
+BString&
+BString::operator<<(char c)
+{
+	return *this += c;
+}
+
+
+BString&
+BString::operator<<(int value)
+{
+	return *this << (long long)value;
+}
+
+
+BString&
+BString::operator<<(unsigned int value)
+{
+	return *this << (unsigned long long)value;
+}
+
+
+BString&
+BString::operator<<(long value)
+{
+	return *this << (long long)value;
+}
+
+
+BString&
+BString::operator<<(unsigned long value)
+{
+	return *this << (unsigned long long)value;
+}
+
+
+BString&
+BString::operator<<(long long value)
+{
+	char buffer[32];
+	int length = snprintf(buffer, sizeof(buffer), "%lld", value);
+	return _DoInsert(buffer, length, fLength);
+}
+
+
+BString&
+BString::operator<<(unsigned long long value)
+{
+	char buffer[32];
+	int length = snprintf(buffer, sizeof(buffer), "%llu", value);
+	return _DoInsert(buffer, length, fLength);
+}
+
+
+BString&
+BString::Append(const BString& string)
+{
+	return *this += string;
+}
+
+
+BString&
+BString::Append(const char* string)
+{
+	return *this += string;
+}
+
+
+BString&
+BString::Append(const BString& string, int32 length)
+{
+	if (length > string.Length())
+		length = string.Length();
+
+	return _DoInsert(string.String(), length < 0 ? 0 : length, fLength);
+}
+
+
+BString&
+BString::Append(const char* string, int32 length)
+{
+	if (string == NULL)
+		return *this;
+
+	return _DoInsert(string, strlen_clamp(string, length), fLength);
+}
+
+
+BString&
+BString::Append(char c, int32 count)
+{
+	if (count <= 0 || !_Reserve(fLength + count))
+		return *this;
+
+	memset(fPrivateData + fLength, c, count);
+	fLength += count;
+	fPrivateData[fLength] = '\0';
+	return *this;
+}
+
+
+BString&
+BString::Prepend(const char* string)
+{
+	if (string == NULL)
+		return *this;
+
+	return _DoInsert(string, strlen(string), 0);
+}
+
+
+BString&
+BString::Prepend(const BString& string)
+{
+	return _DoInsert(string.String(), string.Length(), 0);
+}
+
+
+BString&
+BString::Prepend(const char* string, int32 length)
+{
+	if (string == NULL)
+		return *this;
+
+	return _DoInsert(string, strlen_clamp(string, length), 0);
+}
+
+
+BString&
+BString::Prepend(const BString& string, int32 length)
+{
+	if (length > string.Length())
+		length = string.Length();
+
+	return _DoInsert(string.String(), length < 0 ? 0 : length, 0);
+}
+
+
+BString&
+BString::Insert(const char* string, int32 position)
+{
+	if (string == NULL)
+		return *this;
+
+	return _DoInsert(string, strlen(string), position);
+}
+
+
+BString&
+BString::Insert(const char* string, int32 length, int32 position)
+{
+	if (string == NULL)
+		return *this;
+
+	return _DoInsert(string, strlen_clamp(string, length), position);
+}
+
+
+BString&
+BString::Insert(const BString& string, int32 position)
+{
+	return _DoInsert(string.String(), string.Length(), position);
+}
+
+
+BString&
+BString::Truncate(int32 newLength, bool lazy)
+{
+	if (newLength < 0)
+		newLength = 0;
+
+	if (newLength < fLength) {
+		fLength = newLength;
+		fPrivateData[fLength] = '\0';
+	}
+	return *this;
+}
+
+
+BString&
+BString::TruncateChars(int32 newCharCount, bool lazy)
+{
+	return Truncate(_CharOffset(newCharCount), lazy);
+}
+
+
+BString&
+BString::Remove(int32 from, int32 length)
+{
+	if (from < 0 || length <= 0 || from >= fLength)
+		return *this;
+
+	if (length > fLength - from)
+		length = fLength - from;
+
+	memmove(fPrivateData + from, fPrivateData + from + length,
+		fLength - from - length + 1);
+	fLength -= length;
+	return *this;
+}
+
+
+BString&
+BString::RemoveChars(int32 fromCharOffset, int32 charCount)
+{
+	int32 from = _CharOffset(fromCharOffset);
+	return Remove(from, _CharOffset(fromCharOffset + charCount) - from);
+}
+
+
+BString&
+BString::ReplaceAll(const char* replaceThis, const char* withThis,
+	int32 fromOffset)
+{
+	if (replaceThis == NULL || withThis == NULL || replaceThis[0] == '\0')
+		return *this;
+
+	int32 replaceLength = strlen(replaceThis);
+	int32 withLength = strlen(withThis);
+
+	int32 offset = FindFirst(replaceThis, fromOffset < 0 ? 0 : fromOffset);
+	while (offset >= 0) {
+		Remove(offset, replaceLength);
+		_DoInsert(withThis, withLength, offset);
+		offset = FindFirst(replaceThis, offset + withLength);
+	}
+	return *this;
+}
+
+
+int
+BString::Compare(const BString& string) const
+{
+	return strcmp(String(), string.String());
+}
+
+
+int
+BString::Compare(const char* string) const
+{
+	return strcmp(String(), string != NULL ? string : "");
+}
+
+
+int32
+BString::FindFirst(char c) const
+{
+	if (fLength == 0)
+		return -1;
+
+	const char* found = (const char*)memchr(fPrivateData, c, fLength);
+	return found != NULL ? found - fPrivateData : -1;
+}
+
+
+int32
+BString::FindFirst(const char* string, int32 fromOffset) const
+{
+	if (string == NULL || fromOffset < 0 || fromOffset > fLength)
+		return -1;
+
+	const char* found = strstr(String() + fromOffset, string);
+	return found != NULL ? found - String() : -1;
+}
+
+
+int32
+BString::FindLast(char c) const
+{
+	if (fLength == 0)
+		return -1;
+
+	const char* found = (const char*)memrchr(fPrivateData, c, fLength);
+	return found != NULL ? found - fPrivateData : -1;
+}
+
+
+char
+BString::ByteAt(int32 index) const
+{
+	if (index < 0 || index >= fLength)
+		return '\0';
+
+	return fPrivateData[index];
+}
+
+
+const char*
+BString::CharAt(int32 charIndex, int32* bytes) const
+{
+	int32 offset = _CharOffset(charIndex);
+	if (bytes != NULL) {
+		int32 end = offset;
+		if (end < fLength) {
+			while (++end < fLength && !is_utf8_start(fPrivateData[end]))
+				;
+		}
+		*bytes = end - offset;
+	}
+	return String() + offset;
+}
+
+
+char*
+BString::LockBuffer(int32 maxLength)
+{
+	if (maxLength < fLength)
+		maxLength = fLength;
+	if (!_Reserve(maxLength))
+		return NULL;
+
+	return fPrivateData;
+}
+
+
+BString&
+BString::UnlockBuffer(int32 length)
+{
+	if (fPrivateData == NULL)
+		return *this;
+
+	if (length < 0)
+		length = strnlen(fPrivateData, fCapacity);
+	else if (length > fCapacity)
+		length = fCapacity;
+
+	fLength = length;
+	fPrivateData[fLength] = '\0';
+	return *this;
+}
+
+
+bool
+BString::_Reserve(int32 length)
+{
+	if (length <= fCapacity && fPrivateData != NULL)
+		return true;
+
+	int32 capacity = fCapacity < 16 ? 16 : fCapacity;
+	while (capacity <= length)
+		capacity *= 2;
+
+	char* data = (char*)realloc(fPrivateData, capacity);
+	if (data == NULL)
+		return false;
+
+	if (fPrivateData == NULL)
+		data[0] = '\0';
+
+	fPrivateData = data;
+	fCapacity = capacity - 1;
+	return true;
+}
+
+
+BString&
+BString::_DoInsert(const char* string, int32 length, int32 position)
+{
+	if (position < 0 || position > fLength || length < 0)
+		return *this;
+
+	// The inserted string may be part of our own buffer
+	int32 sourceOffset = -1;
+	if (fPrivateData != NULL && string >= fPrivateData
+		&& string < fPrivateData + fCapacity + 1)
+		sourceOffset = string - fPrivateData;
+
+	if (!_Reserve(fLength + length))
+		return *this;
+
+	if (sourceOffset >= 0)
+		string = fPrivateData + sourceOffset;
+
+	if (sourceOffset >= 0 && position < fLength) {
+		BString copy(string, length);
+		return _DoInsert(copy.String(), length, position);
+	}
+
+	memmove(fPrivateData + position + length, fPrivateData + position,
+		fLength - position);
+	memmove(fPrivateData + position, string, length);
+	fLength += length;
+	fPrivateData[fLength] = '\0';
+	return *this;
+}
+
+
+int32
+BString::_CharOffset(int32 charIndex) const
+{
+	if (charIndex <= 0)
+		return 0;
+
+	int32 count = 0;
+	for (int32 index = 0; index < fLength; index++) {
+		if (is_utf8_start(fPrivateData[index]) && count++ == charIndex)
+			return index;
+	}
+	return fLength;
+}
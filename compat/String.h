@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef COMPAT_STRING_H
+#define COMPAT_STRING_H
+
+
+/*!	Subset of Haiku's BString as used by the rename engine. It follows the
+	semantics of the original, but does not share its buffer between copies.
+*/
+
+
+#include <SupportDefs.h>
+
+#include <string.h>
+
+
+class BString {
+public:
+								BString();
+								BString(const char* string);
+								BString(const char* string, int32 maxLength);
+								BString(const BString& string);
+								~BString();
+
+			const char*			String() const
+									{ return fPrivateData != NULL
+										? fPrivateData : ""; }
+			int32				Length() const
+									{ return fLength; }
+			bool				IsEmpty() const
+									{ return fLength == 0; }
+			int32				CountChars() const;
+			int32				CountBytes(int32 fromCharOffset,
+									int32 charCount) const;
+
+			BString&			operator=(const BString& string);
+			BString&			operator=(const char* string);
+
+			BString&			SetTo(const char* string);
+			BString&			SetTo(const char* string, int32 maxLength);
+			BString&			SetTo(const BString& string);
+			BString&			SetToFormat(const char* format, ...)
+									__attribute__((format(printf, 2, 3)));
+
+			BString&			operator+=(const BString& string);
+			BString&			operator+=(const char* string);
+			BString&			operator+=(char c);
+
+			BString&			operator<<(const char* string);
+			BString&			operator<<(const BString& string);
+			BString&			operator<<(char c);
+			BString&			operator<<(int value);
+			BString&			operator<<(unsigned int value);
+			BString&			operator<<(long value);
+			BString&			operator<<(unsigned long value);
+			BString&			operator<<(long long value);
+			BString&			operator<<(unsigned long long value);
+
+			BString&			Append(const BString& string);
+			BString&			Append(const char* string);
+			BString&			Append(const BString& string, int32 length);
+			BString&			Append(const char* string, int32 length);
+			BString&			Append(char c, int32 count);
+
+			BString&			Prepend(const char* string);
+			BString&			Prepend(const BString& string);
+			BString&			Prepend(const char* string, int32 length);
+			BString&			Prepend(const BString& string, int32 length);
+
+			BString&			Insert(const char* string, int32 position);
+			BString&			Insert(const char* string, int32 length,
+									int32 position);
+			BString&			Insert(const BString& string, int32 position);
+
+			BString&			Truncate(int32 newLength, bool lazy = true);
+			BString&			TruncateChars(int32 newCharCount,
+									bool lazy = true);
+			BString&			Remove(int32 from, int32 length);
+			BString&			RemoveChars(int32 fromCharOffset,
+									int32 charCount);
+			BString&			ReplaceAll(const char* replaceThis,
+									const char* withThis,
+									int32 fromOffset = 0);
+
+			int					Compare(const BString& string) const;
+			int					Compare(const char* string) const;
+
+			bool				operator<(const BString& string) const
+									{ return Compare(string) < 0; }
+			bool				operator==(const BString& string) const
+									{ return Compare(string) == 0; }
+			bool				operator!=(const BString& string) const
+									{ return Compare(string) != 0; }
+			bool				operator==(const char* string) const
+									{ return Compare(string) == 0; }
+			bool				operator!=(const char* string) const
+									{ return Compare(string) != 0; }
+
+			int32				FindFirst(char c) const;
+			int32				FindFirst(const char* string,
+									int32 fromOffset = 0) const;
+			int32				FindLast(char c) const;
+
+			char				operator[](int32 index) const
+									{ return fPrivateData[index]; }
+			char				ByteAt(int32 index) const;
+			const char*			CharAt(int32 charIndex,
+									int32* bytes = NULL) const;
+
+			char*				LockBuffer(int32 maxLength);
+			BString&			UnlockBuffer(int32 length = -1);
+
+private:
+			bool				_Reserve(int32 length);
+			BString&			_DoInsert(const char* string, int32 length,
+									int32 position);
+			int32				_CharOffset(int32 charIndex) const;
+
+private:
+			char*				fPrivateData;
+			int32				fLength;
+			int32				fCapacity;
+};
+
+
+inline bool
+operator==(const char* a, const BString& b)
+{
+	return b.Compare(a) == 0;
+}
+
+
+inline bool
+operator!=(const char* a, const BString& b)
+{
+	return b.Compare(a) != 0;
+}
+
+
+#endif	// COMPAT_STRING_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef COMPAT_SUPPORT_DEFS_H
+#define COMPAT_SUPPORT_DEFS_H
+
+
+/*!	Minimal subset of Haiku's <SupportDefs.h> that is needed to build the
+	rename engine and the command line tool on other POSIX systems.
+*/
+
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+
+typedef int8_t				int8;
+typedef uint8_t				uint8;
+typedef int16_t				int16;
+typedef uint16_t			uint16;
+typedef int32_t				int32;
+typedef uint32_t			uint32;
+typedef int64_t				int64;
+typedef uint64_t			uint64;
+
+typedef int32				status_t;
+typedef int64				bigtime_t;
+typedef uint32				type_code;
+
+
+#define B_PRId8				PRId8
+#define B_PRIu8				PRIu8
+#define B_PRId16			PRId16
+#define B_PRIu16			PRIu16
+#define B_PRId32			PRId32
+#define B_PRIu32			PRIu32
+#define B_PRIx32			PRIx32
+#define B_PRId64			PRId64
+#define B_PRIu64			PRIu64
+#define B_PRIdOFF			PRId64
+#define B_PRIdINO			PRIu64
+
+
+#define B_COUNT_OF(array)	(sizeof(array) / sizeof(array[0]))
+
+
+// Haiku uses negative error codes that are identical to the errno values;
+// on other systems, we just negate the errno values.
+#define B_FROM_POSIX_ERROR(error)	(-(error))
+#define B_TO_POSIX_ERROR(error)		(-(error))
+
+#define B_OK					((status_t)0)
+#define B_NO_ERROR				B_OK
+#define B_ERROR					((status_t)-1)
+#define B_NO_MEMORY				B_FROM_POSIX_ERROR(ENOMEM)
+#define B_IO_ERROR				B_FROM_POSIX_ERROR(EIO)
+#define B_PERMISSION_DENIED		B_FROM_POSIX_ERROR(EACCES)
+#define B_BAD_VALUE				B_FROM_POSIX_ERROR(EINVAL)
+#define B_TIMED_OUT				B_FROM_POSIX_ERROR(ETIMEDOUT)
+#define B_INTERRUPTED			B_FROM_POSIX_ERROR(EINTR)
+#define B_WOULD_BLOCK			B_FROM_POSIX_ERROR(EAGAIN)
+#define B_BUSY					B_FROM_POSIX_ERROR(EBUSY)
+#define B_NOT_ALLOWED			B_FROM_POSIX_ERROR(EPERM)
+#define B_ENTRY_NOT_FOUND		B_FROM_POSIX_ERROR(ENOENT)
+#define B_FILE_EXISTS			B_FROM_POSIX_ERROR(EEXIST)
+#define B_NAME_TOO_LONG			B_FROM_POSIX_ERROR(ENAMETOOLONG)
+#define B_NOT_A_DIRECTORY		B_FROM_POSIX_ERROR(ENOTDIR)
+#define B_IS_A_DIRECTORY		B_FROM_POSIX_ERROR(EISDIR)
+#define B_DIRECTORY_NOT_EMPTY	B_FROM_POSIX_ERROR(ENOTEMPTY)
+#define B_BUFFER_OVERFLOW		B_FROM_POSIX_ERROR(EOVERFLOW)
+#define B_NOT_SUPPORTED			B_FROM_POSIX_ERROR(EOPNOTSUPP)
+#define B_BAD_DATA				B_FROM_POSIX_ERROR(EILSEQ)
+
+
+#endif	// COMPAT_SUPPORT_DEFS_H
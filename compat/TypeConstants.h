@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef COMPAT_TYPE_CONSTANTS_H
+#define COMPAT_TYPE_CONSTANTS_H
+
+
+/*!	Subset of Haiku's <TypeConstants.h> as used by the rename engine. */
+
+
+enum {
+	B_BOOL_TYPE			= 'BOOL',
+	B_CHAR_TYPE			= 'CHAR',
+	B_DOUBLE_TYPE		= 'DBLE',
+	B_FLOAT_TYPE		= 'FLOT',
+	B_INT8_TYPE			= 'BYTE',
+	B_INT16_TYPE		= 'SHRT',
+	B_INT32_TYPE		= 'LONG',
+	B_INT64_TYPE		= 'LLNG',
+	B_MIME_STRING_TYPE	= 'MIMS',
+	B_RAW_TYPE			= 'RAWT',
+	B_STRING_TYPE		= 'CSTR',
+	B_TIME_TYPE			= 'TIME',
+	B_UINT8_TYPE		= 'UBYT',
+	B_UINT16_TYPE		= 'USHT',
+	B_UINT32_TYPE		= 'ULNG',
+	B_UINT64_TYPE		= 'ULLG'
+};
+
+
+#endif	// COMPAT_TYPE_CONSTANTS_H
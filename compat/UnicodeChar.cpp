@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include <UnicodeChar.h>
+
+#include <unicode/uchar.h>
+#include <unicode/utf8.h>
+
+
+/*static*/ bool
+BUnicodeChar::IsAlpha(uint32 c)
+{
+	return u_isalpha(c);
+}
+
+
+/*static*/ bool
+BUnicodeChar::IsLower(uint32 c)
+{
+	return u_islower(c);
+}
+
+
+/*static*/ bool
+BUnicodeChar::IsUpper(uint32 c)
+{
+	return u_isupper(c);
+}
+
+
+/*static*/ uint32
+BUnicodeChar::ToLower(uint32 c)
+{
+	return u_tolower(c);
+}
+
+
+/*static*/ uint32
+BUnicodeChar::ToUpper(uint32 c)
+{
+	return u_toupper(c);
+}
+
+
+/*static*/ uint32
+BUnicodeChar::ToTitle(uint32 c)
+{
+	return u_totitle(c);
+}
+
+
+/*static*/ void
+BUnicodeChar::ToUTF8(uint32 c, char** out)
+{
+	int32 length = 0;
+	U8_APPEND_UNSAFE(*out, length, c);
+	*out += length;
+}
+
+
+/*static*/ uint32
+BUnicodeChar::FromUTF8(const char** in)
+{
+	// Like Haiku's version, this does not validate its input
+	const uint8* bytes = (const uint8*)*in;
+	if (bytes[0] == 0)
+		return 0;
+
+	int32 index = 0;
+	UChar32 c;
+	U8_NEXT_UNSAFE(bytes, index, c);
+	*in += index;
+	return c;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef COMPAT_UNICODE_CHAR_H
+#define COMPAT_UNICODE_CHAR_H
+
+
+/*!	Subset of Haiku's BUnicodeChar as used by the rename engine; like the
+	original, it is implemented on top of ICU.
+*/
+
+
+#include <SupportDefs.h>
+
+
+class BUnicodeChar {
+public:
+	static	bool				IsAlpha(uint32 c);
+	static	bool				IsLower(uint32 c);
+	static	bool				IsUpper(uint32 c);
+
+	static	uint32				ToLower(uint32 c);
+	static	uint32				ToUpper(uint32 c);
+	static	uint32				ToTitle(uint32 c);
+
+	static	void				ToUTF8(uint32 c, char** out);
+	static	uint32				FromUTF8(const char** in);
+	static	uint32				FromUTF8(const char* in)
+									{ return FromUTF8(&in); }
+};
+
+
+#endif	// COMPAT_UNICODE_CHAR_H
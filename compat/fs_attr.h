@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef COMPAT_FS_ATTR_H
+#define COMPAT_FS_ATTR_H
+
+
+/*!	Subset of Haiku's <fs_attr.h> as used by the rename engine. */
+
+
+#include <SupportDefs.h>
+
+
+typedef struct attr_info {
+	uint32	type;
+	off_t	size;
+} attr_info;
+
+
+#endif	// COMPAT_FS_ATTR_H
@@ -0,0 +1,79 @@
+## Makefile for building the command line version of rename on POSIX
+## systems other than Haiku. It is included by the main makefile.
+
+POSIX_NAME = rename
+POSIX_CORE = librenamecore.a
+POSIX_BENCHMARK = rename_benchmark
+POSIX_TESTS = rename_tests
+
+# The portable rename engine: rename actions, filters, expressions, and the
+# file system abstraction. Anything that wants to rename files without the
+# Haiku UI links against this library.
+POSIX_CORE_SRCS = AttributeCache.cpp \
+	DirectoryCache.cpp \
+	ExpressionEvaluator.cpp \
+	ExpressionTemplate.cpp \
+	FileSystem.cpp \
+	ParallelRenamer.cpp \
+	PosixFileSystem.cpp \
+	RefFilter.cpp \
+	RegularExpression.cpp \
+	ShellResultCache.cpp \
+	ShellWorkerPool.cpp \
+	rename_actions/RenameAction.cpp \
+	rename_actions/RegularExpressionRenameAction.cpp \
+	rename_actions/WindowsRenameAction.cpp \
+	rename_actions/CaseRenameAction.cpp \
+	rename_actions/PipelineRenameAction.cpp \
+	rename_actions/SearchReplaceRenameAction.cpp \
+	compat/String.cpp \
+	compat/UnicodeChar.cpp
+
+POSIX_SRCS = batchrename.cpp
+
+POSIX_OBJ_DIR = objects.posix
+POSIX_CORE_OBJS = $(addprefix $(POSIX_OBJ_DIR)/, $(POSIX_CORE_SRCS:.cpp=.o))
+POSIX_OBJS = $(addprefix $(POSIX_OBJ_DIR)/, $(POSIX_SRCS:.cpp=.o))
+POSIX_BENCHMARK_OBJS = $(POSIX_OBJ_DIR)/benchmark/RenameBenchmark.o
+POSIX_TESTS_OBJS = $(POSIX_OBJ_DIR)/tests/RenameTests.o
+
+CXX ?= g++
+CXXFLAGS ?= -O2 -g
+POSIX_CXXFLAGS = $(CXXFLAGS) -Wall -Wno-multichar -Wno-parentheses \
+	-I. -Irename_actions -Icompat -pthread
+POSIX_LIBS = -licuuc -pthread
+
+default: $(POSIX_NAME)
+
+$(POSIX_NAME): $(POSIX_OBJS) $(POSIX_CORE)
+	$(CXX) $(LDFLAGS) -o $@ $^ $(POSIX_LIBS)
+
+# Benchmarks all rename actions; run "./rename_benchmark -h" for its options.
+benchmark: $(POSIX_BENCHMARK)
+
+$(POSIX_BENCHMARK): $(POSIX_BENCHMARK_OBJS) $(POSIX_CORE)
+	$(CXX) $(LDFLAGS) -o $@ $^ $(POSIX_LIBS)
+
+# Builds, and runs the tests of the rename engine.
+test: $(POSIX_TESTS)
+	./$(POSIX_TESTS)
+
+$(POSIX_TESTS): $(POSIX_TESTS_OBJS) $(POSIX_CORE)
+	$(CXX) $(LDFLAGS) -o $@ $^ $(POSIX_LIBS)
+
+$(POSIX_CORE): $(POSIX_CORE_OBJS)
+	rm -f $@
+	$(AR) rcs $@ $^
+
+$(POSIX_OBJ_DIR)/%.o: %.cpp
+	@mkdir -p $(dir $@)
+	$(CXX) $(POSIX_CXXFLAGS) -MMD -MP -c $< -o $@
+
+clean:
+	rm -rf $(POSIX_OBJ_DIR) $(POSIX_NAME) $(POSIX_CORE) \
+		$(POSIX_BENCHMARK) $(POSIX_TESTS)
+
+-include $(POSIX_OBJS:.o=.d) $(POSIX_CORE_OBJS:.o=.d) \
+	$(POSIX_BENCHMARK_OBJS:.o=.d) $(POSIX_TESTS_OBJS:.o=.d)
+
+.PHONY: default benchmark test clean
@@ -5,233 +5,293 @@
 
 #include "CaseRenameAction.h"
 
-#include <CheckBox.h>
-#include <LayoutBuilder.h>
-#include <MenuField.h>
-#include <PopUpMenu.h>
+#include <StorageDefs.h>
 #include <UnicodeChar.h>
 
-#include <stdio.h>
-#include <unicode/utf8.h>
+#include <ctype.h>
 
+#include <string.h>
 
-static const uint32 kMsgSetMode = 'stmd';
+#include <unicode/utf8.h>
 
 
-//	#pragma mark - CaseRenameAction
+static const uint64 kOnes = 0x0101010101010101ULL;
+static const uint64 kHighBits = 0x8080808080808080ULL;
 
 
-CaseRenameAction::CaseRenameAction()
-	:
-	fMode(TITLE_CASE)
+/*!	Returns a mask with the high bit set for each byte of \a word that is
+	within \a first and \a last. All bytes must be ASCII.
+*/
+static inline uint64
+ascii_range_mask(uint64 word, uint8 first, uint8 last)
 {
+	uint64 atLeastFirst = word + kOnes * (0x80 - first);
+	uint64 aboveLast = word + kOnes * (0x7f - last);
+	return atLeastFirst & ~aboveLast & kHighBits;
 }
 
 
-CaseRenameAction::~CaseRenameAction()
+static inline bool
+is_ascii_alpha(uint8 c)
 {
+	return (uint8)((c | 0x20) - 'a') < 26;
 }
 
 
-BString
-CaseRenameAction::Rename(BObjectList<Group>& sourceGroups,
-	BObjectList<Group>& targetGroups, const char* string) const
-{
-	BString output;
-	char* buffer = output.LockBuffer(B_PATH_NAME_LENGTH + 8);
+//	#pragma mark - CaseOutput
+
+
+/*!	Collects the renamed string, and keeps track of the groups of changed
+	characters. The output buffer is only created once the first character
+	actually changes.
+*/
+class CaseOutput {
+public:
+	CaseOutput(BString& output, const char* source, int32 length,
+		GroupList& sourceGroups, GroupList& targetGroups)
+		:
+		fOutput(output),
+		fSource(source),
+		fSourceLength(length),
+		fBuffer(NULL),
+		fLength(0),
+		fPosition(0),
+		fSourceGroups(sourceGroups),
+		fTargetGroups(targetGroups),
+		fGroupIndex(0),
+		fGroupStart(-1)
+	{
+	}
 
-	int32 extensionStart = SuffixIndex(string);
-	if (extensionStart >= 0)
-		extensionStart++;
+	int32 Length() const
+	{
+		return fLength;
+	}
 
-	case_mode mode = fMode;
+	void Unchanged(int32 bytes)
+	{
+		if (fBuffer != NULL)
+			memcpy(fBuffer + fLength, fSource + fPosition, bytes);
+		if (fGroupStart >= 0)
+			_EndGroup();
 
-	int32 outLength = 0;
-	int32 fromIndex = 0;
-	bool inWord = false;
-	int32 groupIndex = 0;
-	int32 groupStart = -1;
+		fLength += bytes;
+		fPosition += bytes;
+	}
 
-	// Rename
-	while (string[0] != '\0') {
-		if (fromIndex == extensionStart) {
-			switch (fExtensionMode) {
-				case LOWER_CASE_EXTENSION:
-					mode = LOWER_CASE;
-					break;
-				case UPPER_CASE_EXTENSION:
-					mode = UPPER_CASE;
-					break;
-				case LEAVE_EXTENSION_UNCHANGED:
-					mode = (case_mode)-1;
-					break;
-				default:
-					break;
-			}
-		}
+	void Changed(const char* data, int32 bytes, int32 sourceBytes)
+	{
+		if (fBuffer == NULL && !_CreateBuffer())
+			return;
+		if (fGroupStart < 0)
+			fGroupStart = fPosition;
 
-		const char* next = string;
-		uint32 c = BUnicodeChar::FromUTF8(&next);
-		uint32 origChar = c;
+		memcpy(fBuffer + fLength, data, bytes);
+		fLength += bytes;
+		fPosition += sourceBytes;
+	}
 
-		if (mode == TITLE_CASE) {
-			if (BUnicodeChar::IsAlpha(c)) {
-				if (!inWord) {
-					c = BUnicodeChar::ToTitle(c);
-					inWord = true;
-				} else if (fForce) {
-					c = BUnicodeChar::ToLower(c);
-				}
-			} else
-				inWord = false;
-		} else if (mode == UPPER_CASE && BUnicodeChar::IsAlpha(c)) {
-			c = BUnicodeChar::ToUpper(c);
-		} else if (mode == LOWER_CASE && BUnicodeChar::IsAlpha(c)) {
-			c = BUnicodeChar::ToLower(c);
+	/*!	Adds a run of ASCII characters that may have changed. */
+	void Add(const char* data, int32 bytes)
+	{
+		for (int32 index = 0; index < bytes; index++) {
+			if (data[index] == fSource[fPosition])
+				Unchanged(1);
+			else
+				Changed(data + index, 1, 1);
 		}
+	}
 
-		if (outLength >= B_PATH_NAME_LENGTH)
-			break;
-
-		if (c != origChar && groupStart < 0)
-			groupStart = fromIndex;
-		else if (c == origChar && groupStart >= 0) {
-			sourceGroups.AddItem(new Group(groupIndex, groupStart, fromIndex));
-			targetGroups.AddItem(new Group(groupIndex++, groupStart,
-				fromIndex));
-			groupStart = -1;
+	void Finish()
+	{
+		if (fGroupStart >= 0) {
+			fSourceGroups.AddItem(Group(fGroupIndex, fGroupStart,
+				fPosition));
+			fTargetGroups.AddItem(Group(fGroupIndex, fGroupStart,
+				fPosition));
 		}
 
-		int charLength = 0;
-		U8_APPEND_UNSAFE(buffer, charLength, c);
-		outLength += charLength;
-		buffer += charLength;
+		if (fBuffer != NULL)
+			fOutput.UnlockBuffer(fLength);
+		else
+			fOutput.SetTo(fSource, fLength);
+	}
+
+private:
+	bool _CreateBuffer()
+	{
+		// Case changes make a character at most 1.5 times as long
+		int32 capacity = fSourceLength + fSourceLength / 2 + 4;
+		if (capacity > B_PATH_NAME_LENGTH + 8)
+			capacity = B_PATH_NAME_LENGTH + 8;
+
+		fBuffer = fOutput.LockBuffer(capacity);
+		if (fBuffer == NULL)
+			return false;
 
-		fromIndex += next - string;
-		string = next;
+		memcpy(fBuffer, fSource, fLength);
+		return true;
 	}
-	buffer[0] = '\0';
 
-	if (groupStart >= 0) {
-		sourceGroups.AddItem(new Group(groupIndex, groupStart, fromIndex));
-		targetGroups.AddItem(new Group(groupIndex, groupStart, fromIndex));
+	void _EndGroup()
+	{
+		fSourceGroups.AddItem(Group(fGroupIndex, fGroupStart, fPosition));
+		fTargetGroups.AddItem(Group(fGroupIndex++, fGroupStart, fPosition));
+		fGroupStart = -1;
 	}
 
-	output.UnlockBuffer(B_PATH_NAME_LENGTH);
-	return output;
-}
+private:
+	BString&			fOutput;
+	const char*			fSource;
+	int32				fSourceLength;
+	char*				fBuffer;
+	int32				fLength;
+	int32				fPosition;
+	GroupList&			fSourceGroups;
+	GroupList&			fTargetGroups;
+	int32				fGroupIndex;
+	int32				fGroupStart;
+};
 
 
-//	#pragma mark - CaseRenameView
+//	#pragma mark - CaseRenameAction
 
 
-CaseRenameView::CaseRenameView()
+CaseRenameAction::CaseRenameAction()
 	:
-	RenameView("method:case")
+	fMode(TITLE_CASE),
+	fExtensionMode(LOWER_CASE_EXTENSION),
+	fForce(false)
 {
-	BMenu* menu = new BPopUpMenu("Mode");
-	BMenuItem* item = new BMenuItem("Title case", new BMessage(kMsgSetMode));
-	item->SetMarked(true);
-	menu->AddItem(item);
-	menu->AddItem(new BMenuItem("Upper case", new BMessage(kMsgSetMode)));
-	menu->AddItem(new BMenuItem("Lower case", new BMessage(kMsgSetMode)));
-
-	fModeField = new BMenuField("mode", "Mode", menu);
-
-	menu = new BPopUpMenu("Extension mode");
-	item = new BMenuItem("Lower case", new BMessage(kMsgUpdatePreview));
-	item->SetMarked(true);
-	menu->AddItem(item);
-	menu->AddItem(new BMenuItem("Upper case", new BMessage(kMsgUpdatePreview)));
-	menu->AddItem(new BMenuItem("Leave unchanged",
-		new BMessage(kMsgUpdatePreview)));
-	menu->AddItem(new BMenuItem("Use case mode",
-		new BMessage(kMsgUpdatePreview)));
-
-	fExtensionModeField = new BMenuField("extension mode", "Extension mode",
-		menu);
-
-	fForceCheckBox = new BCheckBox("force", "Force on all characters",
-		new BMessage(kMsgUpdatePreview));
-
-	BLayoutBuilder::Group<>(this, B_VERTICAL)
-		.SetInsets(B_USE_DEFAULT_SPACING, 0, 0, 0)
-		.AddGrid(0.f)
-			.Add(fModeField->CreateLabelLayoutItem(), 0, 0)
-			.Add(fModeField->CreateMenuBarLayoutItem(), 1, 0)
-			.Add(fExtensionModeField->CreateLabelLayoutItem(), 0, 1)
-			.Add(fExtensionModeField->CreateMenuBarLayoutItem(), 1, 1)
-		.End()
-		.Add(fForceCheckBox);
 }
 
 
-CaseRenameView::~CaseRenameView()
+CaseRenameAction::~CaseRenameAction()
 {
 }
 
 
-RenameAction*
-CaseRenameView::Action() const
+BString
+CaseRenameAction::Rename(GroupList& sourceGroups,
+	GroupList& targetGroups, const char* string) const
 {
-	CaseRenameAction* action = new CaseRenameAction();
-	action->SetMode((case_mode)fModeField->Menu()->FindMarkedIndex());
-	action->SetExtensionMode(
-		(extension_mode)fExtensionModeField->Menu()->FindMarkedIndex());
-	action->SetForce(fForceCheckBox->Value() == B_CONTROL_ON);
+	int32 length = strlen(string);
+	int32 extensionStart = SuffixIndex(string);
+	if (extensionStart >= 0)
+		extensionStart++;
 
-	return action;
-}
+	BString result;
+	CaseOutput output(result, string, length, sourceGroups, targetGroups);
 
+	case_mode mode = fMode;
+	int32 position = 0;
+	bool inWord = false;
 
-void
-CaseRenameView::SetSettings(const BMessage& settings)
-{
-	BMenuItem* item = fModeField->Menu()->ItemAt(
-		settings.GetUInt32("mode", (uint32)TITLE_CASE));
-	if (item != NULL)
-		item->SetMarked(true);
-
-	item = fExtensionModeField->Menu()->ItemAt(
-		settings.GetUInt32("extension mode", (uint32)LOWER_CASE_EXTENSION));
-	if (item != NULL)
-		item->SetMarked(true);
-
-	fForceCheckBox->SetValue(settings.GetBool("force")
-		? B_CONTROL_ON : B_CONTROL_OFF);
-}
+	while (position < length && output.Length() < B_PATH_NAME_LENGTH) {
+		if (position == extensionStart) {
+			switch (fExtensionMode) {
+				case LOWER_CASE_EXTENSION:
+					mode = LOWER_CASE;
+					break;
+				case UPPER_CASE_EXTENSION:
+					mode = UPPER_CASE;
+					break;
+				case LEAVE_EXTENSION_UNCHANGED:
+					mode = (case_mode)-1;
+					break;
+				default:
+					break;
+			}
+		}
 
+		// Convert runs of ASCII characters eight bytes at a time
 
-void
-CaseRenameView::GetSettings(BMessage& settings)
-{
-	settings.SetUInt32("mode", fModeField->Menu()->FindMarkedIndex());
-	settings.SetUInt32("extension mode",
-		fExtensionModeField->Menu()->FindMarkedIndex());
+		if (mode == UPPER_CASE || mode == LOWER_CASE) {
+			int32 end = extensionStart > position ? extensionStart : length;
+			if (end > position + B_PATH_NAME_LENGTH - output.Length())
+				end = position + B_PATH_NAME_LENGTH - output.Length();
 
-	settings.SetBool("force", fForceCheckBox->Value() == B_CONTROL_ON);
-}
+			while (position + 8 <= end) {
+				uint64 word;
+				memcpy(&word, string + position, 8);
+				if ((word & kHighBits) != 0)
+					break;
 
+				uint64 mask = mode == UPPER_CASE
+					? ascii_range_mask(word, 'a', 'z')
+					: ascii_range_mask(word, 'A', 'Z');
+				if (mask == 0)
+					output.Unchanged(8);
+				else {
+					word ^= mask >> 2;
+					output.Add((const char*)&word, 8);
+				}
+				position += 8;
+			}
+			if (position >= end)
+				continue;
+		}
 
-void
-CaseRenameView::AttachedToWindow()
-{
-	fModeField->Menu()->SetTargetForItems(this);
-}
+		uint8 c = string[position];
+		if (c < 0x80) {
+			// ASCII characters never change their length
+			uint8 converted = c;
+			if (mode == TITLE_CASE) {
+				if (is_ascii_alpha(c)) {
+					if (!inWord) {
+						converted = toupper(c);
+						inWord = true;
+					} else if (fForce)
+						converted = tolower(c);
+				} else
+					inWord = false;
+			} else if (mode == UPPER_CASE)
+				converted = toupper(c);
+			else if (mode == LOWER_CASE)
+				converted = tolower(c);
+
+			if (converted == c)
+				output.Unchanged(1);
+			else
+				output.Changed((const char*)&converted, 1, 1);
+
+			position++;
+			continue;
+		}
 
+		const char* next = string + position;
+		uint32 character = BUnicodeChar::FromUTF8(&next);
+		uint32 original = character;
+		int32 bytes = next - string - position;
+		if (bytes > length - position)
+			bytes = length - position;
 
-void
-CaseRenameView::MessageReceived(BMessage* message)
-{
-	switch (message->what) {
-		case kMsgSetMode:
-			fForceCheckBox->SetEnabled(
-				fModeField->Menu()->FindMarkedIndex() == 0);
-			Window()->PostMessage(kMsgUpdatePreview);
-			break;
-
-		default:
-			RenameView::MessageReceived(message);
-			break;
+		if (mode == TITLE_CASE) {
+			if (BUnicodeChar::IsAlpha(character)) {
+				if (!inWord) {
+					character = BUnicodeChar::ToTitle(character);
+					inWord = true;
+				} else if (fForce)
+					character = BUnicodeChar::ToLower(character);
+			} else
+				inWord = false;
+		} else if (mode == UPPER_CASE && BUnicodeChar::IsAlpha(character))
+			character = BUnicodeChar::ToUpper(character);
+		else if (mode == LOWER_CASE && BUnicodeChar::IsAlpha(character))
+			character = BUnicodeChar::ToLower(character);
+
+		if (character == original)
+			output.Unchanged(bytes);
+		else {
+			char buffer[4];
+			int32 encodedLength = 0;
+			U8_APPEND_UNSAFE(buffer, encodedLength, character);
+			output.Changed(buffer, encodedLength, bytes);
+		}
+
+		position += bytes;
 	}
+
+	output.Finish();
+	return result;
 }
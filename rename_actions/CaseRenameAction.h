@@ -6,10 +6,6 @@
 
 
 #include "RenameAction.h"
-#include "RenameView.h"
-
-class BCheckBox;
-class BMenuField;
 
 
 enum case_mode {
@@ -38,8 +34,8 @@ public:
 			void				SetForce(bool force)
 									{ fForce = force; }
 
-	virtual BString				Rename(BObjectList<Group>& sourceGroups,
-									BObjectList<Group>& targetGroups,
+	virtual BString				Rename(GroupList& sourceGroups,
+									GroupList& targetGroups,
 									const char* string) const;
 
 private:
@@ -49,28 +45,4 @@ private:
 };
 
 
-class CaseRenameView : public RenameView {
-public:
-								CaseRenameView();
-	virtual						~CaseRenameView();
-
-	virtual	RenameAction*		Action() const;
-
-	virtual	void				SetSettings(const BMessage& settings);
-	virtual void				GetSettings(BMessage& settings);
-
-	virtual	void				AttachedToWindow();
-	virtual	void				MessageReceived(BMessage* message);
-
-private:
-	static	BMessage*			_CreateMessage(case_mode mode);
-	static	BMessage*			_CreateExtensionMessage(extension_mode mode);
-
-private:
-			BMenuField*			fModeField;
-			BMenuField*			fExtensionModeField;
-			BCheckBox*			fForceCheckBox;
-};
-
-
 #endif	// CASE_RENAME_ACTION_H
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2019-2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "CaseRenameView.h"
+
+#include "CaseRenameAction.h"
+
+#include <CheckBox.h>
+#include <LayoutBuilder.h>
+#include <MenuField.h>
+#include <PopUpMenu.h>
+
+
+static const uint32 kMsgSetMode = 'stmd';
+
+
+//	#pragma mark - CaseRenameView
+
+
+CaseRenameView::CaseRenameView()
+	:
+	RenameView("method:case")
+{
+	BMenu* menu = new BPopUpMenu("Mode");
+	BMenuItem* item = new BMenuItem("Title case", new BMessage(kMsgSetMode));
+	item->SetMarked(true);
+	menu->AddItem(item);
+	menu->AddItem(new BMenuItem("Upper case", new BMessage(kMsgSetMode)));
+	menu->AddItem(new BMenuItem("Lower case", new BMessage(kMsgSetMode)));
+
+	fModeField = new BMenuField("mode", "Mode", menu);
+
+	menu = new BPopUpMenu("Extension mode");
+	item = new BMenuItem("Lower case", new BMessage(kMsgUpdatePreview));
+	item->SetMarked(true);
+	menu->AddItem(item);
+	menu->AddItem(new BMenuItem("Upper case", new BMessage(kMsgUpdatePreview)));
+	menu->AddItem(new BMenuItem("Leave unchanged",
+		new BMessage(kMsgUpdatePreview)));
+	menu->AddItem(new BMenuItem("Use case mode",
+		new BMessage(kMsgUpdatePreview)));
+
+	fExtensionModeField = new BMenuField("extension mode", "Extension mode",
+		menu);
+
+	fForceCheckBox = new BCheckBox("force", "Force on all characters",
+		new BMessage(kMsgUpdatePreview));
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL)
+		.SetInsets(B_USE_DEFAULT_SPACING, 0, 0, 0)
+		.AddGrid(0.f)
+			.Add(fModeField->CreateLabelLayoutItem(), 0, 0)
+			.Add(fModeField->CreateMenuBarLayoutItem(), 1, 0)
+			.Add(fExtensionModeField->CreateLabelLayoutItem(), 0, 1)
+			.Add(fExtensionModeField->CreateMenuBarLayoutItem(), 1, 1)
+		.End()
+		.Add(fForceCheckBox);
+}
+
+
+CaseRenameView::~CaseRenameView()
+{
+}
+
+
+RenameAction*
+CaseRenameView::Action() const
+{
+	CaseRenameAction* action = new CaseRenameAction();
+	action->SetMode((case_mode)fModeField->Menu()->FindMarkedIndex());
+	action->SetExtensionMode(
+		(extension_mode)fExtensionModeField->Menu()->FindMarkedIndex());
+	action->SetForce(fForceCheckBox->Value() == B_CONTROL_ON);
+
+	return action;
+}
+
+
+void
+CaseRenameView::SetSettings(const BMessage& settings)
+{
+	BMenuItem* item = fModeField->Menu()->ItemAt(
+		settings.GetUInt32("mode", (uint32)TITLE_CASE));
+	if (item != NULL)
+		item->SetMarked(true);
+
+	item = fExtensionModeField->Menu()->ItemAt(
+		settings.GetUInt32("extension mode", (uint32)LOWER_CASE_EXTENSION));
+	if (item != NULL)
+		item->SetMarked(true);
+
+	fForceCheckBox->SetValue(settings.GetBool("force")
+		? B_CONTROL_ON : B_CONTROL_OFF);
+}
+
+
+void
+CaseRenameView::GetSettings(BMessage& settings)
+{
+	settings.SetUInt32("mode", fModeField->Menu()->FindMarkedIndex());
+	settings.SetUInt32("extension mode",
+		fExtensionModeField->Menu()->FindMarkedIndex());
+
+	settings.SetBool("force", fForceCheckBox->Value() == B_CONTROL_ON);
+}
+
+
+void
+CaseRenameView::AttachedToWindow()
+{
+	fModeField->Menu()->SetTargetForItems(this);
+}
+
+
+void
+CaseRenameView::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case kMsgSetMode:
+			fForceCheckBox->SetEnabled(
+				fModeField->Menu()->FindMarkedIndex() == 0);
+			Window()->PostMessage(kMsgUpdatePreview);
+			break;
+
+		default:
+			RenameView::MessageReceived(message);
+			break;
+	}
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2019 pinc Software. All Rights Reserved.
+ */
+#ifndef CASE_RENAME_VIEW_H
+#define CASE_RENAME_VIEW_H
+
+
+#include "RenameView.h"
+
+class BCheckBox;
+class BMenuField;
+
+
+class CaseRenameView : public RenameView {
+public:
+								CaseRenameView();
+	virtual						~CaseRenameView();
+
+	virtual	RenameAction*		Action() const;
+
+	virtual	void				SetSettings(const BMessage& settings);
+	virtual void				GetSettings(BMessage& settings);
+
+	virtual	void				AttachedToWindow();
+	virtual	void				MessageReceived(BMessage* message);
+
+private:
+	static	BMessage*			_CreateMessage(case_mode mode);
+	static	BMessage*			_CreateExtensionMessage(extension_mode mode);
+
+private:
+			BMenuField*			fModeField;
+			BMenuField*			fExtensionModeField;
+			BCheckBox*			fForceCheckBox;
+};
+
+
+#endif	// CASE_RENAME_VIEW_H
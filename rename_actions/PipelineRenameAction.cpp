@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "PipelineRenameAction.h"
+
+#include <algorithm>
+#include <vector>
+
+
+static const int32 kStackEditCount = 8;
+
+
+/*!	Describes how a step changed the name: everything before \c prefix, and
+	everything after \c fromEnd (in the old name), or \c toEnd (in the new
+	one) stayed the same. If both names have the same length, the step is
+	assumed to have replaced the characters in place.
+*/
+struct PipelineRenameAction::Edit {
+	int32				prefix;
+	int32				fromEnd;
+	int32				toEnd;
+	bool				inPlace;
+};
+
+
+//	#pragma mark - PipelineRenameAction
+
+
+PipelineRenameAction::PipelineRenameAction()
+	:
+	fActions(5, true)
+{
+}
+
+
+PipelineRenameAction::~PipelineRenameAction()
+{
+}
+
+
+void
+PipelineRenameAction::AddAction(RenameAction* action)
+{
+	if (action != NULL)
+		fActions.AddItem(action);
+}
+
+
+BString
+PipelineRenameAction::Rename(GroupList& sourceGroups,
+	GroupList& targetGroups, const char* string) const
+{
+	int32 count = fActions.CountItems();
+	bool tracking = sourceGroups.IsTracking() || targetGroups.IsTracking();
+	int32 firstSourceGroup = sourceGroups.CountItems();
+	int32 firstTargetGroup = targetGroups.CountItems();
+
+	Edit stackEdits[kStackEditCount];
+	std::vector<Edit> heapEdits;
+	Edit* edits = stackEdits;
+	if (tracking && count > kStackEditCount) {
+		heapEdits.resize(count);
+		edits = &heapEdits[0];
+	}
+	int32 editCount = 0;
+
+	GroupList stepSourceGroups(sourceGroups.IsTracking());
+	GroupList stepTargetGroups(targetGroups.IsTracking());
+	BString name(string);
+
+	for (int32 index = 0; index < count; index++) {
+		stepSourceGroups.MakeEmpty();
+		stepTargetGroups.MakeEmpty();
+
+		BString result = fActions.ItemAt(index)->Rename(stepSourceGroups,
+			stepTargetGroups, name.String());
+		if (result == name) {
+			// This step did not change anything
+			continue;
+		}
+
+		if (tracking) {
+			Edit& edit = edits[editCount++];
+			_ComputeEdit(edit, name, result);
+
+			// Move the target groups of the previous steps to the new name
+			int32 kept = 0;
+			for (int32 groupIndex = 0; groupIndex < targetGroups.CountItems();
+					groupIndex++) {
+				Group group = *targetGroups.ItemAt(groupIndex);
+				group.start = _MapForward(edit, group.start, true);
+				group.end = _MapForward(edit, group.end, false);
+				if (group.start < group.end)
+					*targetGroups.ItemAt(kept++) = group;
+			}
+			targetGroups.Truncate(kept);
+
+			for (int32 groupIndex = 0;
+					groupIndex < stepTargetGroups.CountItems(); groupIndex++) {
+				targetGroups.AddItem(*stepTargetGroups.ItemAt(groupIndex));
+			}
+
+			// Map the source groups of this step back to the original name
+			for (int32 groupIndex = 0;
+					groupIndex < stepSourceGroups.CountItems(); groupIndex++) {
+				Group group = *stepSourceGroups.ItemAt(groupIndex);
+				for (int32 editIndex = editCount - 2; editIndex >= 0;
+						editIndex--) {
+					group.start = _MapBackward(edits[editIndex], group.start,
+						true);
+					group.end = _MapBackward(edits[editIndex], group.end,
+						false);
+				}
+				if (group.start <= group.end)
+					sourceGroups.AddItem(group);
+			}
+		}
+
+		name = result;
+	}
+
+	if (tracking) {
+		_NormalizeGroups(sourceGroups, firstSourceGroup);
+		_NormalizeGroups(targetGroups, firstTargetGroup);
+	}
+
+	return name;
+}
+
+
+/*!	The groups of the steps are collected in the order of the steps, and
+	mapping them may leave them empty, or overlapping. Since the preview
+	expects them in the order of the name, the groups from \a first on are
+	sorted here, empty ones are dropped, overlapping ones merged, and all of
+	them are numbered again.
+*/
+/*static*/ void
+PipelineRenameAction::_NormalizeGroups(GroupList& groups, int32 first)
+{
+	int32 count = groups.CountItems();
+	if (count <= first)
+		return;
+
+	Group* begin = groups.ItemAt(first);
+	std::stable_sort(begin, begin + count - first, &_CompareGroups);
+
+	int32 kept = first;
+	for (int32 index = first; index < count; index++) {
+		Group group = *groups.ItemAt(index);
+		if (group.start >= group.end)
+			continue;
+
+		Group* last = kept > first ? groups.ItemAt(kept - 1) : NULL;
+		if (last != NULL && group.start < last->end) {
+			if (group.end > last->end)
+				last->end = group.end;
+			continue;
+		}
+
+		group.index = kept - first + 1;
+		*groups.ItemAt(kept++) = group;
+	}
+	groups.Truncate(kept);
+}
+
+
+/*static*/ bool
+PipelineRenameAction::_CompareGroups(const Group& a, const Group& b)
+{
+	return a.start < b.start;
+}
+
+
+/*static*/ void
+PipelineRenameAction::_ComputeEdit(Edit& edit, const BString& from,
+	const BString& to)
+{
+	int32 fromLength = from.Length();
+	int32 toLength = to.Length();
+	const char* fromString = from.String();
+	const char* toString = to.String();
+
+	int32 prefix = 0;
+	while (prefix < fromLength && prefix < toLength
+		&& fromString[prefix] == toString[prefix])
+		prefix++;
+
+	int32 suffix = 0;
+	while (suffix < fromLength - prefix && suffix < toLength - prefix
+		&& fromString[fromLength - suffix - 1]
+			== toString[toLength - suffix - 1])
+		suffix++;
+
+	edit.prefix = prefix;
+	edit.fromEnd = fromLength - suffix;
+	edit.toEnd = toLength - suffix;
+	edit.inPlace = fromLength == toLength;
+}
+
+
+/*!	Maps a \a position in the name before the \a edit to the one after it.
+	Positions within the changed part are moved to its \a start, or its end.
+*/
+/*static*/ int32
+PipelineRenameAction::_MapForward(const Edit& edit, int32 position,
+	bool start)
+{
+	if (edit.inPlace || position <= edit.prefix)
+		return position;
+	if (position >= edit.fromEnd)
+		return position - edit.fromEnd + edit.toEnd;
+
+	return start ? edit.prefix : edit.toEnd;
+}
+
+
+/*!	The reverse of _MapForward(). */
+/*static*/ int32
+PipelineRenameAction::_MapBackward(const Edit& edit, int32 position,
+	bool start)
+{
+	if (edit.inPlace || position <= edit.prefix)
+		return position;
+	if (position >= edit.toEnd)
+		return position - edit.toEnd + edit.fromEnd;
+
+	return start ? edit.prefix : edit.fromEnd;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+#ifndef PIPELINE_RENAME_ACTION_H
+#define PIPELINE_RENAME_ACTION_H
+
+
+#include "RenameAction.h"
+
+#include <ObjectList.h>
+
+
+/*!	Runs several rename actions one after the other, as if the name had
+	been renamed by each of them in turn. The groups are mapped through all
+	steps: the source groups refer to the original name, and the target
+	groups to the final one.
+*/
+class PipelineRenameAction : public RenameAction {
+public:
+								PipelineRenameAction();
+	virtual						~PipelineRenameAction();
+
+			void				AddAction(RenameAction* action);
+			int32				CountActions() const
+									{ return fActions.CountItems(); }
+			bool				IsEmpty() const
+									{ return fActions.IsEmpty(); }
+
+	virtual BString				Rename(GroupList& sourceGroups,
+									GroupList& targetGroups,
+									const char* string) const;
+
+private:
+			struct Edit;
+
+	static	void				_NormalizeGroups(GroupList& groups,
+									int32 first);
+	static	bool				_CompareGroups(const Group& a,
+									const Group& b);
+	static	void				_ComputeEdit(Edit& edit, const BString& from,
+									const BString& to);
+	static	int32				_MapForward(const Edit& edit, int32 position,
+									bool start);
+	static	int32				_MapBackward(const Edit& edit,
+									int32 position, bool start);
+
+private:
+			BObjectList<RenameAction> fActions;
+};
+
+
+#endif	// PIPELINE_RENAME_ACTION_H
@@ -5,12 +5,82 @@
 
 #include "RegularExpressionRenameAction.h"
 
-#include <CheckBox.h>
-#include <TextControl.h>
+#include <StorageDefs.h>
 
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define MAX_GROUPS 10
-#define MAX_MATCHES 20
+
+static const int32 kStackGroupCount = 32;
+static const int32 kMaxGroupIndex = 9999;
+
+
+//	#pragma mark - MatchList
+
+
+/*!	Stores the groups of all matches in a name; as long as they fit, they
+	are kept on the stack.
+*/
+class RegularExpressionRenameAction::MatchList {
+public:
+	MatchList(int32 groupCount)
+		:
+		fGroups(fStackGroups),
+		fGroupCount(groupCount),
+		fCount(0),
+		fCapacity(kStackGroupCount / groupCount)
+	{
+	}
+
+	~MatchList()
+	{
+		if (fGroups != fStackGroups)
+			free(fGroups);
+	}
+
+	regmatch_t* Add()
+	{
+		if (fCount == fCapacity) {
+			int32 capacity = fCapacity > 0 ? fCapacity * 2 : 4;
+			regmatch_t* groups = (regmatch_t*)malloc(
+				capacity * fGroupCount * sizeof(regmatch_t));
+			if (groups == NULL)
+				return NULL;
+
+			memcpy(groups, fGroups,
+				fCount * fGroupCount * sizeof(regmatch_t));
+			if (fGroups != fStackGroups)
+				free(fGroups);
+
+			fGroups = groups;
+			fCapacity = capacity;
+		}
+		return MatchAt(fCount++);
+	}
+
+	void RemoveLast()
+	{
+		fCount--;
+	}
+
+	regmatch_t* MatchAt(int32 index) const
+	{
+		return fGroups + index * fGroupCount;
+	}
+
+	int32 CountMatches() const
+	{
+		return fCount;
+	}
+
+private:
+	regmatch_t			fStackGroups[kStackGroupCount];
+	regmatch_t*			fGroups;
+	int32				fGroupCount;
+	int32				fCount;
+	int32				fCapacity;
+};
 
 
 //	#pragma mark - RegularExpressionRenameAction
@@ -18,16 +88,14 @@
 
 RegularExpressionRenameAction::RegularExpressionRenameAction()
 	:
-	fValidPattern(false),
-	fIgnoreExtension(false)
+	fIgnoreExtension(false),
+	fGlobal(false)
 {
 }
 
 
 RegularExpressionRenameAction::~RegularExpressionRenameAction()
 {
-	if (fValidPattern)
-		regfree(&fCompiledPattern);
 }
 
 
@@ -35,116 +103,343 @@ bool
 RegularExpressionRenameAction::SetPattern(const char* pattern,
 	bool caseInsensitive)
 {
-	int result = regcomp(&fCompiledPattern, pattern,
-		REG_EXTENDED | (caseInsensitive ? REG_ICASE : 0));
 	// TODO: show/report error!
-	fValidPattern = result == 0;
-
-	return fValidPattern;
+	bool valid = fExpression.SetPattern(pattern, caseInsensitive) == B_OK;
+	_ResolveNames();
+	return valid;
 }
 
+
+/*!	Splits the replacement into its literal parts and group references
+	once, so that Rename() does not have to parse it again for every name.
+	Groups can be referenced as "\1" to "\9", or as "\{12}", and "\{name}"
+	for named groups.
+*/
 void
 RegularExpressionRenameAction::SetReplace(const char* replace)
 {
 	fReplace = replace;
+	fSegments.clear();
+
+	const char* buffer = fReplace.String();
+	int32 length = fReplace.Length();
+	int32 literalStart = 0;
+
+	for (int32 index = 0; index < length; index++) {
+		Segment reference;
+		if (buffer[index] != '\\' || !_ParseReference(index, reference))
+			continue;
+
+		if (index > literalStart) {
+			Segment literal = {LITERAL, -1, literalStart,
+				index - literalStart};
+			fSegments.push_back(literal);
+		}
+		fSegments.push_back(reference);
+
+		literalStart = index + reference.length;
+		index = literalStart - 1;
+	}
+
+	if (length > literalStart) {
+		Segment literal = {LITERAL, -1, literalStart, length - literalStart};
+		fSegments.push_back(literal);
+	}
+
+	_ResolveNames();
 }
 
 
 BString
-RegularExpressionRenameAction::Rename(BObjectList<Group>& sourceGroups,
-	BObjectList<Group>& targetGroups, const char* string) const
+RegularExpressionRenameAction::Rename(GroupList& sourceGroups,
+	GroupList& targetGroups, const char* string) const
 {
-	if (!fValidPattern)
+	if (!fExpression.IsValid())
 		return string;
 
-	BString text(string);
+	int32 nameLength = strlen(string);
+	int32 length = nameLength;
 	int32 suffixIndex = SuffixIndex(string);
-	if (fIgnoreExtension && suffixIndex > 0)
-		text.Truncate(suffixIndex);
+	bool keepSuffix = fIgnoreExtension && suffixIndex > 0;
+	if (keepSuffix)
+		length = suffixIndex;
 
-	regmatch_t groups[MAX_GROUPS];
-	if (regexec(&fCompiledPattern, text.String(), MAX_GROUPS, groups, 0))
-		return string;
+	// Find all matches in one scan over the name (or just the first one)
 
-	for (int groupIndex = 1; groupIndex < MAX_GROUPS; groupIndex++) {
-		if (groups[groupIndex].rm_so == -1)
+	int32 groupCount = fExpression.CountGroups() + 1;
+	MatchList matches(groupCount);
+	int32 from = 0;
+	int32 lastEnd = -1;
+
+	while (true) {
+		regmatch_t* groups = matches.Add();
+		if (groups == NULL)
 			break;
+		if (!fExpression.Match(string, length, groups, groupCount, from)) {
+			matches.RemoveLast();
+			break;
+		}
 
-		sourceGroups.AddItem(new Group(groupIndex, groups[groupIndex].rm_so,
-			groups[groupIndex].rm_eo));
+		int32 start = groups[0].rm_so;
+		int32 end = groups[0].rm_eo;
+		if (start == end && start == lastEnd) {
+			// Ignore an empty match right after the previous match
+			matches.RemoveLast();
+		} else {
+			_AddSourceGroups(sourceGroups, groups, groupCount);
+			lastEnd = end;
+			if (!fGlobal)
+				break;
+		}
+
+		from = end;
+		if (start == end) {
+			// Continue with the next character
+			if (from >= length)
+				break;
+			for (from++; from < length && (string[from] & 0xc0) == 0x80;)
+				from++;
+		}
 	}
-	if (sourceGroups.IsEmpty())
-		sourceGroups.AddItem(new Group(0, groups[0].rm_so, groups[0].rm_eo));
 
-	BString stringBuffer(fReplace);
+	int32 matchCount = matches.CountMatches();
+	if (matchCount == 0)
+		return string;
+
+	// Without the global flag, and with more than a single group, only the
+	// replacement is kept, and the rest of the name is dropped
+	bool keepText = fGlobal
+		|| _ReplacesMatch(matches.MatchAt(0), groupCount);
+
+	// Determine the length of the new name
+
+	int32 resultLength = 0;
+	int32 position = 0;
+
+	for (int32 index = 0; index < matchCount; index++) {
+		const regmatch_t* groups = matches.MatchAt(index);
+		if (keepText)
+			resultLength += groups[0].rm_so - position;
+		position = groups[0].rm_eo;
 
-	if (groups[1].rm_so == -1) {
-		// There is just a single group -- just replace the match
-		stringBuffer.Prepend(text, groups[0].rm_so);
+		bool tooLong;
+		_CountExpandable(groups, groupCount, resultLength, tooLong);
+		if (tooLong) {
+			// Leave the remaining matches alone
+			matchCount = index + 1;
+			break;
+		}
 	}
 
-	char* buffer = stringBuffer.LockBuffer(B_PATH_NAME_LENGTH);
-	char* target = buffer;
+	if (keepText)
+		resultLength += length - position;
+	if (keepSuffix)
+		resultLength += nameLength - suffixIndex;
 
-	for (; target[0] != '\0'; target++) {
-		if (target[0] == '\\' && target[1] >= '0' && target[1] <= '9') {
-			// References a group
-			int32 groupIndex = target[1] - '0';
-			int startOffset = groups[groupIndex].rm_so;
-			int endOffset = groups[groupIndex].rm_eo;
-			int length = endOffset - startOffset;
-			if (startOffset < 0 || strlen(buffer) + length - 1
-					> B_FILE_NAME_LENGTH)
-				break;
+	// Build the new name in a single pass
 
-			memmove(target + length, target + 2, strlen(target) - 1);
-			memmove(target, string + startOffset, length);
+	BString result;
+	char* buffer = result.LockBuffer(resultLength);
+	if (buffer == NULL)
+		return string;
 
-			startOffset = target - buffer;
-			targetGroups.AddItem(new Group(groupIndex, startOffset,
-				startOffset + length));
+	char* target = buffer;
+	position = 0;
 
-			target += length - 1;
+	for (int32 index = 0; index < matchCount; index++) {
+		const regmatch_t* groups = matches.MatchAt(index);
+		if (keepText) {
+			memcpy(target, string + position, groups[0].rm_so - position);
+			target += groups[0].rm_so - position;
 		}
+		position = groups[0].rm_eo;
+
+		int32 start = target - buffer;
+		int32 currentLength = start;
+		bool tooLong;
+		int32 expandCount = _CountExpandable(groups, groupCount,
+			currentLength, tooLong);
+
+		target = _Expand(target, buffer, targetGroups, string, groups,
+			expandCount);
+
+		if (_ReplacesMatch(groups, groupCount))
+			targetGroups.AddItem(Group(0, start, target - buffer));
+	}
+
+	if (keepText) {
+		memcpy(target, string + position, length - position);
+		target += length - position;
 	}
+	if (keepSuffix) {
+		memcpy(target, string + suffixIndex, nameLength - suffixIndex);
+		target += nameLength - suffixIndex;
+	}
+
+	result.UnlockBuffer(target - buffer);
+	return result;
+}
 
-	stringBuffer.UnlockBuffer();
 
-	if (groups[1].rm_so == -1) {
-		targetGroups.AddItem(new Group(0, groups[0].rm_so,
-			stringBuffer.Length()));
-		stringBuffer.Append(text.String() + groups[0].rm_eo);
+bool
+RegularExpressionRenameAction::_ParseReference(int32 index,
+	Segment& segment) const
+{
+	const char* buffer = fReplace.String() + index;
+
+	if (isdigit(buffer[1])) {
+		segment.type = REFERENCE;
+		segment.group = buffer[1] - '0';
+		segment.offset = index;
+		segment.length = 2;
+		return true;
 	}
-	if (fIgnoreExtension && suffixIndex > 0)
-		stringBuffer += &string[suffixIndex];
+	if (buffer[1] != '{')
+		return false;
+
+	int32 length = 2;
+	if (isdigit(buffer[length])) {
+		int32 group = 0;
+		for (; isdigit(buffer[length]); length++) {
+			group = group * 10 + buffer[length] - '0';
+			if (group > kMaxGroupIndex)
+				return false;
+		}
+		segment.type = REFERENCE;
+		segment.group = group;
+	} else {
+		while (isalnum(buffer[length]) || buffer[length] == '_')
+			length++;
+		if (length == 2)
+			return false;
+
+		segment.type = NAMED_REFERENCE;
+		segment.group = -1;
+	}
+	if (buffer[length] != '}')
+		return false;
+
+	segment.offset = index;
+	segment.length = length + 1;
+	return true;
+}
 
-	return stringBuffer;
+
+/*!	Looks up the groups of all named references in the current pattern.
+	Names that are not part of the pattern are treated like groups that
+	did not match.
+*/
+void
+RegularExpressionRenameAction::_ResolveNames()
+{
+	for (size_t index = 0; index < fSegments.size(); index++) {
+		Segment& segment = fSegments[index];
+		if (segment.type == NAMED_REFERENCE) {
+			segment.group = fExpression.GroupIndex(
+				fReplace.String() + segment.offset + 2, segment.length - 3);
+		}
+	}
 }
 
 
-//	#pragma mark - RegularExpressionView
+/*!	Returns whether the replacement just replaces the match. This is the
+	case if the pattern has no groups, or the first one did not match.
+*/
+bool
+RegularExpressionRenameAction::_ReplacesMatch(const regmatch_t* groups,
+	int32 groupCount) const
+{
+	return groupCount < 2 || groups[1].rm_so == -1;
+}
 
 
-RegularExpressionView::RegularExpressionView()
-	:
-	SearchReplaceView("method:regular expression")
+void
+RegularExpressionRenameAction::_AddSourceGroups(GroupList& sourceGroups,
+	const regmatch_t* groups, int32 groupCount) const
 {
+	bool added = false;
+	for (int32 groupIndex = 1; groupIndex < groupCount; groupIndex++) {
+		if (groups[groupIndex].rm_so == -1)
+			break;
+
+		sourceGroups.AddItem(Group(groupIndex, groups[groupIndex].rm_so,
+			groups[groupIndex].rm_eo));
+		added = true;
+	}
+	if (!added)
+		sourceGroups.AddItem(Group(0, groups[0].rm_so, groups[0].rm_eo));
 }
 
 
-RegularExpressionView::~RegularExpressionView()
+/*!	Determines how many segments of the replacement can be expanded for
+	the given match; the first reference to a group that did not match, or
+	that would make the name too long, leaves the rest of the replacement
+	as is. In the latter case, \a tooLong is set to \c true.
+	\a resultLength is increased by the length of the expanded replacement.
+*/
+int32
+RegularExpressionRenameAction::_CountExpandable(const regmatch_t* groups,
+	int32 groupCount, int32& resultLength, bool& tooLong) const
 {
+	int32 segmentCount = fSegments.size();
+	resultLength += fReplace.Length();
+	tooLong = false;
+
+	for (int32 index = 0; index < segmentCount; index++) {
+		const Segment& segment = fSegments[index];
+		if (segment.type == LITERAL)
+			continue;
+
+		if (segment.group < 0 || segment.group >= groupCount
+			|| groups[segment.group].rm_so < 0)
+			return index;
+
+		const regmatch_t& group = groups[segment.group];
+		int32 expandedLength = resultLength - segment.length
+			+ group.rm_eo - group.rm_so;
+		if (expandedLength >= B_FILE_NAME_LENGTH) {
+			tooLong = true;
+			return index;
+		}
+		resultLength = expandedLength;
+	}
+
+	return segmentCount;
 }
 
 
-RenameAction*
-RegularExpressionView::Action() const
+/*!	Writes the replacement for a match to \a target, and returns the
+	position after it.
+*/
+char*
+RegularExpressionRenameAction::_Expand(char* target, const char* buffer,
+	GroupList& targetGroups, const char* string, const regmatch_t* groups,
+	int32 expandCount) const
 {
-	RegularExpressionRenameAction* action = new RegularExpressionRenameAction();
-	action->SetPattern(fPatternControl->Text(),
-		fCaseInsensitiveCheckBox->Value() == B_CONTROL_ON);
-	action->SetReplace(fReplaceControl->Text());
-	action->SetIgnoreExtension(
-		fIgnoreExtensionCheckBox->Value() == B_CONTROL_ON);
-	return action;
+	for (int32 index = 0; index < expandCount; index++) {
+		const Segment& segment = fSegments[index];
+		if (segment.type == LITERAL) {
+			memcpy(target, fReplace.String() + segment.offset,
+				segment.length);
+			target += segment.length;
+			continue;
+		}
+
+		const regmatch_t& group = groups[segment.group];
+		int32 groupLength = group.rm_eo - group.rm_so;
+		int32 offset = target - buffer;
+		targetGroups.AddItem(Group(segment.group, offset,
+			offset + groupLength));
+
+		memcpy(target, string + group.rm_so, groupLength);
+		target += groupLength;
+	}
+
+	if (expandCount < (int32)fSegments.size()) {
+		int32 offset = fSegments[expandCount].offset;
+		memcpy(target, fReplace.String() + offset,
+			fReplace.Length() - offset);
+		target += fReplace.Length() - offset;
+	}
+	return target;
 }
@@ -5,9 +5,10 @@
 #define REGULAR_EXPRESSION_RENAME_ACTION_H
 
 
-#include "SearchReplaceRenameAction.h"
+#include "RenameAction.h"
+#include "RegularExpression.h"
 
-#include <regex.h>
+#include <vector>
 
 
 class RegularExpressionRenameAction : public RenameAction {
@@ -21,25 +22,57 @@ public:
 
 			void				SetIgnoreExtension(bool ignore)
 									{ fIgnoreExtension = ignore; }
+			void				SetGlobal(bool global)
+									{ fGlobal = global; }
 
-	virtual BString				Rename(BObjectList<Group>& sourceGroups,
-									BObjectList<Group>& targetGroups,
+	virtual BString				Rename(GroupList& sourceGroups,
+									GroupList& targetGroups,
 									const char* string) const;
 
 private:
-			regex_t				fCompiledPattern;
-			bool				fValidPattern;
-			bool				fIgnoreExtension;
-			BString				fReplace;
-};
+			enum segment_type {
+				LITERAL,
+				REFERENCE,
+				NAMED_REFERENCE
+			};
 
+			/*!	A part of the replacement: either a literal part of fReplace,
+				or a reference to a group.
+			*/
+			struct Segment {
+				segment_type	type;
+				int32			group;
+				int32			offset;
+				int32			length;
+			};
 
-class RegularExpressionView : public SearchReplaceView {
-public:
-								RegularExpressionView();
-	virtual						~RegularExpressionView();
+			typedef std::vector<Segment> SegmentList;
+
+			class MatchList;
 
-	virtual	RenameAction*		Action() const;
+			bool				_ParseReference(int32 index,
+									Segment& segment) const;
+			void				_ResolveNames();
+			bool				_ReplacesMatch(const regmatch_t* groups,
+									int32 groupCount) const;
+			void				_AddSourceGroups(GroupList& sourceGroups,
+									const regmatch_t* groups,
+									int32 groupCount) const;
+			int32				_CountExpandable(const regmatch_t* groups,
+									int32 groupCount, int32& resultLength,
+									bool& tooLong) const;
+			char*				_Expand(char* target, const char* buffer,
+									GroupList& targetGroups,
+									const char* string,
+									const regmatch_t* groups,
+									int32 expandCount) const;
+
+private:
+			RegularExpression	fExpression;
+			bool				fIgnoreExtension;
+			bool				fGlobal;
+			BString				fReplace;
+			SegmentList			fSegments;
 };
 
 
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2019-2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "RegularExpressionView.h"
+
+#include "RegularExpressionRenameAction.h"
+
+#include <CheckBox.h>
+#include <GroupLayout.h>
+#include <TextControl.h>
+
+
+//	#pragma mark - RegularExpressionView
+
+
+RegularExpressionView::RegularExpressionView()
+	:
+	SearchReplaceView("method:regular expression")
+{
+	fGlobalCheckBox = new BCheckBox("global", "Replace all",
+		new BMessage(kMsgUpdatePreview));
+	fOptionsLayout->AddView(fGlobalCheckBox);
+}
+
+
+RegularExpressionView::~RegularExpressionView()
+{
+}
+
+
+RenameAction*
+RegularExpressionView::Action() const
+{
+	RegularExpressionRenameAction* action = new RegularExpressionRenameAction();
+	action->SetPattern(fPatternControl->Text(),
+		fCaseInsensitiveCheckBox->Value() == B_CONTROL_ON);
+	action->SetReplace(fReplaceControl->Text());
+	action->SetIgnoreExtension(
+		fIgnoreExtensionCheckBox->Value() == B_CONTROL_ON);
+	action->SetGlobal(fGlobalCheckBox->Value() == B_CONTROL_ON);
+	return action;
+}
+
+
+void
+RegularExpressionView::SetSettings(const BMessage& settings)
+{
+	SearchReplaceView::SetSettings(settings);
+	fGlobalCheckBox->SetValue(settings.GetBool("replace all")
+		? B_CONTROL_ON : B_CONTROL_OFF);
+}
+
+
+void
+RegularExpressionView::GetSettings(BMessage& settings)
+{
+	SearchReplaceView::GetSettings(settings);
+	settings.SetBool("replace all",
+		fGlobalCheckBox->Value() == B_CONTROL_ON);
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2019 pinc Software. All Rights Reserved.
+ */
+#ifndef REGULAR_EXPRESSION_VIEW_H
+#define REGULAR_EXPRESSION_VIEW_H
+
+
+#include "SearchReplaceView.h"
+
+
+class RegularExpressionView : public SearchReplaceView {
+public:
+								RegularExpressionView();
+	virtual						~RegularExpressionView();
+
+	virtual	RenameAction*		Action() const;
+
+	virtual	void				SetSettings(const BMessage& settings);
+	virtual void				GetSettings(BMessage& settings);
+
+private:
+			BCheckBox*			fGlobalCheckBox;
+};
+
+
+#endif	// REGULAR_EXPRESSION_VIEW_H
@@ -5,12 +5,79 @@
 
 #include "RenameAction.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+
+GroupList::GroupList(bool tracking)
+	:
+	fItems(fInlineItems),
+	fCount(0),
+	fCapacity(kInlineCount),
+	fTracking(tracking)
+{
+}
+
+
+GroupList::~GroupList()
+{
+	if (fItems != fInlineItems)
+		free(fItems);
+}
+
+
+void
+GroupList::SetTracking(bool tracking)
+{
+	fTracking = tracking;
+	MakeEmpty();
+}
+
+
+bool
+GroupList::AddItem(const Group& group)
+{
+	if (!fTracking)
+		return false;
+
+	if (fCount == fCapacity) {
+		int32 capacity = fCapacity * 2;
+		Group* items = (Group*)malloc(capacity * sizeof(Group));
+		if (items == NULL)
+			return false;
+
+		memcpy(items, fItems, fCount * sizeof(Group));
+		if (fItems != fInlineItems)
+			free(fItems);
+
+		fItems = items;
+		fCapacity = capacity;
+	}
+
+	fItems[fCount++] = group;
+	return true;
+}
+
+
+//	#pragma mark -
+
 
 RenameAction::~RenameAction()
 {
 }
 
 
+/*!	Returns the text that the action puts in place of every target group,
+	if there is one; the expressions in it then only need to be parsed
+	once. The default implementation returns \c NULL.
+*/
+const char*
+RenameAction::Replacement() const
+{
+	return NULL;
+}
+
+
 int32
 RenameAction::SuffixIndex(const char* string) const
 {
@@ -2,7 +2,6 @@
 #define RENAME_ACTION_H
 
 
-#include <ObjectList.h>
 #include <String.h>
 
 
@@ -11,6 +10,10 @@ struct Group {
 	int32	start;
 	int32	end;
 
+	Group()
+	{
+	}
+
 	Group(int32 index, int32 start, int32 end)
 		:
 		index(index),
@@ -21,13 +24,60 @@ struct Group {
 };
 
 
+/*!	The list of groups a RenameAction reports for a name.
+
+	The first few groups are stored inline, and the list keeps its buffer
+	when it is emptied, so that renaming many names does not allocate any
+	memory for the groups. If tracking is disabled, all groups are dropped;
+	this is meant for renaming without a preview.
+*/
+class GroupList {
+public:
+								GroupList(bool tracking = true);
+								~GroupList();
+
+			bool				IsTracking() const
+									{ return fTracking; }
+			void				SetTracking(bool tracking);
+
+			bool				AddItem(const Group& group);
+			Group*				ItemAt(int32 index) const
+									{ return index >= 0 && index < fCount
+										? &fItems[index] : NULL; }
+			Group*				LastItem() const
+									{ return ItemAt(fCount - 1); }
+			int32				CountItems() const
+									{ return fCount; }
+			bool				IsEmpty() const
+									{ return fCount == 0; }
+			void				MakeEmpty()
+									{ fCount = 0; }
+			void				Truncate(int32 count)
+									{ if (count < fCount) fCount = count; }
+
+private:
+								GroupList(const GroupList& other);
+			GroupList&			operator=(const GroupList& other);
+
+private:
+	static	const int32			kInlineCount = 4;
+
+			Group*				fItems;
+			int32				fCount;
+			int32				fCapacity;
+			bool				fTracking;
+			Group				fInlineItems[kInlineCount];
+};
+
+
 class RenameAction {
 public:
 	virtual						~RenameAction();
 
-	virtual BString				Rename(BObjectList<Group>& sourceGroups,
-									BObjectList<Group>& targetGroups,
+	virtual BString				Rename(GroupList& sourceGroups,
+									GroupList& targetGroups,
 									const char* string) const = 0;
+	virtual	const char*			Replacement() const;
 
 protected:
 			int32				SuffixIndex(const char* string) const;
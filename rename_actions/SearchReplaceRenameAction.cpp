@@ -5,11 +5,138 @@
 
 #include "SearchReplaceRenameAction.h"
 
-#include <CheckBox.h>
-#include <LayoutBuilder.h>
-#include <TextControl.h>
 #include <UnicodeChar.h>
 
+#include <string.h>
+
+
+static const uint32 kTwoByteCharacters = 0x800;
+
+
+static inline uint32
+fold(uint32 c)
+{
+	// The Turkish dotted and dotless i are only folded in Turkic locales
+	if (c == 0x130 || c == 0x131)
+		return c;
+
+	// Lower casing the upper case character gets us the simple case
+	// folding for all but a few historic characters
+	return BUnicodeChar::ToLower(BUnicodeChar::ToUpper(c));
+}
+
+
+/*!	Folds ASCII characters to lower case in "map"; bytes with the high bit
+	set are never folded through it. "characters" contains the folding of
+	all characters that can be encoded in up to two bytes, which covers
+	Latin, Greek, and Cyrillic.
+*/
+static struct FoldTable {
+	FoldTable()
+	{
+		for (int32 c = 0; c < 256; c++)
+			map[c] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+		for (uint32 c = 0; c < kTwoByteCharacters; c++)
+			characters[c] = fold(c);
+	}
+
+	uint8	map[256];
+	uint32	characters[kTwoByteCharacters];
+} sFoldTable;
+
+
+/*!	Returns the length of the UTF-8 character at \a position, or 1, if
+	there is no valid character.
+*/
+static int32
+character_length(const char* string, int32 position, int32 length)
+{
+	uint8 c = string[position];
+	int32 bytes = 1;
+	if (c >= 0xf0 && c < 0xf8)
+		bytes = 4;
+	else if (c >= 0xe0)
+		bytes = 3;
+	else if (c >= 0xc0)
+		bytes = 2;
+
+	if (position + bytes > length)
+		return 1;
+	for (int32 index = 1; index < bytes; index++) {
+		if ((string[position + index] & 0xc0) != 0x80)
+			return 1;
+	}
+	return bytes;
+}
+
+
+/*!	Returns whether or not the non-ASCII character at \a position folds to
+	an ASCII character. Besides a few two byte characters, this is only true
+	for the Kelvin sign.
+*/
+static bool
+folds_to_ascii(const char* string, int32 position, int32 bytes)
+{
+	if (bytes == 2) {
+		uint32 c = ((string[position] & 0x1f) << 6)
+			| (string[position + 1] & 0x3f);
+		return sFoldTable.characters[c] < 0x80;
+	}
+	return bytes == 3 && memcmp(string + position, "\xe2\x84\xaa", 3) == 0;
+}
+
+
+/*!	Stores the simple case folding of the character at \a position in
+	\a folded, and returns its length. Invalid characters are not folded.
+*/
+static int32
+fold_character(const char* string, int32 position, int32 bytes,
+	char* folded)
+{
+	if (bytes == 1) {
+		folded[0] = sFoldTable.map[(uint8)string[position]];
+		return 1;
+	}
+
+	uint32 c = BUnicodeChar::FromUTF8(string + position);
+	c = c < kTwoByteCharacters ? sFoldTable.characters[c] : fold(c);
+
+	char* target = folded;
+	BUnicodeChar::ToUTF8(c, &target);
+	return target - folded;
+}
+
+
+/*!	Moves \a position forward by \a count UTF-8 characters.
+	\return the new position, or -1 if \a string ends before.
+*/
+static int32
+skip_characters(const char* string, int32 position, int32 length,
+	int32 count)
+{
+	while (count-- > 0) {
+		if (position >= length)
+			return -1;
+
+		position++;
+		while (position < length && (string[position] & 0xc0) == 0x80)
+			position++;
+	}
+	return position;
+}
+
+
+static int32
+previous_characters(const char* string, int32 position, int32 count)
+{
+	while (count-- > 0) {
+		position--;
+		while (position > 0 && (string[position] & 0xc0) == 0x80)
+			position--;
+	}
+	return position;
+}
+
 
 //	#pragma mark - SearchReplaceRenameAction
 
@@ -31,8 +158,18 @@ void
 SearchReplaceRenameAction::SetPattern(const char* pattern)
 {
 	fPattern = pattern;
+	_Compile();
 }
 
+
+void
+SearchReplaceRenameAction::SetCaseInsensitive(bool insensitive)
+{
+	fCaseInsensitive = insensitive;
+	_Compile();
+}
+
+
 void
 SearchReplaceRenameAction::SetReplace(const char* replace)
 {
@@ -41,10 +178,10 @@ SearchReplaceRenameAction::SetReplace(const char* replace)
 
 
 BString
-SearchReplaceRenameAction::Rename(BObjectList<Group>& sourceGroups,
-	BObjectList<Group>& targetGroups, const char* string) const
+SearchReplaceRenameAction::Rename(GroupList& sourceGroups,
+	GroupList& targetGroups, const char* string) const
 {
-	if (fPattern.IsEmpty())
+	if (fProgram.empty())
 		return string;
 
 	BString output;
@@ -53,83 +190,30 @@ SearchReplaceRenameAction::Rename(BObjectList<Group>& sourceGroups,
 	if (fIgnoreExtension)
 		suffixIndex = SuffixIndex(string);
 
-	int stringLength = suffixIndex >= 0 ? suffixIndex : strlen(string);
-	bool wasAny = false;
-	int seenAnyIndex = -1;
-	int firstMatchIndex = -1;
-	int copyIndex = 0;
-	int patternIndex = _NextPatternIndex(-1, wasAny);
-	int groupIndex = 0;
-	if (wasAny)
-		seenAnyIndex = patternIndex;
-
-	for (int valueIndex = 0; valueIndex < stringLength; valueIndex++) {
-		if (patternIndex >= fPattern.Length()) {
-			// Pattern matched, copy pending
-			output.Append(string + copyIndex, firstMatchIndex - copyIndex);
-			copyIndex = valueIndex;
-
-			bool newGroup = _AddGroup(sourceGroups, groupIndex, firstMatchIndex,
-				wasAny ? stringLength : valueIndex);
-
-			if (!fReplace.IsEmpty()) {
-				_AddGroup(targetGroups, groupIndex, output.Length(),
-					output.Length() + fReplace.Length());
-				output.Append(fReplace);
-			}
-			if (newGroup)
-				groupIndex++;
-
-			if (wasAny) {
-				copyIndex = stringLength;
-				break;
-			}
-
-			// Start again
-			patternIndex = _NextPatternIndex(-1, wasAny);
-			firstMatchIndex = -1;
-		}
-
-		char patternChar = fPattern.ByteAt(patternIndex);
-		char valueChar = string[valueIndex];
-		if (patternChar!='?' && ((!fCaseInsensitive && valueChar!=patternChar)
-			|| (fCaseInsensitive && BUnicodeChar::ToLower(valueChar)
-					!=BUnicodeChar::ToLower(patternChar)))) {
-			if (wasAny)
-				continue;
-			if (seenAnyIndex != -1) {
-				patternIndex = seenAnyIndex;
-				continue;
-			}
-
-			// Try again...
-			patternIndex = _NextPatternIndex(-1, wasAny);
-			firstMatchIndex = -1;
-			continue;
-		}
-
-		if (firstMatchIndex == -1)
-			firstMatchIndex = valueIndex;
-
-		patternIndex = _NextPatternIndex(patternIndex, wasAny);
-		if (wasAny)
-			seenAnyIndex = patternIndex;
-	}
+	int32 stringLength = suffixIndex >= 0 ? suffixIndex : strlen(string);
+	int32 copyIndex = 0;
+	int32 groupIndex = 0;
+	int32 start;
+	int32 end;
 
-	if (patternIndex >= fPattern.Length()) {
-		// Pattern matched, copy pending
-		output.Append(string + copyIndex, firstMatchIndex - copyIndex);
+	while (copyIndex < stringLength
+		&& _Match(string, stringLength, copyIndex, start, end)) {
+		output.Append(string + copyIndex, start - copyIndex);
 
-		_AddGroup(sourceGroups, groupIndex, firstMatchIndex, stringLength);
+		bool newGroup = _AddGroup(sourceGroups, groupIndex, start, end);
 		if (!fReplace.IsEmpty()) {
 			_AddGroup(targetGroups, groupIndex, output.Length(),
 				output.Length() + fReplace.Length());
-
 			output.Append(fReplace);
 		}
-	} else if (copyIndex < stringLength)
-		output.Append(string + copyIndex, stringLength - copyIndex);
+		if (newGroup)
+			groupIndex++;
+
+		copyIndex = end;
+	}
 
+	if (copyIndex < stringLength)
+		output.Append(string + copyIndex, stringLength - copyIndex);
 	if (suffixIndex >= 0)
 		output.Append(string + suffixIndex);
 
@@ -137,138 +221,302 @@ SearchReplaceRenameAction::Rename(BObjectList<Group>& sourceGroups,
 }
 
 
-int
-SearchReplaceRenameAction::_NextPatternIndex(int index, bool& wasAny) const
+/*!	Compiles the pattern into runs of literals, '?', and '*'. The literals
+	are stored in fCompiledPattern, case folded when ignoring case. The
+	length of a '?' token is the number of characters it matches.
+*/
+void
+SearchReplaceRenameAction::_Compile()
 {
-	wasAny = false;
+	fCompiledPattern.Truncate(0);
+	fProgram.clear();
+
+	const char* pattern = fPattern.String();
+	int32 length = fPattern.Length();
+	int32 index = 0;
+	while (index < length) {
+		char c = pattern[index];
+		token_type type = LITERAL;
+		if (c == '*')
+			type = ANY_STRING;
+		else if (c == '?')
+			type = ANY_CHARACTER;
+
+		if (fProgram.empty() || fProgram.back().type != type) {
+			Token token = {type, fCompiledPattern.Length(), 0};
+			fProgram.push_back(token);
+		}
 
-	if (++index >= fPattern.Length())
-		return index;
+		Token& token = fProgram.back();
+		if (type != LITERAL) {
+			if (type == ANY_CHARACTER)
+				token.length++;
+			index++;
+			continue;
+		}
 
-	while (index < fPattern.Length() && fPattern.ByteAt(index) == '*') {
-		index++;
-		wasAny = true;
+		int32 bytes = character_length(pattern, index, length);
+		if (fCaseInsensitive) {
+			char folded[4];
+			int32 foldedLength = fold_character(pattern, index, bytes,
+				folded);
+			fCompiledPattern.Append(folded, foldedLength);
+			token.length += foldedLength;
+		} else {
+			fCompiledPattern.Append(pattern + index, bytes);
+			token.length += bytes;
+		}
+		index += bytes;
 	}
-
-	return index;
 }
 
 
+/*!	Finds the next match of the pattern in \a string, starting at \a from.
+
+	The pattern is matched segment by segment, and every segment is searched
+	right after the end of the previous one. Since the leftmost match of a
+	segment leaves the most room for the following ones, this never has to
+	backtrack into an earlier segment: if a segment cannot be found after the
+	leftmost match of its predecessor, it cannot be found after any other
+	either. Every segment search is linear for literals, and O(n * m) in the
+	worst case when it contains '?', so the whole match is O(n * m).
+
+	A '*' matches as few characters as possible, except at the end of the
+	pattern where it matches the rest of the string. A leading '*' matches
+	everything from \a from on, too.
+*/
 bool
-SearchReplaceRenameAction::_AddGroup(BObjectList<Group>& groups,
-	int32 groupIndex, int32 start, int32 end) const
+SearchReplaceRenameAction::_Match(const char* string, int32 length,
+	int32 from, int32& start, int32& end) const
 {
-	bool newGroup = groups.IsEmpty();
-	Group* last = newGroup ? NULL : groups.ItemAt(groups.CountItems() - 1);
-	if (last != NULL)
-		newGroup = last->end != start;
-
-	if (newGroup) {
-		groups.AddItem(new Group(groupIndex, start, end));
+	int32 count = fProgram.size();
+	int32 first = 0;
+	while (first < count && fProgram[first].type == ANY_STRING)
+		first++;
+
+	if (first == count) {
+		// The pattern only consists of '*'
+		start = from;
+		end = length;
 		return true;
 	}
+	bool leadingAny = first > 0;
+
+	int32 last = first;
+	while (last < count && fProgram[last].type != ANY_STRING)
+		last++;
+
+	int32 position = _FindSegment(first, last, string, from, length, start);
+	if (position < 0)
+		return false;
+	if (leadingAny)
+		start = from;
+
+	while (last < count) {
+		first = last + 1;
+		if (first == count) {
+			// A trailing '*' matches the rest of the string
+			end = length;
+			return true;
+		}
 
-	// Bump last
-	last->end = end;
-	return false;
-}
+		last = first;
+		while (last < count && fProgram[last].type != ANY_STRING)
+			last++;
 
+		int32 segmentStart;
+		position = _FindSegment(first, last, string, position, length,
+			segmentStart);
+		if (position < 0)
+			return false;
+	}
 
-//	#pragma mark - SearchReplaceView
+	end = position;
+	return true;
+}
 
 
-SearchReplaceView::SearchReplaceView()
-	:
-	RenameView("method:search & replace")
+/*!	Finds the first match of the segment of tokens from \a first to \a last
+	(exclusive) in \a string, starting at \a from. The first literal of the
+	segment is located directly, and only its hits are checked further.
+	\return the end of the match, or -1 if there is none.
+*/
+int32
+SearchReplaceRenameAction::_FindSegment(int32 first, int32 last,
+	const char* string, int32 from, int32 length, int32& start) const
 {
-	Init();
+	int32 anchor = first;
+	int32 lead = 0;
+	while (anchor < last && fProgram[anchor].type == ANY_CHARACTER)
+		lead += fProgram[anchor++].length;
+
+	if (anchor == last) {
+		// There are only '?' in this segment
+		start = from;
+		return skip_characters(string, from, length, lead);
+	}
+
+	const Token& literal = fProgram[anchor];
+	int32 position = skip_characters(string, from, length, lead);
+	if (position < 0)
+		return -1;
+
+	while (true) {
+		int32 literalEnd;
+		position = _FindLiteral(literal, string, position, length,
+			literalEnd);
+		if (position < 0)
+			return -1;
+
+		int32 end = _MatchSegment(anchor + 1, last, string, literalEnd,
+			length);
+		if (end >= 0) {
+			start = previous_characters(string, position, lead);
+			return end;
+		}
+		position = skip_characters(string, position, length, 1);
+	}
 }
 
 
-SearchReplaceView::~SearchReplaceView()
+/*!	Matches the segment of tokens from \a first to \a last (exclusive)
+	exactly at \a position.
+	\return the end of the match, or -1 if it does not match there.
+*/
+int32
+SearchReplaceRenameAction::_MatchSegment(int32 first, int32 last,
+	const char* string, int32 position, int32 length) const
 {
+	for (int32 index = first; index < last; index++) {
+		const Token& token = fProgram[index];
+		if (token.type == ANY_CHARACTER)
+			position = skip_characters(string, position, length,
+				token.length);
+		else
+			position = _MatchLiteral(token, string, position, length);
+
+		if (position < 0)
+			return -1;
+	}
+	return position;
 }
 
 
-RenameAction*
-SearchReplaceView::Action() const
+/*!	Finds the first match of the literal \a token in \a string, starting
+	at \a from, and stores the end of the match in \a end.
+	\return the start of the match, or -1 if there is none.
+*/
+int32
+SearchReplaceRenameAction::_FindLiteral(const Token& token,
+	const char* string, int32 from, int32 length, int32& end) const
 {
-	SearchReplaceRenameAction* action = new SearchReplaceRenameAction;
-	action->SetPattern(fPatternControl->Text());
-	action->SetReplace(fReplaceControl->Text());
-	action->SetCaseInsensitive(
-		fCaseInsensitiveCheckBox->Value() == B_CONTROL_ON);
-	action->SetIgnoreExtension(
-		fIgnoreExtensionCheckBox->Value() == B_CONTROL_ON);
-	return action;
-}
+	const char* literal = fCompiledPattern.String() + token.offset;
 
+	if (!fCaseInsensitive) {
+		if (from + token.length > length)
+			return -1;
 
-void
-SearchReplaceView::RequestFocus() const
-{
-	fPatternControl->MakeFocus(true);
-}
+		const char* found = (const char*)memmem(string + from,
+			length - from, literal, token.length);
+		if (found == NULL)
+			return -1;
 
+		end = found - string + token.length;
+		return found - string;
+	}
 
-void
-SearchReplaceView::SetSettings(const BMessage& settings)
-{
-	fPatternControl->SetText(settings.GetString("pattern"));
-	fReplaceControl->SetText(settings.GetString("replace"));
-	fCaseInsensitiveCheckBox->SetValue(settings.GetBool("case insensitive")
-		? B_CONTROL_ON : B_CONTROL_OFF);
-	fIgnoreExtensionCheckBox->SetValue(settings.GetBool("ignore extension")
-		? B_CONTROL_ON : B_CONTROL_OFF);
-}
+	// Only characters that can fold to the first byte of the literal are
+	// checked further
+	uint8 first = literal[0];
+	int32 position = from;
+	while (position < length) {
+		uint8 c = string[position];
+		int32 bytes = 1;
+		if (c < 0x80) {
+			if (sFoldTable.map[c] != first) {
+				position++;
+				continue;
+			}
+		} else {
+			bytes = character_length(string, position, length);
+			if (first < 0x80 && !folds_to_ascii(string, position, bytes)) {
+				position += bytes;
+				continue;
+			}
+		}
 
+		end = _MatchLiteral(token, string, position, length);
+		if (end >= 0)
+			return position;
 
-void
-SearchReplaceView::GetSettings(BMessage& settings)
-{
-	settings.SetString("pattern", fPatternControl->Text());
-	settings.SetString("replace", fReplaceControl->Text());
-	settings.SetBool("case insensitive",
-		fCaseInsensitiveCheckBox->Value() == B_CONTROL_ON);
-	settings.SetBool("ignore extension",
-		fIgnoreExtensionCheckBox->Value() == B_CONTROL_ON);
+		position += bytes;
+	}
+	return -1;
 }
 
 
-SearchReplaceView::SearchReplaceView(const char* name)
-	:
-	RenameView(name)
+/*!	Matches the literal \a token exactly at \a position.
+	\return the end of the match, or -1 if it does not match there.
+*/
+int32
+SearchReplaceRenameAction::_MatchLiteral(const Token& token,
+	const char* string, int32 position, int32 length) const
 {
-	Init();
+	const char* literal = fCompiledPattern.String() + token.offset;
+
+	if (!fCaseInsensitive) {
+		if (position + token.length > length
+			|| memcmp(literal, string + position, token.length) != 0)
+			return -1;
+
+		return position + token.length;
+	}
+
+	int32 index = 0;
+	while (index < token.length) {
+		if (position >= length)
+			return -1;
+
+		uint8 c = string[position];
+		if (c < 0x80) {
+			// ASCII fast path
+			if (sFoldTable.map[c] != (uint8)literal[index])
+				return -1;
+
+			position++;
+			index++;
+			continue;
+		}
+
+		int32 bytes = character_length(string, position, length);
+		char folded[4];
+		int32 foldedLength = fold_character(string, position, bytes, folded);
+		if (index + foldedLength > token.length
+			|| memcmp(literal + index, folded, foldedLength) != 0)
+			return -1;
+
+		position += bytes;
+		index += foldedLength;
+	}
+	return position;
 }
 
 
-void
-SearchReplaceView::Init()
+bool
+SearchReplaceRenameAction::_AddGroup(GroupList& groups,
+	int32 groupIndex, int32 start, int32 end) const
 {
-	fPatternControl = new BTextControl("Pattern", NULL, NULL);
-	fPatternControl->SetModificationMessage(new BMessage(kMsgUpdatePreview));
-
-	fReplaceControl = new BTextControl("Replace with", NULL, NULL);
-	fReplaceControl->SetModificationMessage(new BMessage(kMsgUpdatePreview));
-
-	fIgnoreExtensionCheckBox = new BCheckBox("extension", "Ignore extension",
-		new BMessage(kMsgUpdatePreview));
-	fCaseInsensitiveCheckBox = new BCheckBox("case", "Case insensitive",
-		new BMessage(kMsgUpdatePreview));
-
-	BLayoutBuilder::Group<>(this, B_VERTICAL)
-		.SetInsets(B_USE_DEFAULT_SPACING, 0, 0, 0)
-		.AddGrid(0.f)
-			.Add(fPatternControl->CreateLabelLayoutItem(), 0, 0)
-			.Add(fPatternControl->CreateTextViewLayoutItem(), 1, 0)
-			.Add(fReplaceControl->CreateLabelLayoutItem(), 0, 1)
-			.Add(fReplaceControl->CreateTextViewLayoutItem(), 1, 1)
-		.End()
-		.AddGroup(B_HORIZONTAL)
-			.AddGlue()
-			.Add(fIgnoreExtensionCheckBox)
-			.Add(fCaseInsensitiveCheckBox)
-		.End()
-		.AddGlue();
+	bool newGroup = groups.IsEmpty();
+	Group* last = newGroup ? NULL : groups.ItemAt(groups.CountItems() - 1);
+	if (last != NULL)
+		newGroup = last->end != start;
+
+	if (newGroup) {
+		groups.AddItem(Group(groupIndex, start, end));
+		return true;
+	}
+
+	// Bump last
+	last->end = end;
+	return false;
 }
@@ -6,11 +6,8 @@
 
 
 #include "RenameAction.h"
-#include "RenameView.h"
 
-
-class BCheckBox;
-class BTextControl;
+#include <vector>
 
 
 class SearchReplaceRenameAction : public RenameAction {
@@ -21,52 +18,59 @@ public:
 			void				SetPattern(const char* pattern);
 			void				SetReplace(const char* replace);
 
-			void				SetCaseInsensitive(bool insensitive)
-									{ fCaseInsensitive = insensitive; }
+			void				SetCaseInsensitive(bool insensitive);
 			void				SetIgnoreExtension(bool ignore)
 									{ fIgnoreExtension = ignore; }
 
-	virtual BString				Rename(BObjectList<Group>& sourceGroups,
-									BObjectList<Group>& targetGroups,
+	virtual BString				Rename(GroupList& sourceGroups,
+									GroupList& targetGroups,
 									const char* string) const;
+	virtual	const char*			Replacement() const
+									{ return fReplace.String(); }
 
 private:
-			int					_NextPatternIndex(int index,
-									bool& wasAny) const;
-			bool				_AddGroup(BObjectList<Group>& groups,
+			enum token_type {
+				LITERAL,
+				ANY_CHARACTER,
+				ANY_STRING
+			};
+
+			struct Token {
+				token_type		type;
+				int32			offset;
+				int32			length;
+			};
+
+			typedef std::vector<Token> TokenList;
+
+			void				_Compile();
+			bool				_Match(const char* string, int32 length,
+									int32 from, int32& start,
+									int32& end) const;
+			int32				_FindSegment(int32 first, int32 last,
+									const char* string, int32 from,
+									int32 length, int32& start) const;
+			int32				_MatchSegment(int32 first, int32 last,
+									const char* string, int32 position,
+									int32 length) const;
+			int32				_FindLiteral(const Token& token,
+									const char* string, int32 from,
+									int32 length, int32& end) const;
+			int32				_MatchLiteral(const Token& token,
+									const char* string, int32 position,
+									int32 length) const;
+			bool				_AddGroup(GroupList& groups,
 									int32 groupIndex, int32 start,
 									int32 end) const;
 
 private:
 			BString				fPattern;
+			BString				fCompiledPattern;
+			TokenList			fProgram;
 			BString				fReplace;
 			bool				fCaseInsensitive;
 			bool				fIgnoreExtension;
 };
 
 
-class SearchReplaceView : public RenameView {
-public:
-								SearchReplaceView();
-	virtual						~SearchReplaceView();
-
-	virtual	RenameAction*		Action() const;
-	virtual void				RequestFocus() const;
-
-	virtual	void				SetSettings(const BMessage& settings);
-	virtual void				GetSettings(BMessage& settings);
-
-protected:
-								SearchReplaceView(const char* name);
-
-			void				Init();
-
-protected:
-			BTextControl*		fPatternControl;
-			BTextControl*		fReplaceControl;
-			BCheckBox*			fIgnoreExtensionCheckBox;
-			BCheckBox*			fCaseInsensitiveCheckBox;
-};
-
-
 #endif	// SEARCH_REPLACE_RENAME_ACTION_H
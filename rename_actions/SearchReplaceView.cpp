@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019-2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "SearchReplaceView.h"
+
+#include "SearchReplaceRenameAction.h"
+
+#include <CheckBox.h>
+#include <LayoutBuilder.h>
+#include <TextControl.h>
+
+
+//	#pragma mark - SearchReplaceView
+
+
+SearchReplaceView::SearchReplaceView()
+	:
+	RenameView("method:search & replace")
+{
+	Init();
+}
+
+
+SearchReplaceView::~SearchReplaceView()
+{
+}
+
+
+RenameAction*
+SearchReplaceView::Action() const
+{
+	SearchReplaceRenameAction* action = new SearchReplaceRenameAction;
+	action->SetPattern(fPatternControl->Text());
+	action->SetReplace(fReplaceControl->Text());
+	action->SetCaseInsensitive(
+		fCaseInsensitiveCheckBox->Value() == B_CONTROL_ON);
+	action->SetIgnoreExtension(
+		fIgnoreExtensionCheckBox->Value() == B_CONTROL_ON);
+	return action;
+}
+
+
+void
+SearchReplaceView::RequestFocus() const
+{
+	fPatternControl->MakeFocus(true);
+}
+
+
+void
+SearchReplaceView::SetSettings(const BMessage& settings)
+{
+	fPatternControl->SetText(settings.GetString("pattern"));
+	fReplaceControl->SetText(settings.GetString("replace"));
+	fCaseInsensitiveCheckBox->SetValue(settings.GetBool("case insensitive")
+		? B_CONTROL_ON : B_CONTROL_OFF);
+	fIgnoreExtensionCheckBox->SetValue(settings.GetBool("ignore extension")
+		? B_CONTROL_ON : B_CONTROL_OFF);
+}
+
+
+void
+SearchReplaceView::GetSettings(BMessage& settings)
+{
+	settings.SetString("pattern", fPatternControl->Text());
+	settings.SetString("replace", fReplaceControl->Text());
+	settings.SetBool("case insensitive",
+		fCaseInsensitiveCheckBox->Value() == B_CONTROL_ON);
+	settings.SetBool("ignore extension",
+		fIgnoreExtensionCheckBox->Value() == B_CONTROL_ON);
+}
+
+
+SearchReplaceView::SearchReplaceView(const char* name)
+	:
+	RenameView(name)
+{
+	Init();
+}
+
+
+void
+SearchReplaceView::Init()
+{
+	fPatternControl = new BTextControl("Pattern", NULL, NULL);
+	fPatternControl->SetModificationMessage(new BMessage(kMsgUpdatePreview));
+
+	fReplaceControl = new BTextControl("Replace with", NULL, NULL);
+	fReplaceControl->SetModificationMessage(new BMessage(kMsgUpdatePreview));
+
+	fIgnoreExtensionCheckBox = new BCheckBox("extension", "Ignore extension",
+		new BMessage(kMsgUpdatePreview));
+	fCaseInsensitiveCheckBox = new BCheckBox("case", "Case insensitive",
+		new BMessage(kMsgUpdatePreview));
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL)
+		.SetInsets(B_USE_DEFAULT_SPACING, 0, 0, 0)
+		.AddGrid(0.f)
+			.Add(fPatternControl->CreateLabelLayoutItem(), 0, 0)
+			.Add(fPatternControl->CreateTextViewLayoutItem(), 1, 0)
+			.Add(fReplaceControl->CreateLabelLayoutItem(), 0, 1)
+			.Add(fReplaceControl->CreateTextViewLayoutItem(), 1, 1)
+		.End()
+		.AddGroup(B_HORIZONTAL)
+			.GetLayout(&fOptionsLayout)
+			.AddGlue()
+			.Add(fIgnoreExtensionCheckBox)
+			.Add(fCaseInsensitiveCheckBox)
+		.End()
+		.AddGlue();
+}
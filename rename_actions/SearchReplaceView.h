@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2019 pinc Software. All Rights Reserved.
+ */
+#ifndef SEARCH_REPLACE_VIEW_H
+#define SEARCH_REPLACE_VIEW_H
+
+
+#include "RenameView.h"
+
+
+class BCheckBox;
+class BGroupLayout;
+class BTextControl;
+
+
+class SearchReplaceView : public RenameView {
+public:
+								SearchReplaceView();
+	virtual						~SearchReplaceView();
+
+	virtual	RenameAction*		Action() const;
+	virtual void				RequestFocus() const;
+
+	virtual	void				SetSettings(const BMessage& settings);
+	virtual void				GetSettings(BMessage& settings);
+
+protected:
+								SearchReplaceView(const char* name);
+
+			void				Init();
+
+protected:
+			BTextControl*		fPatternControl;
+			BTextControl*		fReplaceControl;
+			BCheckBox*			fIgnoreExtensionCheckBox;
+			BCheckBox*			fCaseInsensitiveCheckBox;
+			BGroupLayout*		fOptionsLayout;
+};
+
+
+#endif	// SEARCH_REPLACE_VIEW_H
@@ -5,8 +5,52 @@
 
 #include "WindowsRenameAction.h"
 
-#include <LayoutBuilder.h>
-#include <TextControl.h>
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+
+/*!	All bytes that are invalid on Windows when they form a character on
+	their own: control characters, the reserved punctuation, and bytes
+	that are not part of a valid UTF-8 sequence.
+*/
+static const uint32 kInvalidBytes[8] = {
+	0xffffffff,		// 0x00 - 0x1f
+	0xd4008404,		// " * / : < > ?
+	0x10000000,		// backslash
+	0x10000000,		// |
+	0xffffffff,
+	0xffffffff,
+	0xffffffff,
+	0xffffffff
+};
+
+static const char* kReservedNames[] = {
+	"CON", "PRN", "AUX", "NUL"
+};
+static const char* kReservedPorts[] = {
+	"COM", "LPT"
+};
+
+
+/*!	Returns the length in bytes of the character at \a position; like
+	BString::CharAt(), all following continuation bytes are counted to it.
+*/
+static inline int32
+character_size(const char* string, int32 position, int32 length)
+{
+	int32 end = position + 1;
+	while (end < length && (string[end] & 0xc0) == 0x80)
+		end++;
+	return end - position;
+}
+
+
+static inline bool
+is_trailing_character(char c)
+{
+	return c == '.' || c == ' ';
+}
 
 
 //	#pragma mark - WindowsRenameAction
@@ -14,7 +58,8 @@
 
 WindowsRenameAction::WindowsRenameAction()
 	:
-	fReplaceString("_")
+	fReplaceString("_"),
+	fReservedSuffix("_")
 {
 }
 
@@ -29,186 +74,207 @@ WindowsRenameAction::SetReplaceString(const char* replace)
 {
 	if (replace == NULL || replace[0] == '\0') {
 		fReplaceString = "";
+		fReservedSuffix = "_";
 		return;
 	}
 
 	// Filter out invalid characters from the replace string
-	BString name(replace);
-	int32 length = name.CountChars();
-	for (int32 index = 0; index < length; index++) {
-		int32 charSize;
-		const char* pos = name.CharAt(index, &charSize);
-		if (charSize == 1 && _IsInvalidCharacter(pos[0])) {
-			name.RemoveChars(index--, 1);
-			length--;
+	int32 length = strlen(replace);
+	BString name;
+	char* buffer = name.LockBuffer(length);
+	int32 nameLength = 0;
+
+	for (int32 index = 0; index < length;) {
+		int32 size = character_size(replace, index, length);
+		if (size != 1 || !_IsInvalidCharacter(replace[index])) {
+			memcpy(buffer + nameLength, replace + index, size);
+			nameLength += size;
 		}
+		index += size;
 	}
+	name.UnlockBuffer(nameLength);
 
 	if (name.IsEmpty())
 		fReplaceString = "_";
 	else
 		fReplaceString = name;
+
+	// The suffix of reserved names, and the replacement of names that
+	// are empty must not be cut off again as trailing dots or spaces
+	int32 suffixLength = fReplaceString.Length();
+	while (suffixLength > 0
+		&& is_trailing_character(fReplaceString[suffixLength - 1]))
+		suffixLength--;
+
+	if (suffixLength == 0)
+		fReservedSuffix = "_";
+	else
+		fReservedSuffix.SetTo(fReplaceString.String(), suffixLength);
 }
 
 
+/*!	Replaces all characters that are invalid on Windows in a single pass,
+	and removes trailing dots and spaces. Reserved device names like "CON",
+	or "nul.txt" get the replace string (or an underscore) appended to
+	their base name. A name that would end up empty is replaced by the
+	replace string as a whole.
+*/
 BString
-WindowsRenameAction::Rename(BObjectList<Group>& sourceGroups,
-	BObjectList<Group>& targetGroups, const char* string) const
+WindowsRenameAction::Rename(GroupList& sourceGroups,
+	GroupList& targetGroups, const char* string) const
 {
-	BString stringBuffer = string;
-	int32 length = stringBuffer.CountChars();
-	int groupIndex = 1;
-	int begin = -1;
-	int index = 0;
-	int byteIndex = 0;
-	int sourceGroupIndex = 1;
-	int sourceBegin = -1;
-	int sourceByteIndex = 0;
-
-	for (; index < length; index++) {
-		int32 charSize;
-		const char* pos = stringBuffer.CharAt(index, &charSize);
-		if (charSize == 1 && _IsInvalidCharacter(pos[0])) {
-			stringBuffer.Remove(byteIndex, charSize);
-			stringBuffer.Insert(fReplaceString, byteIndex);
-
-			if (begin == -1 && !fReplaceString.IsEmpty())
-				begin = byteIndex;
-			if (sourceBegin == -1)
-				sourceBegin = sourceByteIndex;
-
-			byteIndex += fReplaceString.Length() - charSize;
-			int32 diff = fReplaceString.CountChars() - 1;
-			index += diff;
-			length += diff;
-		} else {
-			if (begin >= 0) {
-				targetGroups.AddItem(new Group(groupIndex++, begin, byteIndex));
-				begin = -1;
-			}
-			if (sourceBegin >= 0) {
-				sourceGroups.AddItem(new Group(sourceGroupIndex++, sourceBegin,
-					sourceByteIndex));
-				sourceBegin = -1;
-			}
-		}
-		byteIndex += charSize;
-		sourceByteIndex += charSize;
-	}
+	int32 length = strlen(string);
 
-	if (begin >= 0)
-		targetGroups.AddItem(new Group(groupIndex++, begin, byteIndex));
-	if (sourceBegin >= 0) {
-		sourceGroups.AddItem(new Group(sourceGroupIndex++, sourceBegin,
-			sourceByteIndex));
-	}
+	// Trailing dots or spaces are cut off
+	int32 end = length;
+	while (end > 0 && is_trailing_character(string[end - 1]))
+		end--;
 
-	// Mark trailing dots or spaces
-	BString text(string);
-	int end = sourceByteIndex;
-	int sourceIndex = text.CountChars();
-	while (--sourceIndex > 0) {
-		int32 charSize;
-		const char* pos = text.CharAt(sourceIndex, &charSize);
-		if (charSize != 1 || (pos[0] != ' ' && pos[0] != '.'))
+	int32 position = 0;
+	while (position < length) {
+		int32 size = character_size(string, position, length);
+		if (size == 1 && _IsInvalidCharacter(string[position]))
 			break;
-
-		sourceByteIndex -= charSize;
-		sourceBegin = sourceByteIndex;
+		position += size;
 	}
 
-	if (sourceBegin >= 0)
-		sourceGroups.AddItem(new Group(sourceGroupIndex++, sourceBegin, end));
-
-	// Cut off trailing dots or spaces
-	while (--index > 0) {
-		int32 charSize;
-		char* pos = const_cast<char*>(stringBuffer.CharAt(index, &charSize));
-		if (charSize != 1 || (pos[0] != ' ' && pos[0] != '.'))
-			break;
+	// Reserved names consist of valid characters only, so their base name
+	// always ends before the first invalid character
+	int32 reservedLength = _ReservedNameLength(string, length);
 
-		stringBuffer.TruncateChars(index);
+	if (position == length && end == length && reservedLength == 0) {
+		// Nothing to do
+		return string;
 	}
 
-	return stringBuffer;
-}
-
-
-/*static*/ bool
-WindowsRenameAction::_IsInvalidCharacter(char c)
-{
-	if (c <= 0x1f)
-		return true;
-
-	switch (c) {
-		case '"':
-		case '*':
-		case ':':
-		case '<':
-		case '>':
-		case '?':
-		case '\\':
-		case '/':
-		case '|':
-			return true;
+	const char* replace = fReplaceString.String();
+	int32 replaceLength = fReplaceString.Length();
+	int32 suffixLength = reservedLength > 0 ? fReservedSuffix.Length() : 0;
+	int32 capacity = position + suffixLength + (length - position)
+		* (replaceLength > 1 ? replaceLength : 1);
+
+	BString result;
+	char* buffer = result.LockBuffer(capacity);
+	if (buffer == NULL)
+		return string;
+
+	int32 sourceGroupStart = sourceGroups.CountItems();
+	int32 targetGroupStart = targetGroups.CountItems();
+	int32 groupIndex = 1;
+	int32 sourceGroupIndex = 1;
+
+	memcpy(buffer, string, reservedLength);
+	int32 outLength = reservedLength;
+	if (reservedLength > 0) {
+		memcpy(buffer + outLength, fReservedSuffix.String(), suffixLength);
+		outLength += suffixLength;
+
+		sourceGroups.AddItem(Group(sourceGroupIndex++, 0, reservedLength));
+		targetGroups.AddItem(Group(groupIndex++, reservedLength, outLength));
 	}
 
-	return false;
-}
-
+	memcpy(buffer + outLength, string + reservedLength,
+		position - reservedLength);
+	outLength += position - reservedLength;
 
-//	#pragma mark - WindowsRenameView
+	int32 begin = -1;
+	int32 sourceBegin = -1;
 
+	while (position < length) {
+		int32 size = character_size(string, position, length);
+		if (size == 1 && _IsInvalidCharacter(string[position])) {
+			if (begin < 0 && replaceLength > 0)
+				begin = outLength;
+			if (sourceBegin < 0)
+				sourceBegin = position;
 
-WindowsRenameView::WindowsRenameView()
-	:
-	RenameView("method:windows")
-{
-	fReplaceControl = new BTextControl("Replace character", NULL, NULL);
-	fReplaceControl->SetModificationMessage(new BMessage(kMsgUpdatePreview));
-	fReplaceControl->SetText("_");
-
-	BLayoutBuilder::Group<>(this, B_VERTICAL)
-		.SetInsets(B_USE_DEFAULT_SPACING, 0, 0, 0)
-		.AddGrid(0.f)
-			.Add(fReplaceControl->CreateLabelLayoutItem(), 0, 1)
-			.Add(fReplaceControl->CreateTextViewLayoutItem(), 1, 1)
-		.End()
-		.AddGlue();
-}
-
-
-WindowsRenameView::~WindowsRenameView()
-{
-}
+			memcpy(buffer + outLength, replace, replaceLength);
+			outLength += replaceLength;
+		} else {
+			if (begin >= 0) {
+				targetGroups.AddItem(Group(groupIndex++, begin, outLength));
+				begin = -1;
+			}
+			if (sourceBegin >= 0) {
+				sourceGroups.AddItem(Group(sourceGroupIndex++, sourceBegin,
+					position));
+				sourceBegin = -1;
+			}
 
+			memcpy(buffer + outLength, string + position, size);
+			outLength += size;
+		}
+		position += size;
+	}
 
-RenameAction*
-WindowsRenameView::Action() const
-{
-	WindowsRenameAction* action = new WindowsRenameAction();
-	action->SetReplaceString(fReplaceControl->Text());
+	if (begin >= 0)
+		targetGroups.AddItem(Group(groupIndex++, begin, outLength));
+	if (sourceBegin >= 0 && sourceBegin < end)
+		sourceGroups.AddItem(Group(sourceGroupIndex++, sourceBegin, end));
+	if (end < length)
+		sourceGroups.AddItem(Group(sourceGroupIndex++, end, length));
+
+	// Cut off trailing dots or spaces last, including those of the
+	// replacement
+	while (outLength > 0 && is_trailing_character(buffer[outLength - 1]))
+		outLength--;
+
+	int32 count = targetGroups.CountItems();
+	while (count > targetGroupStart
+		&& targetGroups.ItemAt(count - 1)->start >= outLength)
+		count--;
+	targetGroups.Truncate(count);
+	if (count > targetGroupStart && targetGroups.LastItem()->end > outLength)
+		targetGroups.LastItem()->end = outLength;
+
+	result.UnlockBuffer(outLength);
+
+	if (result.IsEmpty() || result == "." || result == "..") {
+		// Nothing valid is left of the name
+		result = fReservedSuffix;
+
+		sourceGroups.Truncate(sourceGroupStart);
+		targetGroups.Truncate(targetGroupStart);
+		sourceGroups.AddItem(Group(1, 0, length));
+		targetGroups.AddItem(Group(1, 0, result.Length()));
+	}
 
-	return action;
+	return result;
 }
 
 
-void
-WindowsRenameView::RequestFocus() const
+/*static*/ bool
+WindowsRenameAction::_IsInvalidCharacter(char c)
 {
-	fReplaceControl->MakeFocus(true);
+	uint8 byte = (uint8)c;
+	return (kInvalidBytes[byte / 32] & (1UL << (byte % 32))) != 0;
 }
 
 
-void
-WindowsRenameView::SetSettings(const BMessage& settings)
+/*!	If the base name of \a name (everything before the first dot, without
+	trailing spaces) is reserved on Windows, its length is returned.
+	Otherwise, this method returns 0.
+*/
+/*static*/ int32
+WindowsRenameAction::_ReservedNameLength(const char* name, int32 length)
 {
-	fReplaceControl->SetText(settings.GetString("replace"));
-}
-
+	int32 baseLength = 0;
+	while (baseLength < length && name[baseLength] != '.')
+		baseLength++;
+	while (baseLength > 0 && name[baseLength - 1] == ' ')
+		baseLength--;
+
+	if (baseLength == 3) {
+		for (size_t index = 0; index < B_COUNT_OF(kReservedNames); index++) {
+			if (strncasecmp(name, kReservedNames[index], 3) == 0)
+				return baseLength;
+		}
+	} else if (baseLength == 4 && name[3] >= '1' && name[3] <= '9') {
+		for (size_t index = 0; index < B_COUNT_OF(kReservedPorts); index++) {
+			if (strncasecmp(name, kReservedPorts[index], 3) == 0)
+				return baseLength;
+		}
+	}
 
-void
-WindowsRenameView::GetSettings(BMessage& settings)
-{
-	settings.SetString("replace", fReplaceControl->Text());
+	return 0;
 }
@@ -6,9 +6,6 @@
 
 
 #include "RenameAction.h"
-#include "RenameView.h"
-
-class BTextControl;
 
 
 class WindowsRenameAction : public RenameAction {
@@ -18,31 +15,18 @@ public:
 
 			void				SetReplaceString(const char* replace);
 
-	virtual BString				Rename(BObjectList<Group>& sourceGroups,
-									BObjectList<Group>& targetGroups,
+	virtual BString				Rename(GroupList& sourceGroups,
+									GroupList& targetGroups,
 									const char* string) const;
 
 private:
 	static	bool				_IsInvalidCharacter(char c);
+	static	int32				_ReservedNameLength(const char* name,
+									int32 length);
 
 private:
 			BString				fReplaceString;
-};
-
-
-class WindowsRenameView : public RenameView {
-public:
-								WindowsRenameView();
-	virtual						~WindowsRenameView();
-
-	virtual	RenameAction*		Action() const;
-	virtual void				RequestFocus() const;
-
-	virtual	void				SetSettings(const BMessage& settings);
-	virtual void				GetSettings(BMessage& settings);
-
-private:
-			BTextControl*		fReplaceControl;
+			BString				fReservedSuffix;
 };
 
 
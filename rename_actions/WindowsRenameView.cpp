@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2019-2024 pinc Software. All Rights Reserved.
+ */
+
+
+#include "WindowsRenameView.h"
+
+#include "WindowsRenameAction.h"
+
+#include <LayoutBuilder.h>
+#include <TextControl.h>
+
+
+//	#pragma mark - WindowsRenameView
+
+
+WindowsRenameView::WindowsRenameView()
+	:
+	RenameView("method:windows")
+{
+	fReplaceControl = new BTextControl("Replace character", NULL, NULL);
+	fReplaceControl->SetModificationMessage(new BMessage(kMsgUpdatePreview));
+	fReplaceControl->SetText("_");
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL)
+		.SetInsets(B_USE_DEFAULT_SPACING, 0, 0, 0)
+		.AddGrid(0.f)
+			.Add(fReplaceControl->CreateLabelLayoutItem(), 0, 1)
+			.Add(fReplaceControl->CreateTextViewLayoutItem(), 1, 1)
+		.End()
+		.AddGlue();
+}
+
+
+WindowsRenameView::~WindowsRenameView()
+{
+}
+
+
+RenameAction*
+WindowsRenameView::Action() const
+{
+	WindowsRenameAction* action = new WindowsRenameAction();
+	action->SetReplaceString(fReplaceControl->Text());
+
+	return action;
+}
+
+
+void
+WindowsRenameView::RequestFocus() const
+{
+	fReplaceControl->MakeFocus(true);
+}
+
+
+void
+WindowsRenameView::SetSettings(const BMessage& settings)
+{
+	fReplaceControl->SetText(settings.GetString("replace"));
+}
+
+
+void
+WindowsRenameView::GetSettings(BMessage& settings)
+{
+	settings.SetString("replace", fReplaceControl->Text());
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2019 pinc Software. All Rights Reserved.
+ */
+#ifndef WINDOWS_RENAME_VIEW_H
+#define WINDOWS_RENAME_VIEW_H
+
+
+#include "RenameView.h"
+
+class BTextControl;
+
+
+class WindowsRenameView : public RenameView {
+public:
+								WindowsRenameView();
+	virtual						~WindowsRenameView();
+
+	virtual	RenameAction*		Action() const;
+	virtual void				RequestFocus() const;
+
+	virtual	void				SetSettings(const BMessage& settings);
+	virtual void				GetSettings(BMessage& settings);
+
+private:
+			BTextControl*		fReplaceControl;
+};
+
+
+#endif	// WINDOWS_RENAME_VIEW_H
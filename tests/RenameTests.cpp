@@ -0,0 +1,1098 @@
+/*
+ * Copyright (c) 2024 pinc Software. All Rights Reserved.
+ */
+
+
+/*!	Tests for the portable rename engine. Every test is a function that
+	checks its results with CHECK(); the failed checks are printed, and
+	the number of failures is the exit code of the program.
+
+	Run "./rename_tests <filter>" to only run the tests whose name
+	contains the filter.
+*/
+
+
+#include "CaseRenameAction.h"
+#include "DirectoryCache.h"
+#include "ExpressionEvaluator.h"
+#include "ExpressionTemplate.h"
+#include "FileSystem.h"
+#include "ParallelRenamer.h"
+#include "PipelineRenameAction.h"
+#include "RegularExpression.h"
+#include "RegularExpressionRenameAction.h"
+#include "SearchReplaceRenameAction.h"
+#include "ShellWorkerPool.h"
+#include "WindowsRenameAction.h"
+
+#include <TypeConstants.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <map>
+
+
+static int32 sFailureCount;
+
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "  %s:%d: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailureCount++; \
+		} \
+	} while (false)
+
+
+static bool
+has_group(const GroupList& groups, int32 start, int32 end)
+{
+	for (int32 index = 0; index < groups.CountItems(); index++) {
+		const Group* group = groups.ItemAt(index);
+		if (group->start == start && group->end == end)
+			return true;
+	}
+	return false;
+}
+
+
+/*!	A file system in memory that counts how often it is accessed. Its
+	names can be case insensitive; only ASCII characters are folded then.
+*/
+class TestFileSystem : public FileSystem {
+public:
+	struct Entry {
+		struct stat				stat;
+		std::map<BString, BString> attributes;
+	};
+
+	TestFileSystem(bool caseSensitive = true)
+		:
+		statCount(0),
+		readDirectoryCount(0),
+		openCount(0),
+		attributeReadCount(0),
+		fCaseSensitive(caseSensitive),
+		fNextNode(1)
+	{
+		AddEntry("/", S_IFDIR);
+	}
+
+	Entry& AddEntry(const char* path, mode_t mode = S_IFREG)
+	{
+		Entry& entry = fEntries[_Key(path)];
+		memset(&entry.stat, 0, sizeof(entry.stat));
+		entry.stat.st_mode = mode | 0644;
+		entry.stat.st_dev = 1;
+		entry.stat.st_ino = fNextNode++;
+		fNames[_Key(path)] = path;
+		return entry;
+	}
+
+	virtual status_t GetStat(const char* path, struct stat& stat)
+	{
+		statCount++;
+		std::map<BString, Entry>::iterator found = fEntries.find(_Key(path));
+		if (found == fEntries.end())
+			return B_ENTRY_NOT_FOUND;
+
+		stat = found->second.stat;
+		return B_OK;
+	}
+
+	virtual status_t ReadDirectory(const char* path, NameList& names)
+	{
+		readDirectoryCount++;
+		BString prefix = _Key(path);
+		if (prefix != "/")
+			prefix << "/";
+
+		std::map<BString, BString>::iterator iterator = fNames.begin();
+		for (; iterator != fNames.end(); iterator++) {
+			const BString& key = iterator->first;
+			if (key.Length() > prefix.Length()
+				&& !strncmp(key.String(), prefix.String(), prefix.Length())
+				&& strchr(key.String() + prefix.Length(), '/') == NULL) {
+				names.push_back(iterator->second.String() + prefix.Length());
+			}
+		}
+		return B_OK;
+	}
+
+	virtual status_t CreateDirectory(const char* path)
+	{
+		return B_NOT_SUPPORTED;
+	}
+
+	virtual status_t Rename(const char* from, const char* to)
+	{
+		return B_NOT_SUPPORTED;
+	}
+
+	virtual FileNode* OpenNode(const char* path);
+
+	int32						statCount;
+	int32						readDirectoryCount;
+	int32						openCount;
+	int32						attributeReadCount;
+
+private:
+	BString _Key(const char* path) const
+	{
+		BString key(path);
+		if (!fCaseSensitive) {
+			char* buffer = key.LockBuffer(key.Length());
+			for (int32 index = 0; buffer[index] != '\0'; index++) {
+				if (buffer[index] >= 'A' && buffer[index] <= 'Z')
+					buffer[index] += 'a' - 'A';
+			}
+			key.UnlockBuffer(key.Length());
+		}
+		return key;
+	}
+
+	friend class TestFileNode;
+
+	std::map<BString, Entry>	fEntries;
+	std::map<BString, BString>	fNames;
+	bool						fCaseSensitive;
+	ino_t						fNextNode;
+};
+
+
+class TestFileNode : public FileNode {
+public:
+	TestFileNode(TestFileSystem& fileSystem,
+		TestFileSystem::Entry& entry)
+		:
+		fFileSystem(fileSystem),
+		fEntry(entry)
+	{
+	}
+
+	virtual status_t GetAttributeInfo(const char* name, attr_info& info)
+	{
+		std::map<BString, BString>::iterator found
+			= fEntry.attributes.find(name);
+		if (found == fEntry.attributes.end())
+			return B_ENTRY_NOT_FOUND;
+
+		info.type = B_STRING_TYPE;
+		info.size = found->second.Length() + 1;
+		return B_OK;
+	}
+
+	virtual ssize_t ReadAttribute(const char* name, uint32 type,
+		off_t offset, void* buffer, size_t size)
+	{
+		fFileSystem.attributeReadCount++;
+		std::map<BString, BString>::iterator found
+			= fEntry.attributes.find(name);
+		if (found == fEntry.attributes.end())
+			return B_ENTRY_NOT_FOUND;
+
+		size_t length = found->second.Length() + 1;
+		if (offset >= (off_t)length)
+			return 0;
+		if (size > length - offset)
+			size = length - offset;
+		memcpy(buffer, found->second.String() + offset, size);
+		return size;
+	}
+
+private:
+	TestFileSystem&			fFileSystem;
+	TestFileSystem::Entry&	fEntry;
+};
+
+
+FileNode*
+TestFileSystem::OpenNode(const char* path)
+{
+	std::map<BString, Entry>::iterator found = fEntries.find(_Key(path));
+	if (found == fEntries.end())
+		return NULL;
+
+	openCount++;
+	return new TestFileNode(*this, found->second);
+}
+
+
+/*!	Returns whether the \a groups are sorted, and neither empty, nor
+	overlapping, nor outside of a name of the given \a length.
+*/
+static bool
+has_ordered_groups(const GroupList& groups, int32 length)
+{
+	int32 end = 0;
+	for (int32 index = 0; index < groups.CountItems(); index++) {
+		const Group* group = groups.ItemAt(index);
+		if (group->start < end || group->start >= group->end
+			|| group->end > length)
+			return false;
+		end = group->end;
+	}
+	return true;
+}
+
+
+//	#pragma mark - WindowsRenameAction
+
+
+static void
+test_windows_trailing_dots()
+{
+	WindowsRenameAction action;
+	GroupList sourceGroups;
+	GroupList targetGroups;
+
+	CHECK(action.Rename(sourceGroups, targetGroups, "...") == "_");
+	CHECK(has_group(sourceGroups, 0, 3));
+	CHECK(has_group(targetGroups, 0, 1));
+
+	sourceGroups.MakeEmpty();
+	targetGroups.MakeEmpty();
+	CHECK(action.Rename(sourceGroups, targetGroups, ". .") == "_");
+	CHECK(action.Rename(sourceGroups, targetGroups, "name. .") == "name");
+	CHECK(action.Rename(sourceGroups, targetGroups, ".hidden")
+		== ".hidden");
+
+	action.SetReplaceString(" ");
+	CHECK(action.Rename(sourceGroups, targetGroups, "..") == "_");
+	CHECK(action.Rename(sourceGroups, targetGroups, "a:") == "a");
+}
+
+
+static void
+test_windows_reserved_names()
+{
+	WindowsRenameAction action;
+	action.SetReplaceString(" ");
+
+	GroupList sourceGroups;
+	GroupList targetGroups;
+	CHECK(action.Rename(sourceGroups, targetGroups, "aux") == "aux_");
+	CHECK(sourceGroups.CountItems() == 1);
+	CHECK(has_group(sourceGroups, 0, 3));
+	CHECK(has_group(targetGroups, 3, 4));
+
+	// The groups are those of the original name, not of the result
+	action.SetReplaceString("-");
+	sourceGroups.MakeEmpty();
+	targetGroups.MakeEmpty();
+	CHECK(action.Rename(sourceGroups, targetGroups, "com1.t?t.")
+		== "com1-.t-t");
+	CHECK(has_group(sourceGroups, 0, 4));
+	CHECK(has_group(sourceGroups, 6, 7));
+	CHECK(has_group(sourceGroups, 8, 9));
+	CHECK(has_group(targetGroups, 4, 5));
+	CHECK(has_group(targetGroups, 7, 8));
+
+	sourceGroups.MakeEmpty();
+	targetGroups.MakeEmpty();
+	CHECK(action.Rename(sourceGroups, targetGroups, "Nul .txt")
+		== "Nul- .txt");
+	CHECK(action.Rename(sourceGroups, targetGroups, "nullable.txt")
+		== "nullable.txt");
+}
+
+
+//	#pragma mark - SearchReplaceRenameAction
+
+
+static BString
+search_replace(const char* pattern, const char* name,
+	bool caseInsensitive = false, GroupList* sourceGroups = NULL)
+{
+	SearchReplaceRenameAction action;
+	action.SetCaseInsensitive(caseInsensitive);
+	action.SetPattern(pattern);
+	action.SetReplace("X");
+
+	GroupList groups;
+	GroupList targetGroups;
+	return action.Rename(sourceGroups != NULL ? *sourceGroups : groups,
+		targetGroups, name);
+}
+
+
+static void
+test_search_replace_wildcards()
+{
+	// A '*' matches as little as possible, so that every match ends at
+	// the first "b" after it
+	GroupList groups;
+	CHECK(search_replace("a*b", "a1b2b a3b", false, &groups) == "X2b X");
+	CHECK(groups.CountItems() == 2);
+	CHECK(has_group(groups, 0, 3));
+	CHECK(has_group(groups, 6, 9));
+
+	// At the end of the pattern, it takes the rest of the name
+	CHECK(search_replace("b*", "abcbd") == "aX");
+	CHECK(search_replace("*", "abc") == "X");
+
+	// At its start, everything from the end of the previous match
+	CHECK(search_replace("*c", "abcbc") == "XX");
+	CHECK(search_replace("*c*e", "abcde") == "X");
+	CHECK(search_replace("**c", "abc") == "X");
+
+	// A '?' is a whole character, however many bytes it has
+	CHECK(search_replace("a?c", "abc a\xc3\xa9" "c a\xe2\x84\xaa" "c")
+		== "X X X");
+	CHECK(search_replace("a??", "ab") == "ab");
+	CHECK(search_replace("?*?", "abcd") == "XX");
+	CHECK(search_replace("x*", "abc") == "abc");
+	CHECK(search_replace("a*z", "abc") == "abc");
+}
+
+
+static void
+test_search_replace_case_folding()
+{
+	CHECK(search_replace("k", "kK\xe2\x84\xaa") == "XK\xe2\x84\xaa");
+
+	// The Kelvin sign folds to a "k", even though it is three bytes long
+	GroupList groups;
+	CHECK(search_replace("k", "a\xe2\x84\xaa" "b", true, &groups) == "aXb");
+	CHECK(has_group(groups, 1, 4));
+	CHECK(search_replace("\xe2\x84\xaa", "Kk", true) == "XX");
+	CHECK(search_replace("a*k", "A\xe2\x84\xaa", true) == "X");
+	CHECK(search_replace("?k", "\xe2\x84\xaa\xe2\x84\xaa", true) == "X");
+
+	// The long s is two bytes, and folds to a single byte "s"
+	CHECK(search_replace("sS", "\xc5\xbfs", true) == "X");
+	CHECK(search_replace("\xc5\xbf", "aSs", true) == "aXX");
+
+	// Other characters fold with the same length
+	CHECK(search_replace("\xc3\xa4rger", "\xc3\x84RGER!", true) == "X!");
+	CHECK(search_replace("\xcf\x83", "\xce\xa3\xcf\x82", true) == "XX");
+	CHECK(search_replace("\xc3\xa4", "\xc3\x84", false)
+		== "\xc3\x84");
+
+	// The Turkish dotted I only matches itself
+	CHECK(search_replace("i", "\xc4\xb0", true) == "\xc4\xb0");
+}
+
+
+//	#pragma mark - RegularExpression
+
+
+static void
+test_regular_expression_groups()
+{
+	// The groups follow the priority of the alternatives, not the POSIX
+	// rule, which would give "ab", "c", and "d"
+	RegularExpression expression;
+	CHECK(expression.SetPattern("(a|ab)(c|bcd)(d*)") == B_OK);
+	CHECK(!expression.UsesFallback());
+
+	regmatch_t groups[4];
+	CHECK(expression.Match("abcd", 4, groups, 4));
+	CHECK(groups[0].rm_so == 0 && groups[0].rm_eo == 4);
+	CHECK(groups[1].rm_so == 0 && groups[1].rm_eo == 1);
+	CHECK(groups[2].rm_so == 1 && groups[2].rm_eo == 4);
+	CHECK(groups[3].rm_so == 4 && groups[3].rm_eo == 4);
+
+	// The whole match is still the longest one
+	CHECK(expression.SetPattern("wee|week") == B_OK);
+	CHECK(expression.Match("weeks", 5, groups, 1));
+	CHECK(groups[0].rm_so == 0 && groups[0].rm_eo == 4);
+}
+
+
+static void
+test_regular_expression_regexec()
+{
+	static const char* kPatterns[] = {
+		"a", "a|ab", "(a|ab)(c|bcd)(d*)", "x*", "(a*)*", "(a*)+b", "a{2,3}",
+		"(ab|a)(bc|c)?", "(x)?y", "()", "a.c", "^ab", "b$", "[[:alpha:]]+",
+		"[^a-c ]+", "[]a]", "\\.", "\\<a", "a\\>", "\\`a", "a\\'", "\\ba",
+		"\\Bb", "\\w+", "(a)\\1", "(b|ab)\\1"
+	};
+	static const char* kStrings[] = {
+		"", "a", "ab", "abcd", "ba ab", "aa ab ba", "xyzzy", "aaab", "abcbc",
+		"Hello World", "a.c]", "abab"
+	};
+	static const size_t kPatternCount
+		= sizeof(kPatterns) / sizeof(kPatterns[0]);
+	static const size_t kStringCount
+		= sizeof(kStrings) / sizeof(kStrings[0]);
+	const int32 kMaxGroups = 8;
+
+	for (size_t pattern = 0; pattern < kPatternCount; pattern++) {
+		for (int32 caseInsensitive = 0; caseInsensitive < 2;
+				caseInsensitive++) {
+			RegularExpression expression;
+			regex_t reference;
+			CHECK(expression.SetPattern(kPatterns[pattern], caseInsensitive)
+				== B_OK);
+			CHECK(regcomp(&reference, kPatterns[pattern],
+				REG_EXTENDED | (caseInsensitive ? REG_ICASE : 0)) == 0);
+			CHECK(expression.CountGroups() == (int32)reference.re_nsub);
+
+			int32 groupCount = reference.re_nsub + 1;
+			for (size_t string = 0; string < kStringCount; string++) {
+				const char* text = kStrings[string];
+				int32 length = strlen(text);
+
+				// Also search from later positions, like a global replace
+				for (int32 from = 0; from <= length; from++) {
+					regmatch_t groups[kMaxGroups];
+					regmatch_t expected[kMaxGroups];
+					expected[0].rm_so = from;
+					expected[0].rm_eo = length;
+
+					bool matched = expression.Match(text, length, groups,
+						groupCount, from);
+					if (matched != (regexec(&reference, text, groupCount,
+							expected, REG_STARTEND) == 0)) {
+						fprintf(stderr, "  \"%s\" on \"%s\" from %" B_PRId32
+							" differs\n", kPatterns[pattern], text, from);
+						CHECK(false);
+						continue;
+					}
+
+					for (int32 index = 0; matched && index < groupCount;
+							index++) {
+						if (groups[index].rm_so != expected[index].rm_so
+							|| groups[index].rm_eo != expected[index].rm_eo) {
+							fprintf(stderr, "  \"%s\" on \"%s\" from %"
+								B_PRId32 " differs in group %" B_PRId32 "\n",
+								kPatterns[pattern], text, from, index);
+							CHECK(false);
+						}
+					}
+				}
+			}
+			regfree(&reference);
+		}
+	}
+
+	// The GNU anchors are only supported by regcomp()
+	RegularExpression expression;
+	CHECK(expression.SetPattern("\\<a") == B_OK);
+	CHECK(expression.UsesFallback());
+	CHECK(expression.SetPattern("a\\'") == B_OK);
+	CHECK(expression.UsesFallback());
+}
+
+
+static void
+test_regular_expression_global_fallback()
+{
+	// Later matches must still see the text before them
+	RegularExpressionRenameAction action;
+	CHECK(action.SetPattern("\\ba", false));
+	action.SetReplace("X");
+	action.SetGlobal(true);
+
+	GroupList sourceGroups;
+	GroupList targetGroups;
+	CHECK(action.Rename(sourceGroups, targetGroups, "aa ab ba")
+		== "Xa Xb ba");
+
+	CHECK(action.SetPattern("\\Ba", false));
+	CHECK(action.Rename(sourceGroups, targetGroups, "aa ab ba")
+		== "aX ab bX");
+	CHECK(action.SetPattern("\\<a", false));
+	CHECK(action.Rename(sourceGroups, targetGroups, "aa ab ba")
+		== "Xa Xb ba");
+	CHECK(action.SetPattern("(a)\\1", false));
+	CHECK(action.Rename(sourceGroups, targetGroups, "aaa ab")
+		== "Xa ab");
+
+	// The extension is still left out of the search
+	action.SetIgnoreExtension(true);
+	CHECK(action.SetPattern("a\\>", false));
+	CHECK(action.Rename(sourceGroups, targetGroups, "a ba.a") == "X bX.a");
+}
+
+
+//	#pragma mark - PipelineRenameAction
+
+
+static void
+test_pipeline_group_order()
+{
+	RegularExpressionRenameAction* regularExpression
+		= new RegularExpressionRenameAction();
+	CHECK(regularExpression->SetPattern("_", false));
+	regularExpression->SetReplace(" ");
+	regularExpression->SetGlobal(true);
+
+	CaseRenameAction* titleCase = new CaseRenameAction();
+	titleCase->SetMode(TITLE_CASE);
+
+	PipelineRenameAction pipeline;
+	pipeline.AddAction(regularExpression);
+	pipeline.AddAction(titleCase);
+	pipeline.AddAction(new WindowsRenameAction());
+
+	const char* name = "my_file:name.TXT";
+	GroupList sourceGroups;
+	GroupList targetGroups;
+	BString result = pipeline.Rename(sourceGroups, targetGroups, name);
+
+	CHECK(result == "My File_Name.txt");
+	CHECK(has_ordered_groups(sourceGroups, strlen(name)));
+	CHECK(has_ordered_groups(targetGroups, result.Length()));
+	CHECK(has_group(sourceGroups, 2, 3));
+	CHECK(has_group(sourceGroups, 7, 8));
+	CHECK(has_group(targetGroups, 7, 8));
+	CHECK(has_group(targetGroups, 13, 16));
+}
+
+
+//	#pragma mark - ParallelRenamer
+
+
+/*!	Appends a "+" to every name, and takes its time doing so. It counts
+	how often it is used after it should not be anymore.
+*/
+class SlowRenameAction : public RenameAction {
+public:
+	SlowRenameAction()
+		:
+		stopped(false),
+		lateCount(0)
+	{
+	}
+
+	virtual BString Rename(GroupList& sourceGroups, GroupList& targetGroups,
+		const char* string) const
+	{
+		if (stopped)
+			lateCount++;
+
+		usleep(20);
+		BString target(string);
+		target << "+";
+		return target;
+	}
+
+	std::atomic<bool>			stopped;
+	mutable std::atomic<int32>	lateCount;
+};
+
+
+class TestListener : public ParallelRenamer::Listener {
+public:
+	TestListener(int32 failCount = 0)
+		:
+		stopped(false),
+		callCount(0),
+		lateCount(0),
+		fFailCount(failCount)
+	{
+	}
+
+	virtual bool ChunkFinished()
+	{
+		if (stopped)
+			lateCount++;
+
+		// Fails the first deliveries, or all of them if negative
+		return ++callCount > fFailCount && fFailCount >= 0;
+	}
+
+	std::atomic<bool>			stopped;
+	std::atomic<int32>			callCount;
+	std::atomic<int32>			lateCount;
+
+private:
+	int32						fFailCount;
+};
+
+
+static void
+test_parallel_renamer_runs()
+{
+	ParallelRenamer renamer(4);
+	CHECK(renamer.InitCheck() == B_OK);
+
+	// A run without any names is finished right away
+	SlowRenameAction action;
+	TestListener emptyListener;
+	renamer.Start(action, true, &emptyListener);
+	renamer.Wait();
+	int32 first;
+	int32 end;
+	CHECK(!renamer.NextFinishedChunk(first, end));
+	CHECK(renamer.IsCollected());
+	CHECK(emptyListener.callCount == 0);
+
+	// All chunks of a complete run can be collected, and the last
+	// notification is repeated until it is delivered
+	const int32 kCount = 2000;
+	for (int32 index = 0; index < kCount; index++) {
+		BString name;
+		name << index;
+		renamer.AddName(name.String());
+	}
+
+	TestListener listener(3);
+	renamer.Start(action, true, &listener);
+	renamer.Wait();
+	CHECK(listener.callCount >= 4);
+
+	std::vector<bool> collected(kCount, false);
+	while (renamer.NextFinishedChunk(first, end)) {
+		for (int32 index = first; index < end; index++)
+			collected[index] = true;
+	}
+	CHECK(renamer.IsCollected());
+
+	int32 wrongCount = 0;
+	for (int32 index = 0; index < kCount; index++) {
+		BString expected;
+		expected << index << "+";
+		if (!collected[index] || renamer.ResultAt(index).target != expected)
+			wrongCount++;
+	}
+	CHECK(wrongCount == 0);
+}
+
+
+static void
+test_parallel_renamer_cancel()
+{
+	const int32 kCount = 20000;
+
+	ParallelRenamer renamer(4);
+	for (int32 index = 0; index < kCount; index++)
+		renamer.AddName("name");
+
+	// Cancel a run in the middle
+	SlowRenameAction action;
+	TestListener listener;
+	renamer.Start(action, true, &listener);
+	usleep(20000);
+
+	renamer.Cancel();
+	action.stopped = true;
+	listener.stopped = true;
+
+	// Only the chunks finished before can be collected
+	int32 first;
+	int32 end;
+	int32 collectedCount = 0;
+	while (renamer.NextFinishedChunk(first, end))
+		collectedCount += end - first;
+	CHECK(collectedCount < kCount);
+
+	usleep(50000);
+	CHECK(action.lateCount == 0);
+	CHECK(listener.lateCount == 0);
+	CHECK(!renamer.NextFinishedChunk(first, end));
+
+	// Cancel a finished run whose listener never accepts the last
+	// notification
+	renamer.MakeEmpty();
+	for (int32 index = 0; index < 1000; index++)
+		renamer.AddName("name");
+
+	SlowRenameAction finishedAction;
+	TestListener refusingListener(-1);
+	renamer.Start(finishedAction, true, &refusingListener);
+	usleep(200000);
+	CHECK(refusingListener.callCount > 1);
+
+	renamer.Cancel();
+	refusingListener.stopped = true;
+
+	usleep(50000);
+	CHECK(refusingListener.lateCount == 0);
+}
+
+
+//	#pragma mark - ShellWorkerPool
+
+
+static void
+test_shell_dead_worker()
+{
+	ShellWorkerPool pool(1);
+	CHECK(pool.Execute("/tmp/a b", "echo \"$file\"") == "/tmp/a b");
+
+	// Let the worker die after its job, so that the next job is written to
+	// a closed pipe; this must neither kill us, nor change how SIGPIPE is
+	// handled
+	pool.Execute("/tmp", "(sleep 0.05; kill -9 $$) >/dev/null 2>&1 &");
+	usleep(300000);
+	pool.Execute("/tmp", "echo lost");
+	CHECK(pool.Execute("/tmp", "echo ok") == "ok");
+
+	struct sigaction action;
+	CHECK(sigaction(SIGPIPE, NULL, &action) == 0);
+	CHECK(action.sa_handler == SIG_DFL);
+}
+
+
+static void
+test_shell_cache_policy()
+{
+	CHECK(ShellResultCache::IsCacheable("exiftool \"$file\""));
+	CHECK(ShellResultCache::IsCacheable("basename ${file%.*}"));
+	CHECK(ShellResultCache::IsCacheable("echo \"$1\""));
+	CHECK(ShellResultCache::IsCacheable("echo $10"));
+	CHECK(ShellResultCache::IsCacheable("ls \"$@\""));
+	CHECK(!ShellResultCache::IsCacheable("date +%Y"));
+	CHECK(!ShellResultCache::IsCacheable("echo $filename ${10} $HOME"));
+
+	TestFileSystem fileSystem;
+	fileSystem.AddEntry("/dir", S_IFDIR);
+	fileSystem.AddEntry("/dir/a");
+
+	ExpressionEvaluator evaluator(fileSystem);
+	evaluator.ShellPool().SetTimeout(200000);
+	ShellResultCache& cache = evaluator.ShellCache();
+
+	BString result;
+	int32 emptyCount;
+	evaluator.Evaluate("/dir/a", "$[echo \"$file\"]", result, emptyCount);
+	CHECK(result == "/dir/a");
+	CHECK(cache.CountEntries() == 1);
+
+	// Neither failed, nor timed out jobs are stored
+	evaluator.Evaluate("/dir/a", "$[echo \"$1\"; exit 1]", result,
+		emptyCount);
+	CHECK(result == "/dir/a");
+	evaluator.Evaluate("/dir/a", "$[sleep 5; echo \"$1\"]", result,
+		emptyCount);
+	CHECK(result.IsEmpty());
+	CHECK(cache.CountEntries() == 1);
+
+	// Nor scripts that do not refer to the file
+	evaluator.Evaluate("/dir/a", "$[echo same]", result, emptyCount);
+	CHECK(result == "same");
+	CHECK(cache.CountEntries() == 1);
+
+	// The same goes for jobs that are run together
+	evaluator.AddShellJobs("/dir/a", "$[echo \"$file\"; false]-$[echo $1]");
+	evaluator.RunShellJobs();
+	evaluator.Evaluate("/dir/a", "$[echo \"$file\"; false]-$[echo $1]",
+		result, emptyCount);
+	CHECK(result == "/dir/a-/dir/a");
+	CHECK(cache.CountEntries() == 2);
+}
+
+
+static void
+test_shell_cache_passes()
+{
+	const int32 kFileCount = 6;
+
+	ShellResultCache cache(4);
+	struct stat stats[kFileCount + 1];
+	memset(stats, 0, sizeof(stats));
+	for (int32 index = 0; index <= kFileCount; index++)
+		stats[index].st_ino = index + 1;
+
+	for (int32 pass = 0; pass < 2; pass++) {
+		cache.StartPass();
+
+		for (int32 index = 0; index < kFileCount; index++) {
+			BString output;
+			if (!cache.Lookup("echo $1", "/file", stats[index], output))
+				cache.Store("echo $1", "/file", stats[index], "out");
+		}
+
+		// Nothing of the current pass is dropped
+		CHECK(cache.CountEntries() == kFileCount);
+	}
+
+	BString output;
+	for (int32 index = 0; index < kFileCount; index++)
+		CHECK(cache.Lookup("echo $1", "/file", stats[index], output));
+
+	cache.StartPass();
+	cache.Store("echo $1", "/file", stats[kFileCount], "out");
+	CHECK(cache.CountEntries() == 4);
+}
+
+
+//	#pragma mark - Expressions
+
+
+static bool
+has_same_parts(const ExpressionTemplate& a, const ExpressionTemplate& b)
+{
+	if (a.CountParts() != b.CountParts()
+		|| a.CountExpressions() != b.CountExpressions()
+		|| a.HasShellScripts() != b.HasShellScripts()
+		|| a.HasCounters() != b.HasCounters())
+		return false;
+
+	for (int32 index = 0; index < a.CountParts(); index++) {
+		const ExpressionTemplate::Part& partA = a.PartAt(index);
+		const ExpressionTemplate::Part& partB = b.PartAt(index);
+		if (partA.type != partB.type || partA.offset != partB.offset
+			|| partA.length != partB.length || partA.text != partB.text
+			|| partA.format != partB.format
+			|| partA.maxLength != partB.maxLength)
+			return false;
+	}
+	return true;
+}
+
+
+static void
+test_expression_replacement()
+{
+	static const struct {
+		const char*	pattern;
+		const char*	replace;
+		const char*	name;
+	} kCases[] = {
+		{"a", "$(Title:%s:3)-$[echo $1]", "banana"},
+		{"a", "$(#01)", "a.txt"},
+		{"x", "$(Title)", "none"},
+		{"x", "$(Title)", "x$(Title)x"},
+		{"a", "", "a$[date]"},
+		// The replacement only makes an expression with the text around it
+		{"a", "$", "a(Title)"},
+		{"a", "$(Tit", "ale)"},
+		{"a", "$()", "a"},
+	};
+
+	for (size_t index = 0; index < sizeof(kCases) / sizeof(kCases[0]);
+			index++) {
+		SearchReplaceRenameAction action;
+		action.SetPattern(kCases[index].pattern);
+		action.SetReplace(kCases[index].replace);
+
+		GroupList sourceGroups;
+		GroupList targetGroups;
+		BString target = action.Rename(sourceGroups, targetGroups,
+			kCases[index].name);
+
+		ExpressionTemplate replacement(action.Replacement());
+		ExpressionTemplate composed;
+		composed.SetTo(target, replacement, targetGroups);
+		ExpressionTemplate parsed(target);
+
+		CHECK(composed.Target() == target);
+		if (!has_same_parts(composed, parsed)) {
+			fprintf(stderr, "  \"%s\" differs\n", target.String());
+			CHECK(false);
+		}
+	}
+
+	// Groups that do not contain the replacement are not trusted
+	ExpressionTemplate replacement("$(Title)");
+	GroupList groups;
+	groups.AddItem(Group(0, 1, 9));
+	ExpressionTemplate composed;
+	composed.SetTo("x$(Other)", replacement, groups);
+	CHECK(composed.CountExpressions() == 1);
+	CHECK(composed.PartAt(1).text == "Other");
+}
+
+
+static void
+test_expression_formats()
+{
+	TestFileSystem fileSystem;
+	fileSystem.AddEntry("/dir", S_IFDIR);
+	fileSystem.AddEntry("/dir/a").attributes["Track"] = "7";
+
+	ExpressionEvaluator evaluator(fileSystem);
+	BString result;
+	int32 emptyCount;
+	evaluator.Evaluate("/dir/a", "$(Track:%03d)", result, emptyCount);
+	CHECK(result == "007");
+	evaluator.Evaluate("/dir/a", "$(Track:%.2f)", result, emptyCount);
+	CHECK(result == "7.00");
+	evaluator.Evaluate("/dir/a", "$(Track:%256d)", result, emptyCount);
+	CHECK(result.Length() == 256);
+
+	// Formats that would produce more than a file name are not used
+	evaluator.Evaluate("/dir/a", "$(Track:%999999999d)", result, emptyCount);
+	CHECK(result == "7");
+	evaluator.Evaluate("/dir/a", "$(Track:%257d)", result, emptyCount);
+	CHECK(result == "7");
+	evaluator.Evaluate("/dir/a", "$(Track:%.0999d)", result, emptyCount);
+	CHECK(result == "7");
+	evaluator.Evaluate("/dir/a", "$(Track:%d%d)", result, emptyCount);
+	CHECK(result == "7");
+}
+
+
+static void
+test_expression_counters()
+{
+	static const char* kTargets[] = {
+		"IMG_$(#0001)", "$[date]", "a$(Title)b", "a$()b", "$(Title", "$",
+		"plain.txt"
+	};
+	for (size_t index = 0; index < sizeof(kTargets) / sizeof(kTargets[0]);
+			index++) {
+		ExpressionTemplate target(kTargets[index]);
+		CHECK(ExpressionTemplate::HasExpressions(kTargets[index])
+			== (target.CountExpressions() > 0));
+	}
+	CHECK(ExpressionTemplate::HasExpressions("IMG_$(#0001)"));
+
+	// All files have the same target, and only get their names from the
+	// counter
+	TestFileSystem fileSystem;
+	fileSystem.AddEntry("/dir", S_IFDIR);
+	ExpressionEvaluator evaluator(fileSystem);
+	ExpressionTemplate target("IMG_$(#0001)");
+
+	static const char* kNames[] = {"IMG_0003", "IMG_0002", "IMG_0001"};
+	for (int32 index = 0; index < 3; index++) {
+		BString path("/dir/");
+		path << kNames[index];
+		fileSystem.AddEntry(path.String());
+
+		BString result;
+		int32 emptyCount;
+		evaluator.SetCounters(index, index);
+		CHECK(evaluator.Evaluate(path.String(), target, result,
+			emptyCount) == 1);
+		CHECK(result == kNames[2 - index]);
+	}
+}
+
+
+//	#pragma mark - AttributeCache
+
+
+static void
+test_attribute_cache_passes()
+{
+	// More files than the cache holds by default
+	const int32 kFileCount = 5000;
+
+	TestFileSystem fileSystem;
+	fileSystem.AddEntry("/dir", S_IFDIR);
+	for (int32 index = 0; index < kFileCount; index++) {
+		BString path;
+		path.SetToFormat("/dir/%" B_PRId32, index);
+		fileSystem.AddEntry(path.String()).attributes["Title"] << index;
+	}
+
+	ExpressionEvaluator evaluator(fileSystem);
+	BString result;
+	int32 emptyCount;
+	int32 readCount = 0;
+
+	for (int32 pass = 0; pass < 2; pass++) {
+		evaluator.StartPass();
+
+		for (int32 index = 0; index < kFileCount; index++) {
+			BString path;
+			path.SetToFormat("/dir/%" B_PRId32, index);
+			evaluator.Evaluate(path.String(), "$(Title)", result, emptyCount);
+		}
+
+		if (pass == 0)
+			readCount = fileSystem.attributeReadCount;
+	}
+
+	CHECK(readCount == kFileCount);
+	CHECK(fileSystem.attributeReadCount == kFileCount);
+	CHECK(fileSystem.openCount == kFileCount);
+	CHECK(result == "4999");
+
+	// A later pass may drop the nodes of the earlier ones again
+	fileSystem.AddEntry("/dir/new");
+	evaluator.StartPass();
+	evaluator.Evaluate("/dir/new", "$(Title)", result, emptyCount);
+	CHECK(evaluator.Attributes().CountNodes() == 4096);
+}
+
+
+//	#pragma mark - DirectoryCache
+
+
+static void
+test_directory_cache_case()
+{
+	TestFileSystem caseSensitive(true);
+	caseSensitive.AddEntry("/dir", S_IFDIR);
+	caseSensitive.AddEntry("/dir/Photo.JPG");
+	caseSensitive.AddEntry("/dir/\xc3\x84rger.txt");
+
+	DirectoryCache cache(caseSensitive);
+	CHECK(cache.Exists("/dir", "Photo.JPG"));
+	CHECK(!cache.Exists("/dir", "photo.jpg"));
+	CHECK(!cache.Exists("/dir", "\xc3\xa4rger.txt"));
+	CHECK(!cache.Exists("/dir", "other"));
+	CHECK(caseSensitive.readDirectoryCount == 1);
+
+	// Only names that differ in case are checked on disk
+	int32 statCount = caseSensitive.statCount;
+	CHECK(!cache.Exists("/dir", "another"));
+	CHECK(caseSensitive.statCount == statCount);
+
+	TestFileSystem caseInsensitive(false);
+	caseInsensitive.AddEntry("/dir", S_IFDIR);
+	caseInsensitive.AddEntry("/dir/Photo.JPG");
+
+	DirectoryCache insensitiveCache(caseInsensitive);
+	CHECK(insensitiveCache.Exists("/dir", "Photo.JPG"));
+	CHECK(insensitiveCache.Exists("/dir", "photo.jpg"));
+	CHECK(insensitiveCache.Exists("/dir", "PHOTO.jpg"));
+	CHECK(!insensitiveCache.Exists("/dir", "photo.png"));
+}
+
+
+//	#pragma mark -
+
+
+static const struct {
+	const char*	name;
+	void		(*function)();
+} kTests[] = {
+	{"windows/trailing dots", test_windows_trailing_dots},
+	{"windows/reserved names", test_windows_reserved_names},
+	{"search and replace/wildcards", test_search_replace_wildcards},
+	{"search and replace/case folding", test_search_replace_case_folding},
+	{"regular expression/groups", test_regular_expression_groups},
+	{"regular expression/regexec", test_regular_expression_regexec},
+	{"regular expression/global fallback",
+		test_regular_expression_global_fallback},
+	{"pipeline/group order", test_pipeline_group_order},
+	{"parallel renamer/runs", test_parallel_renamer_runs},
+	{"parallel renamer/cancel", test_parallel_renamer_cancel},
+	{"shell/dead worker", test_shell_dead_worker},
+	{"shell/cache policy", test_shell_cache_policy},
+	{"shell/cache passes", test_shell_cache_passes},
+	{"expressions/replacement", test_expression_replacement},
+	{"expressions/formats", test_expression_formats},
+	{"expressions/counters", test_expression_counters},
+	{"attribute cache/passes", test_attribute_cache_passes},
+	{"directory cache/case", test_directory_cache_case},
+};
+
+
+int
+main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : NULL;
+	int32 testCount = 0;
+
+	for (size_t index = 0; index < sizeof(kTests) / sizeof(kTests[0]);
+			index++) {
+		if (filter != NULL && strstr(kTests[index].name, filter) == NULL)
+			continue;
+
+		int32 failureCount = sFailureCount;
+		kTests[index].function();
+		testCount++;
+
+		printf("%s: %s\n", kTests[index].name,
+			sFailureCount == failureCount ? "ok" : "FAILED");
+	}
+
+	printf("%" B_PRId32 " tests, %" B_PRId32 " failed checks\n", testCount,
+		sFailureCount);
+	return sFailureCount != 0 ? 1 : 0;
+}